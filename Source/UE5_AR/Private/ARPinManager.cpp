@@ -0,0 +1,224 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ARPinManager.h"
+#include "ARPin.h"
+#include "ARBlueprintLibrary.h"
+
+void UARPinManager::Deinitialize()
+{
+	PinnedActors.Empty();
+	ArenaAnchor = nullptr;
+
+	Super::Deinitialize();
+}
+
+TStatId UARPinManager::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UARPinManager, STATGROUP_Tickables);
+}
+
+// Called every frame
+void UARPinManager::Tick(float DeltaTime)
+{
+	LastCommitCount = 0;
+
+	// Update the arena frame. The last good pose is kept while the anchor isn't tracking.
+	FTransform PreviousArenaTransform = ArenaTransform;
+	bool bArenaMoved = false;
+	if (ArenaAnchor && ArenaAnchor->GetTrackingState() == EARTrackingState::Tracking)
+	{
+		FTransform AnchorTransform = ArenaAnchor->GetLocalToWorldTransform();
+		AnchorTransform.SetScale3D(FVector::OneVector);
+		bArenaMoved = !AnchorTransform.Equals(ArenaTransform, PoseTolerance);
+		ArenaTransform = AnchorTransform;
+	}
+
+	if (PinnedActors.Num() == 0)
+	{
+		return;
+	}
+
+	// Work out every pinned actor's transform, dropping actors that are gone or whose pin stopped tracking.
+	for (int i = PinnedActors.Num() - 1; i >= 0; i--)
+	{
+		FPinnedActor& Entry = PinnedActors[i];
+		Entry.bNeedsCommit = false;
+
+		if (!IsValid(Entry.Actor))
+		{
+			PinnedActors.RemoveAtSwap(i, 1, false);
+			continue;
+		}
+
+		const FTransform& Current = Entry.Actor->GetActorTransform();
+		FTransform Frame;
+		FQuat PreviousFrameRotation = FQuat::Identity;
+
+		if (Entry.Pin)
+		{
+			// Own pin. Only the pin's location is used, so the actor keeps world space rotation.
+			EARTrackingState TrackingState = Entry.Pin->GetTrackingState();
+			if (TrackingState == EARTrackingState::NotTracking)
+			{
+				PinnedActors.RemoveAtSwap(i, 1, false);
+				continue;
+			}
+			if (TrackingState != EARTrackingState::Tracking)
+			{
+				continue;
+			}
+			Frame.SetLocation(Entry.Pin->GetLocalToWorldTransform().GetLocation());
+		}
+		else if (Entry.bSimulatesPhysics)
+		{
+			// Carry physics actors by however much the anchor moved.
+			if (bArenaMoved)
+			{
+				Entry.TargetTransform = Current.GetRelativeTransform(PreviousArenaTransform) * ArenaTransform;
+				Entry.bNeedsCommit = true;
+			}
+			continue;
+		}
+		else
+		{
+			Frame = ArenaTransform;
+			PreviousFrameRotation = PreviousArenaTransform.GetRotation();
+		}
+
+		FQuat Rotation = Entry.bKeepRotation ? Frame.GetRotation() * PreviousFrameRotation.Inverse() * Current.GetRotation() : Frame.GetRotation() * Entry.Rotation.Quaternion();
+		Entry.TargetTransform = FTransform(Rotation, Frame.TransformPosition(Entry.Offset), Entry.Scale);
+		Entry.bNeedsCommit = !Entry.TargetTransform.Equals(Current, PoseTolerance);
+	}
+
+	// Apply the new poses, once per actor.
+	for (FPinnedActor& Entry : PinnedActors)
+	{
+		if (Entry.bNeedsCommit)
+		{
+			Entry.Actor->SetActorTransform(Entry.TargetTransform, false, nullptr, Entry.bSimulatesPhysics ? ETeleportType::TeleportPhysics : ETeleportType::None);
+			LastCommitCount++;
+		}
+	}
+}
+
+void UARPinManager::AddPinnedActor(AActor* Actor, UARPin* Pin, const FVector& Scale, bool bKeepRotation, const FRotator& Rotation)
+{
+	if (!Actor || !Pin)
+	{
+		return;
+	}
+
+	FPinnedActor* Entry = FindEntry(Actor);
+	if (!Entry)
+	{
+		Entry = &PinnedActors.AddDefaulted_GetRef();
+		Entry->Actor = Actor;
+	}
+
+	Entry->Pin = Pin;
+	Entry->Offset = FVector::ZeroVector;
+	Entry->Scale = Scale;
+	Entry->bKeepRotation = bKeepRotation;
+	Entry->Rotation = Rotation;
+	Entry->bSimulatesPhysics = false;
+}
+
+void UARPinManager::AddArenaActor(AActor* Actor, const FVector& Scale, bool bKeepRotation, const FRotator& Rotation)
+{
+	if (!Actor || !ArenaAnchor)
+	{
+		return;
+	}
+
+	FPinnedActor* Entry = FindEntry(Actor);
+	if (!Entry)
+	{
+		Entry = &PinnedActors.AddDefaulted_GetRef();
+		Entry->Actor = Actor;
+	}
+
+	Entry->Pin = nullptr;
+	Entry->Offset = ArenaTransform.InverseTransformPosition(Actor->GetActorLocation());
+	Entry->Scale = Scale;
+	Entry->bKeepRotation = bKeepRotation;
+	Entry->Rotation = Rotation;
+	Entry->bSimulatesPhysics = false;
+}
+
+void UARPinManager::AddArenaPhysicsActor(AActor* Actor)
+{
+	if (!Actor || !ArenaAnchor)
+	{
+		return;
+	}
+
+	FPinnedActor* Entry = FindEntry(Actor);
+	if (!Entry)
+	{
+		Entry = &PinnedActors.AddDefaulted_GetRef();
+		Entry->Actor = Actor;
+	}
+
+	Entry->Pin = nullptr;
+	Entry->bSimulatesPhysics = true;
+}
+
+void UARPinManager::RemovePinnedActor(AActor* Actor)
+{
+	PinnedActors.RemoveAllSwap([Actor](const FPinnedActor& Entry) { return Entry.Actor == Actor; });
+}
+
+void UARPinManager::AddPinOffset(AActor* Actor, const FVector& WorldDelta)
+{
+	FPinnedActor* Entry = FindEntry(Actor);
+	if (!Entry)
+	{
+		return;
+	}
+
+	// Pinned actors use world space directions, arena actors use arena space.
+	Entry->Offset += Entry->Pin ? WorldDelta : ArenaTransform.InverseTransformVectorNoScale(WorldDelta);
+}
+
+bool UARPinManager::IsPinned(const AActor* Actor) const
+{
+	return FindEntry(Actor) != nullptr;
+}
+
+void UARPinManager::SetArenaAnchor(UARPin* Pin)
+{
+	ClearArenaAnchor();
+
+	if (Pin)
+	{
+		ArenaAnchor = Pin;
+		ArenaTransform = Pin->GetLocalToWorldTransform();
+		ArenaTransform.SetScale3D(FVector::OneVector);
+	}
+}
+
+void UARPinManager::ClearArenaAnchor()
+{
+	if (!ArenaAnchor)
+	{
+		return;
+	}
+
+	// Arena actors have nothing left to follow.
+	PinnedActors.RemoveAllSwap([](const FPinnedActor& Entry) { return Entry.Pin == nullptr; });
+
+	UARBlueprintLibrary::RemovePin(ArenaAnchor);
+	ArenaAnchor = nullptr;
+	ArenaTransform = FTransform::Identity;
+}
+
+FPinnedActor* UARPinManager::FindEntry(const AActor* Actor)
+{
+	return PinnedActors.FindByPredicate([Actor](const FPinnedActor& Entry) { return Entry.Actor == Actor; });
+}
+
+const FPinnedActor* UARPinManager::FindEntry(const AActor* Actor) const
+{
+	return PinnedActors.FindByPredicate([Actor](const FPinnedActor& Entry) { return Entry.Actor == Actor; });
+}
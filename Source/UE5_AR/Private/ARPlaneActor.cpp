@@ -13,6 +13,7 @@
 // limitations under the License.
 
 #include "ARPlaneActor.h"
+#include "MatchRegistrySubsystem.h"
 #include "ProceduralMeshComponent.h"
 #include "Components/InstancedStaticMeshComponent.h"
 
@@ -23,6 +24,15 @@ AARPlaneActor::AARPlaneActor()
 	PlanePolygonMeshComponent = CreateDefaultSubobject<UProceduralMeshComponent>(TEXT("PlanePolygonMesh"));
 	RootComponent = PlanePolygonMeshComponent;
 
+	// The drawn mesh has no collision.
+	PlanePolygonMeshComponent->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+
+	// Collision is only built for the arena plane, and cooked off the game thread.
+	CollisionMeshComponent = CreateDefaultSubobject<UProceduralMeshComponent>(TEXT("CollisionMesh"));
+	CollisionMeshComponent->SetupAttachment(PlanePolygonMeshComponent);
+	CollisionMeshComponent->bUseAsyncCooking = true;
+	CollisionMeshComponent->SetVisibility(false);
+
 	// Take material from editor
 	static ConstructorHelpers::FObjectFinder<UMaterialInterface> MaterialAsset(TEXT("Material'/Game/Assets/Materials/ARPlane_Mat.ARPlane_Mat'"));
 	Material_ = MaterialAsset.Object;
@@ -42,6 +52,14 @@ void AARPlaneActor::BeginPlay()
 	PlaneMaterial->SetScalarParameterValue("TextureRotationAngle", FMath::RandRange(0.0f, 1.0f));
 	PlanePolygonMeshComponent->SetMaterial(0, PlaneMaterial);
 
+	GetWorld()->GetSubsystem<UMatchRegistrySubsystem>()->RegisterPlane(this);
+}
+
+void AARPlaneActor::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	GetWorld()->GetSubsystem<UMatchRegistrySubsystem>()->UnregisterPlane(this);
+
+	Super::EndPlay(EndPlayReason);
 }
 
 // Called every frame
@@ -49,31 +67,78 @@ void AARPlaneActor::Tick(float DeltaTime)
 {
 	Super::Tick(DeltaTime);
 
+	// Pooled planes have no geometry.
+	if (!ARCorePlaneObject)
+	{
+		return;
+	}
+
 	// Set plane transform.
 	PlanePolygonMeshComponent->SetWorldTransform(ARCorePlaneObject->GetLocalToWorldTransform());
 
-	// If visibility isn't overwritten, set visibility based on tracking state.
-	if (!bIsVisibleOverride)
+	// Keep the arena plane's collision up to date with its mesh.
+	if (bArenaCollision && CollisionVersion != MeshVersion)
 	{
-		switch (ARCorePlaneObject->GetTrackingState())
-		{
-		case EARTrackingState::Tracking:
-			PlanePolygonMeshComponent->SetVisibility(true);
-			break;
-		case EARTrackingState::NotTracking:
-			PlanePolygonMeshComponent->SetVisibility(false);
-			break;
-		case EARTrackingState::StoppedTracking:
-			PlanePolygonMeshComponent->SetVisibility(false);
-			break;
-		}
+		UpdateCollision();
+	}
+
+	// Set visibility based on tracking state and the override.
+	if (!bBatched)
+	{
+		PlanePolygonMeshComponent->SetVisibility(ShouldBeVisible());
+	}
+}
+
+bool AARPlaneActor::ShouldBeVisible() const
+{
+	// If visibility is overwritten, hide the plane.
+	if (bIsVisibleOverride || !ARCorePlaneObject)
+	{
+		return false;
 	}
-	else // Otherwise hide the plane.
+
+	// Otherwise only show it while it's tracking.
+	return ARCorePlaneObject->GetTrackingState() == EARTrackingState::Tracking;
+}
+
+void AARPlaneActor::SetBatched(bool bInBatched)
+{
+	bBatched = bInBatched;
+
+	if (bBatched)
 	{
-		PlanePolygonMeshComponent->SetVisibility(false);
+		PlanePolygonMeshComponent->ClearMeshSection(0);
+		SetActorTickEnabled(bArenaCollision);
 	}
 }
 
+void AARPlaneActor::ResetForPool()
+{
+	// Drop the geometry and any mesh build in progress.
+	ARCorePlaneObject = nullptr;
+	MeshTask = UE::Tasks::TTask<FPlaneMeshData>();
+	bRebuildQueued = false;
+
+	// Empty the mesh, keeping the component and material for reuse.
+	PlanePolygonMeshComponent->ClearAllMeshSections();
+	CollisionMeshComponent->ClearAllMeshSections();
+	MeshFrameNumber = 0;
+	MeshBoundary.Reset();
+	MeshNormal = FVector::ZeroVector;
+	MeshData = FPlaneMeshData();
+	MeshDataBoundary.Reset();
+	CollisionBoundary.Reset();
+
+	// Back to default state.
+	bArenaCollision = false;
+	MeshVersion = 0;
+	CollisionVersion = 0;
+	bIsVisibleOverride = false;
+
+	SetActorHiddenInGame(true);
+	SetActorTickEnabled(false);
+}
+
 void AARPlaneActor::SetColor(FColor InColor) 
 {
 	// Set the plane colour in the dynamic material.
@@ -83,89 +148,168 @@ void AARPlaneActor::SetColor(FColor InColor)
 
 void AARPlaneActor::UpdatePlanePolygonMesh()
 {
-	// Update polygon mesh vertex indices, using triangle fan due to its convex.
-	TArray<FVector> BoundaryVertices;
+	// Nothing to do if ARCore hasn't touched the plane since the last update.
+	uint32 FrameNumber = ARCorePlaneObject->GetLastUpdateFrameNumber();
+	if (FrameNumber == MeshFrameNumber && MeshBoundary.Num() > 0)
+	{
+		return;
+	}
+	MeshFrameNumber = FrameNumber;
+
 	// Obtain the boundary vertices from ARCore's plane geometry
-	BoundaryVertices = ARCorePlaneObject->GetBoundaryPolygonInLocalSpace();
-	int BoundaryVerticesNum = BoundaryVertices.Num();
+	const TArray<FVector>& BoundaryVertices = ARCorePlaneObject->GetBoundaryPolygonInLocalSpace();
 
-	if (BoundaryVerticesNum < 3)
+	if (BoundaryVertices.Num() < 3)
+	{
+		if (MeshBoundary.Num() > 0)
+		{
+			PlanePolygonMeshComponent->ClearAllMeshSections();
+			CollisionMeshComponent->ClearAllMeshSections();
+			MeshVersion++;
+			CollisionVersion = MeshVersion;
+			MeshBoundary.Reset();
+			MeshDataBoundary.Reset();
+			CollisionBoundary.Reset();
+			MeshData = FPlaneMeshData();
+			MeshTask = UE::Tasks::TTask<FPlaneMeshData>();
+		}
+		return;
+	}
+
+	// Skip planes whose boundary hasn't changed.
+	FVector PlaneNormal = ARCorePlaneObject->GetLocalToWorldTransform().GetRotation().GetUpVector();
+	if (!HasBoundaryChanged(BoundaryVertices, PlaneNormal))
 	{
-		PlanePolygonMeshComponent->ClearMeshSection(0);
 		return;
 	}
 
-	int PolygonMeshVerticesNum = BoundaryVerticesNum * 2;
-	// Triangle number is interior(n-2 for convex polygon) plus perimeter (EdgeNum * 2);
-	int TriangleNum = BoundaryVerticesNum - 2 + BoundaryVerticesNum * 2;
+	// Only one build at a time. The latest boundary is picked up once the running build has been committed.
+	if (MeshTask.IsValid())
+	{
+		bRebuildQueued = true;
+		return;
+	}
 
-	TArray<FVector> PolygonMeshVertices;
-	TArray<FLinearColor> PolygonMeshVertexColors;
-	TArray<int> PolygonMeshIndices;
-	TArray<FVector> PolygonMeshNormals;
-	TArray<FVector2D> PolygonMeshUVs;
+	MeshBoundary = BoundaryVertices;
+	MeshNormal = PlaneNormal;
 
-	PolygonMeshVertices.Empty(PolygonMeshVerticesNum);
-	PolygonMeshVertexColors.Empty(PolygonMeshVerticesNum);
-	PolygonMeshIndices.Empty(TriangleNum * 3);
-	PolygonMeshNormals.Empty(PolygonMeshVerticesNum);
+	// Build from a snapshot so the worker never touches the geometry object.
+	MeshTask = UE::Tasks::Launch(UE_SOURCE_LOCATION, [Boundary = MeshBoundary, PlaneNormal, Feathering = EdgeFeatheringDistance]()
+	{
+		FPlaneMeshData Mesh;
+		FPlaneMeshBuilder::Build(Boundary, PlaneNormal, Feathering, Mesh);
+		return Mesh;
+	});
+}
 
+bool AARPlaneActor::CommitPendingMesh()
+{
+	// The build was dropped, because the boundary went away, so there's nothing left to wait for.
+	if (!MeshTask.IsValid())
+	{
+		return true;
+	}
 
-	// Creating the triangle fan from the vertices obtained
-	FVector PlaneNormal = ARCorePlaneObject->GetLocalToWorldTransform().GetRotation().GetUpVector();
-	for (int i = 0; i < BoundaryVerticesNum; i++)
+	if (!MeshTask.IsCompleted())
 	{
-		FVector BoundaryPoint = BoundaryVertices[i];
-		float BoundaryToCenterDist = BoundaryPoint.Size();
-		float FeatheringDist = FMath::Min(BoundaryToCenterDist, EdgeFeatheringDistance);
-		FVector InteriorPoint = BoundaryPoint - BoundaryPoint.GetUnsafeNormal() * FeatheringDist;
+		return false;
+	}
 
-		PolygonMeshVertices.Add(BoundaryPoint);
-		PolygonMeshVertices.Add(InteriorPoint);
+	FPlaneMeshData NewMesh = MoveTemp(MeshTask.GetResult());
+	MeshTask = UE::Tasks::TTask<FPlaneMeshData>();
 
-		PolygonMeshUVs.Add(FVector2D(BoundaryPoint.X, BoundaryPoint.Y));
-		PolygonMeshUVs.Add(FVector2D(InteriorPoint.X, InteriorPoint.Y));
+	// Only one build runs at a time, so the boundary it was started with is still the latest.
+	MeshDataBoundary = MeshBoundary;
 
-		PolygonMeshNormals.Add(PlaneNormal);
-		PolygonMeshNormals.Add(PlaneNormal);
+	// Patch the vertices in place if the triangles are the same, otherwise recreate the section.
+	bool bSameTopology = PlanePolygonMeshComponent->GetNumSections() > 0 && NewMesh.Indices == MeshData.Indices;
+	MeshData = MoveTemp(NewMesh);
 
-		PolygonMeshVertexColors.Add(FLinearColor(0.0f, 0.f, 0.f, 0.f));
-		PolygonMeshVertexColors.Add(FLinearColor(0.0f, 0.f, 0.f, 1.f));
+	if (bBatched)
+	{
+		// The batch component draws the plane.
+	}
+	else if (bSameTopology)
+	{
+		PlanePolygonMeshComponent->UpdateMeshSection_LinearColor(0, MeshData.Vertices, MeshData.Normals, MeshData.UVs, MeshData.VertexColors, TArray<FProcMeshTangent>());
+	}
+	else
+	{
+		// No need to fill tangents. Collision lives on its own component, see UpdateCollision.
+		PlanePolygonMeshComponent->CreateMeshSection_LinearColor(0, MeshData.Vertices, MeshData.Indices, MeshData.Normals, MeshData.UVs, MeshData.VertexColors, TArray<FProcMeshTangent>(), false);
+	}
+
+	MeshVersion++;
+	LastMeshChangeTime = GetWorld()->GetTimeSeconds();
 
+	// The boundary changed while building, so let the next update start another build.
+	if (bRebuildQueued)
+	{
+		bRebuildQueued = false;
+		MeshFrameNumber = 0;
 	}
 
-	// Generate triangle indices
+	return true;
+}
+
+void AARPlaneActor::EnableArenaCollision()
+{
+	bArenaCollision = true;
+
+	// Batched planes don't tick otherwise, but collision needs following the plane.
+	SetActorTickEnabled(true);
+}
 
-	// Perimeter triangles
-	for (int i = 0; i < BoundaryVerticesNum - 1; i++)
+void AARPlaneActor::GetArenaFloor(const FTransform& ArenaTransform, TArray<FVector2D>& OutFloor) const
+{
+	OutFloor.Reset();
+	if (!ARCorePlaneObject)
 	{
-		PolygonMeshIndices.Add(i * 2);
-		PolygonMeshIndices.Add(i * 2 + 2);
-		PolygonMeshIndices.Add(i * 2 + 1);
+		return;
+	}
 
-		PolygonMeshIndices.Add(i * 2 + 1);
-		PolygonMeshIndices.Add(i * 2 + 2);
-		PolygonMeshIndices.Add(i * 2 + 3);
+	// The boundary the collision grenades land on was cooked from, not the latest build's.
+	const FTransform PlaneTransform = ARCorePlaneObject->GetLocalToWorldTransform();
+	for (const FVector& Vertex : CollisionBoundary)
+	{
+		OutFloor.Add(FVector2D(ArenaTransform.InverseTransformPosition(PlaneTransform.TransformPosition(Vertex))));
 	}
+}
 
-	// Adding the last triangle to close the plane mesh completely
-	PolygonMeshIndices.Add((BoundaryVerticesNum - 1) * 2);
-	PolygonMeshIndices.Add(0);
-	PolygonMeshIndices.Add((BoundaryVerticesNum - 1) * 2 + 1);
+void AARPlaneActor::UpdateCollision()
+{
+	// Wait for the boundary to settle, so collision isn't re-cooked while ARCore is still growing the plane.
+	if (GetWorld()->GetTimeSeconds() - LastMeshChangeTime < CollisionStableTime)
+	{
+		return;
+	}
 
+	CollisionVersion = MeshVersion;
+	CollisionBoundary = MeshDataBoundary;
 
-	PolygonMeshIndices.Add((BoundaryVerticesNum - 1) * 2 + 1);
-	PolygonMeshIndices.Add(0);
-	PolygonMeshIndices.Add(1);
+	// The collision component is only touched here, so visual updates never trigger a cook.
+	CollisionMeshComponent->CreateMeshSection_LinearColor(0, MeshData.Vertices, MeshData.Indices, TArray<FVector>(), TArray<FVector2D>(), TArray<FLinearColor>(), TArray<FProcMeshTangent>(), true);
+}
 
-	// interior triangles
-	for (int i = 3; i < PolygonMeshVerticesNum - 1; i += 2)
+bool AARPlaneActor::HasBoundaryChanged(const TArray<FVector>& BoundaryVertices, const FVector& PlaneNormal) const
+{
+	if (BoundaryVertices.Num() != MeshBoundary.Num())
+	{
+		return true;
+	}
+
+	if (!PlaneNormal.Equals(MeshNormal, KINDA_SMALL_NUMBER))
+	{
+		return true;
+	}
+
+	for (int i = 0; i < BoundaryVertices.Num(); i++)
 	{
-		PolygonMeshIndices.Add(1);
-		PolygonMeshIndices.Add(i);
-		PolygonMeshIndices.Add(i + 2);
+		if (!BoundaryVertices[i].Equals(MeshBoundary[i], BoundaryChangeTolerance))
+		{
+			return true;
+		}
 	}
 
-	// No need to fill uv and tangent;
-	PlanePolygonMeshComponent->CreateMeshSection_LinearColor(0, PolygonMeshVertices, PolygonMeshIndices, PolygonMeshNormals, PolygonMeshUVs, PolygonMeshVertexColors, TArray<FProcMeshTangent>(), true);
-}
\ No newline at end of file
+	return false;
+}
@@ -0,0 +1,122 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ARPlaneBatchComponent.h"
+#include "ARPlaneActor.h"
+#include "ARTrackable.h"
+
+UARPlaneBatchComponent::UARPlaneBatchComponent(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+{
+	// Vertices are in world space, so the component must not move with its owner.
+	SetUsingAbsoluteLocation(true);
+	SetUsingAbsoluteRotation(true);
+	SetUsingAbsoluteScale(true);
+
+	// The batch is only drawn. Collision comes from the arena plane actor.
+	SetCollisionEnabled(ECollisionEnabled::NoCollision);
+
+	// Take material from editor
+	static ConstructorHelpers::FObjectFinder<UMaterialInterface> MaterialAsset(TEXT("Material'/Game/Assets/Materials/ARPlane_Mat.ARPlane_Mat'"));
+	BatchMaterial = MaterialAsset.Object;
+}
+
+void UARPlaneBatchComponent::AddPlane(AARPlaneActor* Plane)
+{
+	FBatchedPlane& Entry = Planes.AddDefaulted_GetRef();
+	Entry.Plane = Plane;
+	bDirty = true;
+}
+
+void UARPlaneBatchComponent::RemovePlane(AARPlaneActor* Plane)
+{
+	if (Planes.RemoveAllSwap([Plane](const FBatchedPlane& Entry) { return Entry.Plane == Plane; }) > 0)
+	{
+		bDirty = true;
+	}
+}
+
+void UARPlaneBatchComponent::UpdateBatch()
+{
+	// Check every plane for changes first, which is much cheaper than rebuilding.
+	bool bChanged = bDirty;
+	int32 NumVertices = 0;
+	int32 NumIndices = 0;
+
+	for (FBatchedPlane& Entry : Planes)
+	{
+		AARPlaneActor* Plane = Entry.Plane;
+		bool bVisible = Plane->ShouldBeVisible();
+		FTransform Transform = bVisible ? Plane->ARCorePlaneObject->GetLocalToWorldTransform() : Entry.Transform;
+
+		if (bVisible != Entry.bVisible || Plane->GetMeshVersion() != Entry.MeshVersion || !Transform.Equals(Entry.Transform))
+		{
+			Entry.bVisible = bVisible;
+			Entry.MeshVersion = Plane->GetMeshVersion();
+			Entry.Transform = Transform;
+			bChanged = true;
+		}
+
+		if (bVisible)
+		{
+			NumVertices += Plane->GetMeshData().Vertices.Num();
+			NumIndices += Plane->GetMeshData().Indices.Num();
+		}
+	}
+
+	if (!bChanged)
+	{
+		return;
+	}
+	bDirty = false;
+
+	TArray<int> PreviousIndices = MoveTemp(Indices);
+
+	Vertices.Reset(NumVertices);
+	VertexColors.Reset(NumVertices);
+	Normals.Reset(NumVertices);
+	UVs.Reset(NumVertices);
+	Indices.Reset(NumIndices);
+
+	// Append each visible plane as a sub-range, transformed into world space and tinted with its colour.
+	for (const FBatchedPlane& Entry : Planes)
+	{
+		if (!Entry.bVisible)
+		{
+			continue;
+		}
+
+		const FPlaneMeshData& Mesh = Entry.Plane->GetMeshData();
+		const int32 BaseVertex = Vertices.Num();
+		const FLinearColor Tint = FLinearColor(Entry.Plane->PlaneColor);
+		const FVector PlaneNormal = Entry.Transform.GetRotation().GetUpVector();
+
+		for (int i = 0; i < Mesh.Vertices.Num(); i++)
+		{
+			Vertices.Add(Entry.Transform.TransformPosition(Mesh.Vertices[i]));
+			Normals.Add(PlaneNormal);
+			UVs.Add(Mesh.UVs[i]);
+			VertexColors.Add(FLinearColor(Tint.R, Tint.G, Tint.B, Mesh.VertexColors[i].A));
+		}
+
+		for (int Index : Mesh.Indices)
+		{
+			Indices.Add(BaseVertex + Index);
+		}
+	}
+
+	if (Indices.Num() == 0)
+	{
+		ClearMeshSection(0);
+	}
+	else if (GetNumSections() > 0 && Indices == PreviousIndices)
+	{
+		// Same triangles, only the vertices moved.
+		UpdateMeshSection_LinearColor(0, Vertices, Normals, UVs, VertexColors, TArray<FProcMeshTangent>());
+	}
+	else
+	{
+		CreateMeshSection_LinearColor(0, Vertices, Indices, Normals, UVs, VertexColors, TArray<FProcMeshTangent>(), false);
+		SetMaterial(0, BatchMaterial);
+	}
+}
@@ -0,0 +1,296 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ARReplaySubsystem.h"
+#include "ARReplaySystem.h"
+#include "ARBlueprintLibrary.h"
+#include "ARTrackable.h"
+#include "ARPin.h"
+#include "Misc/FileHelper.h"
+#include "Serialization/JsonSerializer.h"
+#include "Serialization/JsonWriter.h"
+#include "Kismet/GameplayStatics.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogARReplaySubsystem, Log, All);
+
+// Tracking state names used in the session file.
+static FString TrackingStateToString(EARTrackingState State)
+{
+	switch (State)
+	{
+	case EARTrackingState::NotTracking:
+		return TEXT("NotTracking");
+	case EARTrackingState::StoppedTracking:
+		return TEXT("StoppedTracking");
+	default:
+		return TEXT("Tracking");
+	}
+}
+
+static TArray<TSharedPtr<FJsonValue>> MakeVectorArray(const FVector& Vector)
+{
+	TArray<TSharedPtr<FJsonValue>> Values;
+	Values.Add(MakeShared<FJsonValueNumber>(Vector.X));
+	Values.Add(MakeShared<FJsonValueNumber>(Vector.Y));
+	Values.Add(MakeShared<FJsonValueNumber>(Vector.Z));
+	return Values;
+}
+
+bool UARReplaySubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	// Only needed when replaying or recording.
+	const TCHAR* CommandLine = FCommandLine::Get();
+	return FCString::Strifind(CommandLine, TEXT("-ARReplay=")) || FCString::Strifind(CommandLine, TEXT("-ARRecord="));
+}
+
+void UARReplaySubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	PlaybackRate = 1.0f;
+	PlaybackTime = 0.0;
+	RecordTime = 0.0;
+
+	// Only game worlds drive the AR session.
+	UWorld* World = GetWorld();
+	if (!World || !World->IsGameWorld())
+	{
+		return;
+	}
+
+	FString ReplayPath;
+	if (FParse::Value(FCommandLine::Get(), TEXT("ARReplay="), ReplayPath))
+	{
+		FParse::Value(FCommandLine::Get(), TEXT("ARReplayRate="), PlaybackRate);
+
+		TSharedPtr<FARReplaySystem, ESPMode::ThreadSafe> System = MakeShared<FARReplaySystem, ESPMode::ThreadSafe>();
+		if (System->LoadSession(ReplayPath))
+		{
+			// Register before any actor begins play, so the AR manager starts its session against the replay.
+			System->SetWorld(World);
+			System->Register();
+			ReplaySystem = System;
+		}
+	}
+
+	FParse::Value(FCommandLine::Get(), TEXT("ARRecord="), RecordPath);
+}
+
+void UARReplaySubsystem::Deinitialize()
+{
+	// Write the recording out.
+	if (!RecordPath.IsEmpty() && RecordedFrames.Num() > 0)
+	{
+		TSharedRef<FJsonObject> Root = MakeShared<FJsonObject>();
+		Root->SetArrayField(TEXT("frames"), RecordedFrames);
+
+		FString Output;
+		TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&Output);
+		FJsonSerializer::Serialize(Root, Writer);
+
+		if (FFileHelper::SaveStringToFile(Output, *RecordPath))
+		{
+			UE_LOG(LogARReplaySubsystem, Log, TEXT("Recorded %d AR frames to %s"), RecordedFrames.Num(), *RecordPath);
+		}
+	}
+
+	// Hand AR back before the replay goes, so nothing is left calling into it once the world is torn down.
+	if (ReplaySystem.IsValid())
+	{
+		ReplaySystem->Unregister();
+		ReplaySystem.Reset();
+	}
+
+	Super::Deinitialize();
+}
+
+TStatId UARReplaySubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UARReplaySubsystem, STATGROUP_Tickables);
+}
+
+bool UARReplaySubsystem::IsReplayFinished() const
+{
+	return ReplaySystem.IsValid() && ReplaySystem->IsFinished();
+}
+
+// Called every frame
+void UARReplaySubsystem::Tick(float DeltaTime)
+{
+	if (ReplaySystem.IsValid())
+	{
+		// Advance playback, either at the chosen rate or one frame at a time.
+		if (PlaybackRate > 0.0f)
+		{
+			PlaybackTime += DeltaTime * PlaybackRate;
+			ReplaySystem->AdvanceTo(PlaybackTime);
+		}
+		else
+		{
+			ReplaySystem->AdvanceFrame();
+		}
+
+		// Move the camera to the recorded pose.
+		APawn* Pawn = UGameplayStatics::GetPlayerPawn(GetWorld(), 0);
+		if (Pawn)
+		{
+			Pawn->SetActorTransform(ReplaySystem->GetCameraPose());
+		}
+	}
+	else if (!RecordPath.IsEmpty())
+	{
+		RecordFrame(DeltaTime);
+	}
+}
+
+void UARReplaySubsystem::RecordFrame(float DeltaTime)
+{
+	if (UARBlueprintLibrary::GetARSessionStatus().Status != EARSessionStatus::Running)
+	{
+		return;
+	}
+
+	RecordTime += DeltaTime;
+
+	TSharedRef<FJsonObject> Frame = MakeShared<FJsonObject>();
+	Frame->SetNumberField(TEXT("time"), RecordTime);
+
+	// Camera pose.
+	APlayerCameraManager* CameraManager = UGameplayStatics::GetPlayerCameraManager(GetWorld(), 0);
+	if (CameraManager)
+	{
+		FTransform CameraTransform(CameraManager->GetCameraRotation(), CameraManager->GetCameraLocation());
+		Frame->SetObjectField(TEXT("camera"), MakeTransformObject(CameraTransform));
+	}
+
+	TArray<TSharedPtr<FJsonValue>> Planes;
+	TArray<TSharedPtr<FJsonValue>> Images;
+
+	// Only store geometries that were updated since the last recorded frame, and the planes subsuming them, so a
+	// subsumed plane's link always has a recorded plane to point to.
+	TArray<UARTrackedGeometry*> Changed;
+	for (UARTrackedGeometry* Geometry : UARBlueprintLibrary::GetAllGeometries())
+	{
+		uint32* LastFrameNumber = LastRecordedFrameNumbers.Find(Geometry);
+		if (!LastFrameNumber || *LastFrameNumber != Geometry->GetLastUpdateFrameNumber())
+		{
+			Changed.Add(Geometry);
+		}
+	}
+	for (int i = 0; i < Changed.Num(); i++)
+	{
+		UARPlaneGeometry* Plane = Cast<UARPlaneGeometry>(Changed[i]);
+		if (Plane && Plane->GetSubsumedBy() && !RecordedIds.Contains(Plane->GetSubsumedBy()))
+		{
+			Changed.AddUnique(Plane->GetSubsumedBy());
+		}
+	}
+
+	for (UARTrackedGeometry* Geometry : Changed)
+	{
+		LastRecordedFrameNumbers.Add(Geometry, Geometry->GetLastUpdateFrameNumber());
+
+		FString& Id = RecordedIds.FindOrAdd(Geometry);
+		if (Id.IsEmpty())
+		{
+			Id = FString::Printf(TEXT("%d"), RecordedIds.Num());
+		}
+
+		TSharedRef<FJsonObject> Entry = MakeShared<FJsonObject>();
+		Entry->SetStringField(TEXT("id"), Id);
+		Entry->SetStringField(TEXT("state"), TrackingStateToString(Geometry->GetTrackingState()));
+		Entry->SetObjectField(TEXT("transform"), MakeTransformObject(Geometry->GetLocalToTrackingTransform()));
+
+		if (UARPlaneGeometry* Plane = Cast<UARPlaneGeometry>(Geometry))
+		{
+			Entry->SetArrayField(TEXT("center"), MakeVectorArray(Plane->GetCenter()));
+			Entry->SetArrayField(TEXT("extent"), MakeVectorArray(Plane->GetExtent()));
+
+			TArray<TSharedPtr<FJsonValue>> Boundary;
+			for (const FVector& Point : Plane->GetBoundaryPolygonInLocalSpace())
+			{
+				Boundary.Add(MakeShared<FJsonValueArray>(MakeVectorArray(Point)));
+			}
+			Entry->SetArrayField(TEXT("boundary"), Boundary);
+
+			if (Plane->GetSubsumedBy())
+			{
+				// The subsumer is written in this frame if it hasn't been already.
+				FString& SubsumedId = RecordedIds.FindOrAdd(Plane->GetSubsumedBy());
+				if (SubsumedId.IsEmpty())
+				{
+					SubsumedId = FString::Printf(TEXT("%d"), RecordedIds.Num());
+				}
+				Entry->SetStringField(TEXT("subsumedBy"), SubsumedId);
+			}
+
+			Planes.Add(MakeShared<FJsonValueObject>(Entry));
+		}
+		else if (UARTrackedImage* Image = Cast<UARTrackedImage>(Geometry))
+		{
+			if (Image->GetDetectedImage())
+			{
+				Entry->SetStringField(TEXT("name"), Image->GetDetectedImage()->GetFriendlyName());
+			}
+			FVector2D Size = Image->GetEstimateSize();
+			Entry->SetArrayField(TEXT("size"), MakeVectorArray(FVector(Size.X, Size.Y, 0.0f)));
+
+			Images.Add(MakeShared<FJsonValueObject>(Entry));
+		}
+	}
+
+	// Pin tracking state changes, by creation order.
+	TArray<TSharedPtr<FJsonValue>> PinEvents;
+	TArray<UARPin*> Pins = UARBlueprintLibrary::GetAllPins();
+	for (int i = 0; i < Pins.Num(); i++)
+	{
+		uint8 State = (uint8)Pins[i]->GetTrackingState();
+		if (!LastPinStates.IsValidIndex(i))
+		{
+			LastPinStates.Add(State);
+			continue;
+		}
+
+		if (LastPinStates[i] != State)
+		{
+			LastPinStates[i] = State;
+
+			TSharedRef<FJsonObject> Entry = MakeShared<FJsonObject>();
+			Entry->SetNumberField(TEXT("index"), i);
+			Entry->SetStringField(TEXT("state"), TrackingStateToString(Pins[i]->GetTrackingState()));
+			Entry->SetObjectField(TEXT("transform"), MakeTransformObject(Pins[i]->GetLocalToTrackingTransform()));
+			PinEvents.Add(MakeShared<FJsonValueObject>(Entry));
+		}
+	}
+
+	if (Planes.Num() > 0)
+	{
+		Frame->SetArrayField(TEXT("planes"), Planes);
+	}
+	if (Images.Num() > 0)
+	{
+		Frame->SetArrayField(TEXT("images"), Images);
+	}
+	if (PinEvents.Num() > 0)
+	{
+		Frame->SetArrayField(TEXT("pins"), PinEvents);
+	}
+
+	RecordedFrames.Add(MakeShared<FJsonValueObject>(Frame));
+}
+
+TSharedRef<FJsonObject> UARReplaySubsystem::MakeTransformObject(const FTransform& Transform)
+{
+	TSharedRef<FJsonObject> Object = MakeShared<FJsonObject>();
+	Object->SetArrayField(TEXT("location"), MakeVectorArray(Transform.GetLocation()));
+
+	FQuat Rotation = Transform.GetRotation();
+	TArray<TSharedPtr<FJsonValue>> RotationValues;
+	RotationValues.Add(MakeShared<FJsonValueNumber>(Rotation.X));
+	RotationValues.Add(MakeShared<FJsonValueNumber>(Rotation.Y));
+	RotationValues.Add(MakeShared<FJsonValueNumber>(Rotation.Z));
+	RotationValues.Add(MakeShared<FJsonValueNumber>(Rotation.W));
+	Object->SetArrayField(TEXT("rotation"), RotationValues);
+
+	return Object;
+}
@@ -0,0 +1,615 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ARReplaySystem.h"
+#include "ARBlueprintLibrary.h"
+#include "ARTrackable.h"
+#include "ARPin.h"
+#include "ARTraceResult.h"
+#include "ARSessionConfig.h"
+#include "Misc/FileHelper.h"
+#include "Dom/JsonObject.h"
+#include "Serialization/JsonReader.h"
+#include "Serialization/JsonSerializer.h"
+#include "Kismet/GameplayStatics.h"
+#include "Engine/Engine.h"
+#include "IXRTrackingSystem.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogARReplay, Log, All);
+
+// Helpers for reading the session file.
+// *** //
+static FVector ReadVector(const TSharedPtr<FJsonObject>& Object, const FString& Field)
+{
+	const TArray<TSharedPtr<FJsonValue>>* Values;
+	if (Object->TryGetArrayField(Field, Values) && Values->Num() >= 3)
+	{
+		return FVector((*Values)[0]->AsNumber(), (*Values)[1]->AsNumber(), (*Values)[2]->AsNumber());
+	}
+	return FVector::ZeroVector;
+}
+
+static FVector ReadVector(const TSharedPtr<FJsonValue>& Value)
+{
+	const TArray<TSharedPtr<FJsonValue>>& Values = Value->AsArray();
+	if (Values.Num() >= 3)
+	{
+		return FVector(Values[0]->AsNumber(), Values[1]->AsNumber(), Values[2]->AsNumber());
+	}
+	return FVector::ZeroVector;
+}
+
+// Transforms are stored as { "location": [x, y, z], "rotation": [x, y, z, w] }.
+static FTransform ReadTransform(const TSharedPtr<FJsonObject>& Object, const FString& Field)
+{
+	const TSharedPtr<FJsonObject>* TransformObject;
+	if (!Object->TryGetObjectField(Field, TransformObject))
+	{
+		return FTransform::Identity;
+	}
+
+	FQuat Rotation = FQuat::Identity;
+	const TArray<TSharedPtr<FJsonValue>>* Values;
+	if ((*TransformObject)->TryGetArrayField(TEXT("rotation"), Values) && Values->Num() >= 4)
+	{
+		Rotation = FQuat((*Values)[0]->AsNumber(), (*Values)[1]->AsNumber(), (*Values)[2]->AsNumber(), (*Values)[3]->AsNumber());
+		Rotation.Normalize();
+	}
+
+	return FTransform(Rotation, ReadVector(*TransformObject, TEXT("location")));
+}
+
+static EARTrackingState ReadTrackingState(const TSharedPtr<FJsonObject>& Object)
+{
+	FString State;
+	if (Object->TryGetStringField(TEXT("state"), State))
+	{
+		if (State == TEXT("NotTracking"))
+		{
+			return EARTrackingState::NotTracking;
+		}
+		if (State == TEXT("StoppedTracking"))
+		{
+			return EARTrackingState::StoppedTracking;
+		}
+	}
+	return EARTrackingState::Tracking;
+}
+// *** //
+
+FARReplaySystem::FARReplaySystem()
+	: FXRTrackingSystemBase(this)
+{
+	NextFrame = 0;
+	FrameNumber = 0;
+	CurrentTime = 0.0;
+	PausedTime = 0.0;
+	SessionStatus = EARSessionStatus::NotStarted;
+	bIsPaused = false;
+}
+
+bool FARReplaySystem::LoadSession(const FString& Path)
+{
+	FString Contents;
+	if (!FFileHelper::LoadFileToString(Contents, *Path))
+	{
+		UE_LOG(LogARReplay, Error, TEXT("Could not read AR session file %s"), *Path);
+		return false;
+	}
+
+	TSharedPtr<FJsonObject> Root;
+	TSharedRef<TJsonReader<>> Reader = TJsonReaderFactory<>::Create(Contents);
+	if (!FJsonSerializer::Deserialize(Reader, Root) || !Root.IsValid())
+	{
+		UE_LOG(LogARReplay, Error, TEXT("Could not parse AR session file %s"), *Path);
+		return false;
+	}
+
+	// Parse everything up front so playback doesn't touch JSON.
+	Frames.Reset();
+	for (const TSharedPtr<FJsonValue>& FrameValue : Root->GetArrayField(TEXT("frames")))
+	{
+		const TSharedPtr<FJsonObject>& FrameObject = FrameValue->AsObject();
+		FARReplayFrame& Frame = Frames.AddDefaulted_GetRef();
+		Frame.Time = FrameObject->GetNumberField(TEXT("time"));
+
+		FString Status;
+		if (FrameObject->TryGetStringField(TEXT("status"), Status) && Status == TEXT("FatalError"))
+		{
+			Frame.Status = EARSessionStatus::FatalError;
+		}
+
+		if (FrameObject->HasField(TEXT("camera")))
+		{
+			Frame.bHasCameraPose = true;
+			Frame.CameraPose = ReadTransform(FrameObject, TEXT("camera"));
+		}
+
+		const TArray<TSharedPtr<FJsonValue>>* Values;
+		if (FrameObject->TryGetArrayField(TEXT("planes"), Values))
+		{
+			for (const TSharedPtr<FJsonValue>& PlaneValue : *Values)
+			{
+				const TSharedPtr<FJsonObject>& PlaneObject = PlaneValue->AsObject();
+				FARReplayPlane& Plane = Frame.Planes.AddDefaulted_GetRef();
+				Plane.Id = PlaneObject->GetStringField(TEXT("id"));
+				Plane.TrackingState = ReadTrackingState(PlaneObject);
+				Plane.LocalToTracking = ReadTransform(PlaneObject, TEXT("transform"));
+				Plane.Center = ReadVector(PlaneObject, TEXT("center"));
+				Plane.Extent = ReadVector(PlaneObject, TEXT("extent"));
+				PlaneObject->TryGetStringField(TEXT("subsumedBy"), Plane.SubsumedBy);
+
+				const TArray<TSharedPtr<FJsonValue>>* BoundaryValues;
+				if (PlaneObject->TryGetArrayField(TEXT("boundary"), BoundaryValues))
+				{
+					Plane.Boundary.Reserve(BoundaryValues->Num());
+					for (const TSharedPtr<FJsonValue>& PointValue : *BoundaryValues)
+					{
+						Plane.Boundary.Add(ReadVector(PointValue));
+					}
+				}
+			}
+		}
+
+		if (FrameObject->TryGetArrayField(TEXT("images"), Values))
+		{
+			for (const TSharedPtr<FJsonValue>& ImageValue : *Values)
+			{
+				const TSharedPtr<FJsonObject>& ImageObject = ImageValue->AsObject();
+				FARReplayImage& Image = Frame.Images.AddDefaulted_GetRef();
+				Image.Id = ImageObject->GetStringField(TEXT("id"));
+				ImageObject->TryGetStringField(TEXT("name"), Image.FriendlyName);
+				Image.TrackingState = ReadTrackingState(ImageObject);
+				Image.LocalToTracking = ReadTransform(ImageObject, TEXT("transform"));
+				FVector Size = ReadVector(ImageObject, TEXT("size"));
+				Image.EstimatedSize = FVector2D(Size.X, Size.Y);
+			}
+		}
+
+		if (FrameObject->TryGetArrayField(TEXT("pins"), Values))
+		{
+			for (const TSharedPtr<FJsonValue>& PinValue : *Values)
+			{
+				const TSharedPtr<FJsonObject>& PinObject = PinValue->AsObject();
+				FARReplayPinEvent& Pin = Frame.Pins.AddDefaulted_GetRef();
+				Pin.PinIndex = PinObject->GetIntegerField(TEXT("index"));
+				Pin.TrackingState = ReadTrackingState(PinObject);
+				Pin.bHasTransform = PinObject->HasField(TEXT("transform"));
+				Pin.LocalToTracking = ReadTransform(PinObject, TEXT("transform"));
+			}
+		}
+	}
+
+	// Frames must be in time order for playback.
+	Frames.StableSort([](const FARReplayFrame& A, const FARReplayFrame& B) { return A.Time < B.Time; });
+
+	UE_LOG(LogARReplay, Log, TEXT("Loaded %d AR frames (%.2fs) from %s"), Frames.Num(), GetDuration(), *Path);
+	return true;
+}
+
+void FARReplaySystem::Register()
+{
+	// The device backend registers its XR system's AR component, so that's what gets restored.
+	PreviousARSystem = GEngine && GEngine->XRSystem.IsValid() ? GEngine->XRSystem->GetARCompositionComponent() : nullptr;
+
+	TSharedPtr<FARSupportInterface, ESPMode::ThreadSafe> ARSystem = GetARCompositionComponent();
+	ARSystem->InitializeARSystem();
+	UARBlueprintLibrary::RegisterAsARSystem(ARSystem.ToSharedRef());
+	bIsRegistered = true;
+}
+
+void FARReplaySystem::Unregister()
+{
+	if (!bIsRegistered)
+	{
+		return;
+	}
+	bIsRegistered = false;
+	SessionStatus = EARSessionStatus::NotStarted;
+	bIsPaused = false;
+
+	if (PreviousARSystem.IsValid())
+	{
+		UARBlueprintLibrary::RegisterAsARSystem(PreviousARSystem.ToSharedRef());
+	}
+	PreviousARSystem.Reset();
+}
+
+void FARReplaySystem::AdvanceTo(double Time)
+{
+	// Time spent paused doesn't move the recording forward.
+	if (bIsPaused)
+	{
+		PausedTime = Time - CurrentTime;
+		return;
+	}
+	CurrentTime = Time - PausedTime;
+
+	// Don't consume frames until the game has started the session.
+	if (SessionStatus != EARSessionStatus::Running)
+	{
+		return;
+	}
+
+	while (NextFrame < Frames.Num() && Frames[NextFrame].Time <= CurrentTime)
+	{
+		ApplyFrame(Frames[NextFrame]);
+		NextFrame++;
+	}
+}
+
+void FARReplaySystem::AdvanceFrame()
+{
+	if (SessionStatus == EARSessionStatus::Running && NextFrame < Frames.Num())
+	{
+		CurrentTime = Frames[NextFrame].Time;
+		ApplyFrame(Frames[NextFrame]);
+		NextFrame++;
+	}
+}
+
+void FARReplaySystem::ApplyFrame(const FARReplayFrame& Frame)
+{
+	FrameNumber++;
+
+	if (Frame.bHasCameraPose)
+	{
+		CameraPose = Frame.CameraPose;
+	}
+
+	// Create the frame's new planes first, so planes can be linked to a subsumer that comes later in the frame.
+	TSet<FString> NewPlanes;
+	for (const FARReplayPlane& Plane : Frame.Planes)
+	{
+		if (!PlaneGeometries.Contains(Plane.Id))
+		{
+			UARPlaneGeometry* Geometry = NewObject<UARPlaneGeometry>();
+			Geometry->SetDebugName(FName(*Plane.Id));
+			PlaneGeometries.Add(Plane.Id, Geometry);
+			NewPlanes.Add(Plane.Id);
+		}
+	}
+
+	for (const FARReplayPlane& Plane : Frame.Planes)
+	{
+		ApplyPlane(Plane, NewPlanes.Contains(Plane.Id));
+	}
+
+	for (const FARReplayImage& Image : Frame.Images)
+	{
+		ApplyImage(Image);
+	}
+
+	for (const FARReplayPinEvent& Event : Frame.Pins)
+	{
+		if (AllPinsEverCreated.IsValidIndex(Event.PinIndex))
+		{
+			UARPin* Pin = AllPinsEverCreated[Event.PinIndex];
+			if (Event.bHasTransform)
+			{
+				Pin->OnTransformUpdated(Event.LocalToTracking);
+			}
+			Pin->OnTrackingStateChanged(Event.TrackingState);
+		}
+	}
+
+	// A recorded fatal error flips the session so the game's recovery path runs.
+	if (Frame.Status == EARSessionStatus::FatalError)
+	{
+		SessionStatus = EARSessionStatus::FatalError;
+	}
+}
+
+void FARReplaySystem::ApplyPlane(const FARReplayPlane& Plane, bool bIsNew)
+{
+	TSharedRef<FARSupportInterface, ESPMode::ThreadSafe> ARSystem = GetARCompositionComponent().ToSharedRef();
+	UARPlaneGeometry* Geometry = PlaneGeometries.FindChecked(Plane.Id);
+
+	// The recorder writes a subsumer in the same frame as the plane it subsumes, or earlier, and ApplyFrame creates the
+	// frame's planes before applying any, so the subsumer exists by now.
+	UARPlaneGeometry* SubsumedBy = nullptr;
+	if (!Plane.SubsumedBy.IsEmpty())
+	{
+		if (UARPlaneGeometry** Subsumer = PlaneGeometries.Find(Plane.SubsumedBy))
+		{
+			SubsumedBy = *Subsumer;
+		}
+	}
+
+	Geometry->UpdateTrackedGeometry(ARSystem, FrameNumber, CurrentTime, Plane.LocalToTracking, ARSystem->GetAlignmentTransform(), Plane.Center, Plane.Extent, Plane.Boundary, SubsumedBy);
+
+	if (bIsNew)
+	{
+		Geometry->SetTrackingState(Plane.TrackingState);
+		ARSystem->TriggerOnTrackableAddedDelegates(Geometry);
+	}
+	else
+	{
+		SetGeometryTrackingState(Geometry, Plane.TrackingState);
+		ARSystem->TriggerOnTrackableUpdatedDelegates(Geometry);
+	}
+}
+
+void FARReplaySystem::ApplyImage(const FARReplayImage& Image)
+{
+	TSharedRef<FARSupportInterface, ESPMode::ThreadSafe> ARSystem = GetARCompositionComponent().ToSharedRef();
+
+	UARTrackedImage** Found = ImageGeometries.Find(Image.Id);
+	bool bIsNew = Found == nullptr;
+	UARTrackedImage* Geometry = bIsNew ? NewObject<UARTrackedImage>() : *Found;
+
+	if (bIsNew)
+	{
+		Geometry->SetDebugName(FName(*Image.Id));
+		ImageGeometries.Add(Image.Id, Geometry);
+	}
+
+	Geometry->UpdateTrackedGeometry(ARSystem, FrameNumber, CurrentTime, Image.LocalToTracking, ARSystem->GetAlignmentTransform(), Image.EstimatedSize, FindOrAddCandidateImage(Image.FriendlyName, Image.EstimatedSize));
+
+	if (bIsNew)
+	{
+		Geometry->SetTrackingState(Image.TrackingState);
+		ARSystem->TriggerOnTrackableAddedDelegates(Geometry);
+	}
+	else
+	{
+		SetGeometryTrackingState(Geometry, Image.TrackingState);
+		ARSystem->TriggerOnTrackableUpdatedDelegates(Geometry);
+	}
+}
+
+void FARReplaySystem::SetGeometryTrackingState(UARTrackedGeometry* Geometry, EARTrackingState NewState)
+{
+	bool bWasStopped = Geometry->GetTrackingState() == EARTrackingState::StoppedTracking;
+	Geometry->SetTrackingState(NewState);
+
+	if (!bWasStopped && NewState == EARTrackingState::StoppedTracking)
+	{
+		GetARCompositionComponent()->TriggerOnTrackableRemovedDelegates(Geometry);
+	}
+}
+
+UARCandidateImage* FARReplaySystem::FindOrAddCandidateImage(const FString& FriendlyName, const FVector2D& Size)
+{
+	if (UARCandidateImage** Found = CandidateImages.Find(FriendlyName))
+	{
+		return *Found;
+	}
+
+	UARCandidateImage* Candidate = UARCandidateImage::CreateNewARCandidateImage(nullptr, FriendlyName, Size.X, Size.Y, EARCandidateImageOrientation::Landscape);
+	CandidateImages.Add(FriendlyName, Candidate);
+	return Candidate;
+}
+
+FName FARReplaySystem::GetSystemName() const
+{
+	static const FName ReplaySystemName(TEXT("ARReplay"));
+	return ReplaySystemName;
+}
+
+int32 FARReplaySystem::GetXRSystemFlags() const
+{
+	return EXRSystemFlags::IsAR;
+}
+
+bool FARReplaySystem::EnumerateTrackedDevices(TArray<int32>& OutDevices, EXRTrackedDeviceType Type)
+{
+	if (Type == EXRTrackedDeviceType::Any || Type == EXRTrackedDeviceType::HeadMountedDisplay)
+	{
+		OutDevices.Add(IXRTrackingSystem::HMDDeviceId);
+		return true;
+	}
+	return false;
+}
+
+bool FARReplaySystem::GetCurrentPose(int32 DeviceId, FQuat& OutOrientation, FVector& OutPosition)
+{
+	if (DeviceId != IXRTrackingSystem::HMDDeviceId)
+	{
+		return false;
+	}
+
+	OutOrientation = CameraPose.GetRotation();
+	OutPosition = CameraPose.GetLocation();
+	return true;
+}
+
+void FARReplaySystem::OnStartARSession(UARSessionConfig* SessionConfig)
+{
+	// A restarted session starts over from the first recorded frame, a resumed one carries on where it paused.
+	if (!bIsPaused && (SessionStatus == EARSessionStatus::FatalError || SessionStatus == EARSessionStatus::NotStarted))
+	{
+		OnStopARSession();
+	}
+	SessionStatus = EARSessionStatus::Running;
+	bIsPaused = false;
+}
+
+void FARReplaySystem::OnPauseARSession()
+{
+	if (SessionStatus == EARSessionStatus::Running)
+	{
+		SessionStatus = EARSessionStatus::NotStarted;
+		bIsPaused = true;
+	}
+}
+
+void FARReplaySystem::OnStopARSession()
+{
+	SessionStatus = EARSessionStatus::NotStarted;
+	bIsPaused = false;
+	NextFrame = 0;
+
+	for (auto& It : PlaneGeometries)
+	{
+		SetGeometryTrackingState(It.Value, EARTrackingState::StoppedTracking);
+	}
+	for (auto& It : ImageGeometries)
+	{
+		SetGeometryTrackingState(It.Value, EARTrackingState::StoppedTracking);
+	}
+	for (UARPin* Pin : Pins)
+	{
+		Pin->OnTrackingStateChanged(EARTrackingState::StoppedTracking);
+	}
+
+	PlaneGeometries.Empty();
+	ImageGeometries.Empty();
+	Pins.Empty();
+	AllPinsEverCreated.Empty();
+}
+
+void FARReplaySystem::OnSetAlignmentTransform(const FTransform& InAlignmentTransform)
+{
+	for (auto& It : PlaneGeometries)
+	{
+		It.Value->UpdateAlignmentTransform(InAlignmentTransform);
+	}
+	for (auto& It : ImageGeometries)
+	{
+		It.Value->UpdateAlignmentTransform(InAlignmentTransform);
+	}
+	for (UARPin* Pin : Pins)
+	{
+		Pin->UpdateAlignmentTransform(InAlignmentTransform);
+	}
+}
+
+TArray<FARTraceResult> FARReplaySystem::OnLineTraceTrackedObjects(const FVector2D ScreenCoord, EARLineTraceChannels TraceChannels)
+{
+	// Deproject the screen coordinate using the local player, then trace in world space.
+	UWorld* TraceWorld = World.Get();
+	APlayerController* PlayerController = TraceWorld ? UGameplayStatics::GetPlayerController(TraceWorld, 0) : nullptr;
+
+	FVector WorldPos;
+	FVector WorldDir;
+	if (!PlayerController || !UGameplayStatics::DeprojectScreenToWorld(PlayerController, ScreenCoord, WorldPos, WorldDir))
+	{
+		return TArray<FARTraceResult>();
+	}
+
+	return OnLineTraceTrackedObjects(WorldPos, WorldPos + WorldDir * 100000.0f, TraceChannels);
+}
+
+TArray<FARTraceResult> FARReplaySystem::OnLineTraceTrackedObjects(const FVector Start, const FVector End, EARLineTraceChannels TraceChannels)
+{
+	TArray<FARTraceResult> Results;
+
+	const bool bTestPolygon = !!(TraceChannels & EARLineTraceChannels::PlaneUsingBoundaryPolygon);
+	const bool bTestExtent = !!(TraceChannels & EARLineTraceChannels::PlaneUsingExtent);
+	if (!bTestPolygon && !bTestExtent)
+	{
+		return Results;
+	}
+
+	TSharedPtr<FARSupportInterface, ESPMode::ThreadSafe> ARSystem = GetARCompositionComponent();
+
+	for (auto& It : PlaneGeometries)
+	{
+		UARPlaneGeometry* Plane = It.Value;
+		if (Plane->GetTrackingState() != EARTrackingState::Tracking || Plane->GetSubsumedBy())
+		{
+			continue;
+		}
+
+		// Intersect the segment with the plane in the plane's local space, where the plane is Z = 0.
+		const FTransform& LocalToTracking = Plane->GetLocalToTrackingTransform();
+		FVector LocalStart = LocalToTracking.InverseTransformPosition(Start);
+		FVector LocalEnd = LocalToTracking.InverseTransformPosition(End);
+
+		if (FMath::Sign(LocalStart.Z) == FMath::Sign(LocalEnd.Z))
+		{
+			continue;
+		}
+
+		float Alpha = LocalStart.Z / (LocalStart.Z - LocalEnd.Z);
+		FVector LocalHit = FMath::Lerp(LocalStart, LocalEnd, Alpha);
+		LocalHit.Z = 0.0f;
+
+		bool bHit = false;
+		EARLineTraceChannels HitChannel = EARLineTraceChannels::None;
+
+		if (bTestPolygon)
+		{
+			// Even-odd point in polygon test against the boundary.
+			const TArray<FVector>& Boundary = Plane->GetBoundaryPolygonInLocalSpace();
+			bool bInside = false;
+			for (int i = 0, j = Boundary.Num() - 1; i < Boundary.Num(); j = i++)
+			{
+				if (((Boundary[i].Y > LocalHit.Y) != (Boundary[j].Y > LocalHit.Y)) &&
+					(LocalHit.X < (Boundary[j].X - Boundary[i].X) * (LocalHit.Y - Boundary[i].Y) / (Boundary[j].Y - Boundary[i].Y) + Boundary[i].X))
+				{
+					bInside = !bInside;
+				}
+			}
+			bHit = bInside;
+			HitChannel = EARLineTraceChannels::PlaneUsingBoundaryPolygon;
+		}
+
+		if (!bHit && bTestExtent)
+		{
+			FVector Offset = LocalHit - Plane->GetCenter();
+			bHit = FMath::Abs(Offset.X) <= Plane->GetExtent().X && FMath::Abs(Offset.Y) <= Plane->GetExtent().Y;
+			HitChannel = EARLineTraceChannels::PlaneUsingExtent;
+		}
+
+		if (bHit)
+		{
+			FTransform HitTransform(LocalToTracking.GetRotation(), LocalToTracking.TransformPosition(LocalHit));
+			float Distance = FVector::Distance(Start, HitTransform.GetLocation());
+			Results.Add(FARTraceResult(ARSystem, Distance, HitChannel, HitTransform, Plane));
+		}
+	}
+
+	// Closest hit first, matching the device backends.
+	Results.Sort([](const FARTraceResult& A, const FARTraceResult& B) { return A.GetDistanceFromCamera() < B.GetDistanceFromCamera(); });
+	return Results;
+}
+
+TArray<UARTrackedGeometry*> FARReplaySystem::OnGetAllTrackedGeometries() const
+{
+	TArray<UARTrackedGeometry*> Geometries;
+	Geometries.Reserve(PlaneGeometries.Num() + ImageGeometries.Num());
+
+	for (const auto& It : PlaneGeometries)
+	{
+		Geometries.Add(It.Value);
+	}
+	for (const auto& It : ImageGeometries)
+	{
+		Geometries.Add(It.Value);
+	}
+	return Geometries;
+}
+
+UARPin* FARReplaySystem::OnPinComponent(USceneComponent* ComponentToPin, const FTransform& PinToWorldTransform, UARTrackedGeometry* TrackedGeometry, const FName DebugName)
+{
+	TSharedRef<FARSupportInterface, ESPMode::ThreadSafe> ARSystem = GetARCompositionComponent().ToSharedRef();
+
+	// Tracking space is world space for the replay backend, apart from the alignment transform.
+	FTransform LocalToTracking = PinToWorldTransform * ARSystem->GetAlignmentTransform().Inverse();
+
+	UARPin* Pin = NewObject<UARPin>();
+	Pin->InitARPin(ARSystem, ComponentToPin, LocalToTracking, TrackedGeometry, DebugName);
+
+	Pins.Add(Pin);
+	AllPinsEverCreated.Add(Pin);
+	return Pin;
+}
+
+void FARReplaySystem::OnRemovePin(UARPin* PinToRemove)
+{
+	if (PinToRemove)
+	{
+		PinToRemove->OnTrackingStateChanged(EARTrackingState::StoppedTracking);
+		Pins.Remove(PinToRemove);
+	}
+}
+
+void FARReplaySystem::AddReferencedObjects(FReferenceCollector& Collector)
+{
+	Collector.AddReferencedObjects(PlaneGeometries);
+	Collector.AddReferencedObjects(ImageGeometries);
+	Collector.AddReferencedObjects(CandidateImages);
+	Collector.AddReferencedObjects(AllPinsEverCreated);
+}
@@ -0,0 +1,392 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Arena.h"
+#include "ArenaSpatialIndex.h"
+
+float FArenaRules::GetHitChance(float Distance, bool bObstructed) const
+{
+	float HitChance = FMath::GetMappedRangeValueClamped(FVector2D(MinRange, MaxRange), FVector2D(1.0f, 0.0f), Distance);
+	if (bObstructed)
+	{
+		HitChance = FMath::Max(HitChance - ObstructedHitPenalty, 0.0f);
+	}
+	return HitChance;
+}
+
+float FArenaRules::GetDamageMultiplier(bool bObstructed) const
+{
+	return bObstructed ? 1.0f - ObstructedDamagePenalty : 1.0f;
+}
+
+void FArenaRules::GetBlastDamage(const FVector& Blast, TArrayView<const FVector> Centers, TArrayView<const FVector> Extents, TArrayView<const FArenaObstacle> Obstacles, TArrayView<float> OutDamage) const
+{
+	check(Centers.Num() == Extents.Num() && Centers.Num() == OutDamage.Num());
+
+	// Falloff with the distance to the closest point of each fighter's box.
+	float RadiusSquared = GrenadeRadius * GrenadeRadius;
+	float FalloffPerUnit = GrenadeFalloff / FMath::Max(GrenadeRadius, KINDA_SMALL_NUMBER);
+	for (int i = 0; i < Centers.Num(); i++)
+	{
+		FVector Closest = Blast.BoundToBox(Centers[i] - Extents[i], Centers[i] + Extents[i]);
+		float DistSquared = FVector::DistSquared(Closest, Blast);
+		OutDamage[i] = DistSquared <= RadiusSquared ? GrenadeDamage * (1.0f - FalloffPerUnit * FMath::Sqrt(DistSquared)) : 0.0f;
+	}
+
+	// Cover, only for fighters the blast reached.
+	float Time;
+	float CoverMultiplier = GetDamageMultiplier(true);
+	for (int i = 0; i < Centers.Num(); i++)
+	{
+		if (OutDamage[i] <= 0.0f)
+		{
+			continue;
+		}
+
+		FVector Delta = Centers[i] - Blast;
+		for (const FArenaObstacle& Obstacle : Obstacles)
+		{
+			if (FArenaSpatialIndex::IntersectSegmentBox(Blast, Delta, Obstacle.Center, Obstacle.Extent, Time))
+			{
+				OutDamage[i] *= CoverMultiplier;
+				break;
+			}
+		}
+	}
+}
+
+int FArena::AddFighter(int Team, const FVector& Location, const FVector& Extent)
+{
+	FArenaFighter& Fighter = Fighters.AddDefaulted_GetRef();
+	Fighter.Team = Team;
+	Fighter.Location = Location;
+	Fighter.Extent = Extent;
+	Fighter.Health = Rules.MaxHealth;
+
+	// Slots count up within each team, matching the roster.
+	for (int i = 0; i < Fighters.Num() - 1; i++)
+	{
+		if (Fighters[i].Team == Team)
+		{
+			Fighter.Slot++;
+		}
+	}
+	return Fighters.Num() - 1;
+}
+
+void FArena::AddObstacle(const FVector& Center, const FVector& Extent)
+{
+	FArenaObstacle& Obstacle = Obstacles.AddDefaulted_GetRef();
+	Obstacle.Center = Center;
+	Obstacle.Extent = Extent;
+}
+
+void FArena::StartMatch()
+{
+	LastFighters.Init(INDEX_NONE, NumTeams);
+	CurrentTeam = NumTeams - 1;
+	CurrentFighter = INDEX_NONE;
+	TurnCount = 0;
+	bIsOver = false;
+	WinningTeam = INDEX_NONE;
+
+	// Everyone's first turn comes one interval in.
+	for (FArenaFighter& Fighter : Fighters)
+	{
+		Fighter.NextTurnTime = GetTurnInterval(Fighter);
+	}
+
+	UpdateOver();
+	if (!bIsOver)
+	{
+		StartNextTurn();
+	}
+}
+
+bool FArena::Shoot(int Target)
+{
+	// Only living enemies can be shot, once per turn.
+	if (!CanShoot(CurrentFighter) || !Fighters.IsValidIndex(Target) || Fighters[Target].bIsDead || Fighters[Target].Team == CurrentTeam)
+	{
+		return false;
+	}
+
+	bool bObstructed = IsObstructed(CurrentFighter, Target);
+	float HitChance = Rules.GetHitChance(FVector::Dist(Fighters[CurrentFighter].Location, Fighters[Target].Location), bObstructed);
+
+	if (Rules.RollHit(HitChance, Roll(CurrentFighter)))
+	{
+		ApplyDamage(Target, Rules.RollDamage(Rules.GetDamageMultiplier(bObstructed), Roll(CurrentFighter)));
+	}
+
+	Fighters[CurrentFighter].bHasShot = true;
+	return true;
+}
+
+bool FArena::Move(const FVector& Destination)
+{
+	if (bIsOver || !Fighters.IsValidIndex(CurrentFighter))
+	{
+		return false;
+	}
+
+	FArenaFighter& Fighter = Fighters[CurrentFighter];
+	float Remaining = Rules.MovableDistance - Fighter.DistanceMoved;
+	if (Remaining <= 0.0f)
+	{
+		return false;
+	}
+
+	// Fighters move along the ground, up to what's left of their allowance.
+	FVector Delta = Destination - Fighter.Location;
+	Delta.Z = 0.0f;
+	float Length = FMath::Min(Delta.Size(), Remaining);
+	if (Length < KINDA_SMALL_NUMBER)
+	{
+		return true;
+	}
+	FVector Direction = Delta.GetUnsafeNormal();
+
+	// Stop short of the first fighter or obstacle in the way, looking ahead like the fighter's trace does.
+	FVector Sweep = Direction * (Length + Rules.MoveLookahead);
+	float BlockTime = 1.0f;
+	float Time;
+
+	for (const FArenaObstacle& Obstacle : Obstacles)
+	{
+		if (FArenaSpatialIndex::IntersectSegmentBox(Fighter.Location, Sweep, Obstacle.Center, Obstacle.Extent, Time))
+		{
+			BlockTime = FMath::Min(BlockTime, Time);
+		}
+	}
+
+	for (int i = 0; i < Fighters.Num(); i++)
+	{
+		if (i != CurrentFighter && FArenaSpatialIndex::IntersectSegmentBox(Fighter.Location, Sweep, Fighters[i].Location, Fighters[i].Extent, Time))
+		{
+			BlockTime = FMath::Min(BlockTime, Time);
+		}
+	}
+
+	float Moved = FMath::Clamp(BlockTime * (Length + Rules.MoveLookahead) - Rules.MoveLookahead, 0.0f, Length);
+	Fighter.Location += Direction * Moved;
+	Fighter.DistanceMoved += Moved;
+	return true;
+}
+
+bool FArena::ThrowGrenade(const FVector& Landing)
+{
+	if (bIsOver || !Fighters.IsValidIndex(CurrentFighter) || !Fighters[CurrentFighter].bHasGrenade)
+	{
+		return false;
+	}
+
+	Fighters[CurrentFighter].bHasGrenade = false;
+
+	// Everyone in the blast takes damage, friendly fire included, as AGrenade::Explode works it out.
+	TArray<FVector, TInlineAllocator<MaxFighters>> Centers;
+	TArray<FVector, TInlineAllocator<MaxFighters>> Extents;
+	for (const FArenaFighter& Fighter : Fighters)
+	{
+		Centers.Add(Fighter.Location);
+		Extents.Add(Fighter.Extent);
+	}
+
+	TArray<float, TInlineAllocator<MaxFighters>> Damage;
+	Damage.SetNumUninitialized(Fighters.Num());
+	Rules.GetBlastDamage(Landing, Centers, Extents, Obstacles, Damage);
+
+	for (int i = 0; i < Fighters.Num(); i++)
+	{
+		if (!Fighters[i].bIsDead && Damage[i] > 0.0f)
+		{
+			ApplyDamage(i, Damage[i]);
+		}
+	}
+
+	return true;
+}
+
+void FArena::EndTurn()
+{
+	if (!bIsOver)
+	{
+		StartNextTurn();
+	}
+}
+
+bool FArena::Apply(const FArenaAction& Action)
+{
+	switch (Action.Type)
+	{
+	case EArenaActionType::Shoot:
+		return Shoot(Action.Target);
+	case EArenaActionType::Move:
+		return Move(Action.Location);
+	case EArenaActionType::Grenade:
+		return ThrowGrenade(Action.Location);
+	default:
+		EndTurn();
+		return true;
+	}
+}
+
+bool FArena::IsObstructed(int From, int To) const
+{
+	const FVector& Start = Fighters[From].Location;
+	FVector Delta = Fighters[To].Location - Start;
+
+	float Time;
+	for (const FArenaObstacle& Obstacle : Obstacles)
+	{
+		if (FArenaSpatialIndex::IntersectSegmentBox(Start, Delta, Obstacle.Center, Obstacle.Extent, Time))
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+float FArena::GetHitChance(int From, int To) const
+{
+	return Rules.GetHitChance(FVector::Dist(Fighters[From].Location, Fighters[To].Location), IsObstructed(From, To));
+}
+
+int FArena::GetAliveCount(int Team) const
+{
+	int Count = 0;
+	for (const FArenaFighter& Fighter : Fighters)
+	{
+		if (Fighter.Team == Team && !Fighter.bIsDead)
+		{
+			Count++;
+		}
+	}
+	return Count;
+}
+
+bool FArena::CanShoot(int Fighter) const
+{
+	return !bIsOver && Fighters.IsValidIndex(Fighter) && !Fighters[Fighter].bIsDead && !Fighters[Fighter].bHasShot;
+}
+
+void FArena::ApplyDamage(int Fighter, float Damage)
+{
+	// Damage is truncated, like AFighterPawn::ReceiveDamage.
+	FArenaFighter& Victim = Fighters[Fighter];
+	Victim.Health = FMath::Max(Victim.Health - FMath::TruncToFloat(Damage), 0.0f);
+
+	if (Victim.Health <= 0.0f && !Victim.bIsDead)
+	{
+		Victim.bIsDead = true;
+		UpdateOver();
+	}
+}
+
+void FArena::StartTurn(int Fighter)
+{
+	FArenaFighter& Next = Fighters[Fighter];
+	CurrentTeam = Next.Team;
+	CurrentFighter = Fighter;
+	if (LastFighters.IsValidIndex(Next.Team))
+	{
+		LastFighters[Next.Team] = Fighter;
+	}
+	Next.DistanceMoved = 0.0f;
+	Next.bHasShot = false;
+	TurnCount++;
+}
+
+float FArena::Roll(int Fighter)
+{
+	FArenaFighter& Roller = Fighters[Fighter];
+	return FMatchRandom::Roll(Seed, FMatchRandom::GetFighterStream(Roller.Team, Roller.Slot), Roller.Rolls++);
+}
+
+void FArena::StartNextTurn()
+{
+	if (bInitiativeOrder)
+	{
+		StartNextInitiativeTurn();
+		return;
+	}
+
+	CurrentFighter = INDEX_NONE;
+
+	for (int i = 1; i <= NumTeams; i++)
+	{
+		int Team = (CurrentTeam + i) % NumTeams;
+
+		// Carry on from the team's last fighter, wrapping round to find the next living one.
+		int Num = Fighters.Num();
+		int Start = LastFighters[Team];
+		for (int Step = 1; Step <= Num; Step++)
+		{
+			int Index = (Start + Step + Num) % Num;
+			const FArenaFighter& Fighter = Fighters[Index];
+			if (Fighter.Team != Team || Fighter.bIsDead)
+			{
+				continue;
+			}
+
+			StartTurn(Index);
+			return;
+		}
+	}
+}
+
+void FArena::StartNextInitiativeTurn()
+{
+	CurrentFighter = INDEX_NONE;
+
+	// Earliest time first, ties going in the order FInitiativeScheduler queues fighters in. There are few enough fighters
+	// that a scan is cheaper than keeping a heap.
+	int Next = INDEX_NONE;
+	int NextOrder = 0;
+	for (int i = 0; i < Fighters.Num(); i++)
+	{
+		const FArenaFighter& Fighter = Fighters[i];
+		if (Fighter.bIsDead)
+		{
+			continue;
+		}
+
+		int Order = Fighter.Slot * NumTeams + Fighter.Team;
+		if (Next == INDEX_NONE || Fighter.NextTurnTime < Fighters[Next].NextTurnTime || (Fighter.NextTurnTime == Fighters[Next].NextTurnTime && Order < NextOrder))
+		{
+			Next = i;
+			NextOrder = Order;
+		}
+	}
+
+	if (Next != INDEX_NONE)
+	{
+		Fighters[Next].NextTurnTime += GetTurnInterval(Fighters[Next]);
+		StartTurn(Next);
+	}
+}
+
+float FArena::GetTurnInterval(const FArenaFighter& Fighter)
+{
+	return 1.0f / FMath::Max(Fighter.Initiative, KINDA_SMALL_NUMBER);
+}
+
+void FArena::UpdateOver()
+{
+	int AliveTeams = 0;
+	int LastAliveTeam = INDEX_NONE;
+	for (int Team = 0; Team < NumTeams; Team++)
+	{
+		if (GetAliveCount(Team) > 0)
+		{
+			AliveTeams++;
+			LastAliveTeam = Team;
+		}
+	}
+
+	if (AliveTeams <= 1)
+	{
+		bIsOver = true;
+		WinningTeam = LastAliveTeam;
+	}
+}
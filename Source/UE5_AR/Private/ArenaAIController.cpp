@@ -0,0 +1,141 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ArenaAIController.h"
+#include "ArenaBot.h"
+
+// How far fighters can be from where pondering expected them for the ponder search to still count.
+static const float PredictionTolerance = 1.0f;
+
+void FArenaAIController::StartTurn(const FArena& State, float Budget)
+{
+	TimeLeft = Budget;
+
+	// Keep the ponder trees if the other teams played as predicted.
+	bool bPredicted = Phase == EPhase::Pondering && bHasPrediction && IsSameState(Prediction, State);
+	Phase = EPhase::Thinking;
+	bHasPrediction = false;
+	Search.Stop();
+
+	bLaunchPending = true;
+	bResumePending = bPredicted;
+	PendingRoot = State;
+	LaunchWhenIdle();
+}
+
+void FArenaAIController::StartPondering(const FArena& State)
+{
+	// Play the other teams' turns out with the bot to guess where the AI's next turn starts. The guess rolls with its own
+	// seed rather than the match's, so it can't see how the real shots will land.
+	Prediction = State;
+	Prediction.Seed = FMatchRandom::Hash(Seed, 0, State.TurnCount);
+	while (!Prediction.bIsOver && Prediction.CurrentFighter != INDEX_NONE && Prediction.CurrentTeam != Team)
+	{
+		FArenaBot::PlayTurn(Prediction);
+	}
+
+	if (Prediction.bIsOver || Prediction.CurrentFighter == INDEX_NONE)
+	{
+		Cancel();
+		return;
+	}
+
+	Phase = EPhase::Pondering;
+	bHasPrediction = true;
+	TimeLeft = PonderBudget;
+	Search.Stop();
+
+	bLaunchPending = true;
+	bResumePending = false;
+	PendingRoot = Prediction;
+	LaunchWhenIdle();
+}
+
+bool FArenaAIController::Poll(float DeltaSeconds, FArenaAction& OutAction)
+{
+	LaunchWhenIdle();
+
+	// The budget only starts once the search is actually running.
+	if (Phase == EPhase::Idle || bLaunchPending)
+	{
+		return false;
+	}
+
+	TimeLeft -= DeltaSeconds;
+
+	// Pondering stops once its budget is spent, keeping the trees in case the turn goes as predicted.
+	if (Phase == EPhase::Pondering)
+	{
+		if (TimeLeft <= 0.0f)
+		{
+			Search.Stop();
+		}
+		return false;
+	}
+
+	if (TimeLeft > 0.0f)
+	{
+		return false;
+	}
+
+	// Workers stop after their current iteration, so this is normally done by the next frame.
+	Search.Stop();
+	if (!Search.IsIdle())
+	{
+		return false;
+	}
+
+	Phase = EPhase::Idle;
+	if (!Search.GetBestAction(OutAction))
+	{
+		OutAction = FArenaAction();
+	}
+	return true;
+}
+
+void FArenaAIController::Cancel()
+{
+	Search.Stop();
+	Phase = EPhase::Idle;
+	bLaunchPending = false;
+	bHasPrediction = false;
+}
+
+bool FArenaAIController::IsSameState(const FArena& A, const FArena& B)
+{
+	if (A.Fighters.Num() != B.Fighters.Num() || A.CurrentFighter != B.CurrentFighter || A.bIsOver != B.bIsOver)
+	{
+		return false;
+	}
+
+	for (int i = 0; i < A.Fighters.Num(); i++)
+	{
+		const FArenaFighter& FighterA = A.Fighters[i];
+		const FArenaFighter& FighterB = B.Fighters[i];
+		if (FighterA.bIsDead != FighterB.bIsDead || FighterA.bHasGrenade != FighterB.bHasGrenade || !FMath::IsNearlyEqual(FighterA.Health, FighterB.Health)
+			|| !FighterA.Location.Equals(FighterB.Location, PredictionTolerance))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void FArenaAIController::LaunchWhenIdle()
+{
+	if (!bLaunchPending || !Search.IsIdle())
+	{
+		return;
+	}
+
+	bLaunchPending = false;
+	if (bResumePending)
+	{
+		Search.Resume();
+		return;
+	}
+
+	int Workers = NumWorkers > 0 ? NumWorkers : FMath::Clamp(FPlatformMisc::NumberOfCoresIncludingHyperthreads() - 1, 1, MaxDefaultWorkers);
+	Search.Start(PendingRoot, Workers, FMatchRandom::Hash(Seed, 1, PendingRoot.TurnCount));
+}
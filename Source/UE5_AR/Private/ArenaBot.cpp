@@ -0,0 +1,133 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ArenaBot.h"
+#include "Arena.h"
+
+void FArenaBot::PlayTurn(FArena& Arena)
+{
+	if (Arena.bIsOver || Arena.CurrentFighter == INDEX_NONE)
+	{
+		return;
+	}
+
+	FVector Landing;
+	if (FindGrenadeLanding(Arena, Landing))
+	{
+		Arena.ThrowGrenade(Landing);
+	}
+
+	// Close in if there's no decent shot yet.
+	float HitChance;
+	int Target = FindBestTarget(Arena, HitChance);
+	if (!Arena.bIsOver && HitChance < MinHitChance)
+	{
+		int Nearest = FindNearestEnemy(Arena);
+		if (Nearest != INDEX_NONE)
+		{
+			Arena.Move(Arena.Fighters[Nearest].Location);
+			Target = FindBestTarget(Arena, HitChance);
+		}
+	}
+
+	if (Target != INDEX_NONE)
+	{
+		Arena.Shoot(Target);
+	}
+
+	Arena.EndTurn();
+}
+
+bool FArenaBot::FindGrenadeLanding(const FArena& Arena, FVector& OutLanding)
+{
+	if (!Arena.Fighters.IsValidIndex(Arena.CurrentFighter) || !Arena.Fighters[Arena.CurrentFighter].bHasGrenade)
+	{
+		return false;
+	}
+
+	// Try landing on each enemy, scoring enemies caught less friends caught.
+	int Team = Arena.Fighters[Arena.CurrentFighter].Team;
+	float RadiusSquared = Arena.Rules.GrenadeRadius * Arena.Rules.GrenadeRadius;
+	int BestScore = 1;
+	bool bFound = false;
+
+	for (const FArenaFighter& Candidate : Arena.Fighters)
+	{
+		if (Candidate.bIsDead || Candidate.Team == Team)
+		{
+			continue;
+		}
+
+		int Score = 0;
+		for (const FArenaFighter& Fighter : Arena.Fighters)
+		{
+			FVector Closest = Candidate.Location.BoundToBox(Fighter.Location - Fighter.Extent, Fighter.Location + Fighter.Extent);
+			if (!Fighter.bIsDead && FVector::DistSquared(Closest, Candidate.Location) <= RadiusSquared)
+			{
+				Score += Fighter.Team == Team ? -1 : 1;
+			}
+		}
+
+		if (Score > BestScore)
+		{
+			BestScore = Score;
+			OutLanding = Candidate.Location;
+			bFound = true;
+		}
+	}
+
+	return bFound;
+}
+
+int FArenaBot::FindBestTarget(const FArena& Arena, float& OutHitChance)
+{
+	OutHitChance = 0.0f;
+	if (!Arena.Fighters.IsValidIndex(Arena.CurrentFighter))
+	{
+		return INDEX_NONE;
+	}
+
+	int Team = Arena.Fighters[Arena.CurrentFighter].Team;
+	int Best = INDEX_NONE;
+	for (int i = 0; i < Arena.Fighters.Num(); i++)
+	{
+		const FArenaFighter& Fighter = Arena.Fighters[i];
+		if (Fighter.bIsDead || Fighter.Team == Team)
+		{
+			continue;
+		}
+
+		float HitChance = Arena.GetHitChance(Arena.CurrentFighter, i);
+		if (Best == INDEX_NONE || HitChance > OutHitChance)
+		{
+			Best = i;
+			OutHitChance = HitChance;
+		}
+	}
+
+	return Best;
+}
+
+int FArenaBot::FindNearestEnemy(const FArena& Arena)
+{
+	if (!Arena.Fighters.IsValidIndex(Arena.CurrentFighter))
+	{
+		return INDEX_NONE;
+	}
+
+	const FArenaFighter& Self = Arena.Fighters[Arena.CurrentFighter];
+	int Nearest = INDEX_NONE;
+	float NearestDistSquared = BIG_NUMBER;
+	for (int i = 0; i < Arena.Fighters.Num(); i++)
+	{
+		const FArenaFighter& Fighter = Arena.Fighters[i];
+		float DistSquared = FVector::DistSquared(Fighter.Location, Self.Location);
+		if (!Fighter.bIsDead && Fighter.Team != Self.Team && DistSquared < NearestDistSquared)
+		{
+			Nearest = i;
+			NearestDistSquared = DistSquared;
+		}
+	}
+
+	return Nearest;
+}
@@ -0,0 +1,330 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ArenaSearch.h"
+#include "ArenaBot.h"
+
+FArenaSearch::FArenaSearch()
+	: bStopRequested(false)
+{
+}
+
+FArenaSearch::~FArenaSearch()
+{
+	// The workers point at this, so they have to be finished first.
+	Stop();
+	UE::Tasks::Wait(Tasks);
+}
+
+void FArenaSearch::Start(const FArena& InRoot, int NumWorkers, uint64 Seed)
+{
+	if (!ensure(IsIdle()))
+	{
+		return;
+	}
+
+	Root = InRoot;
+	Workers.Reset();
+
+	for (int i = 0; i < FMath::Max(NumWorkers, 1); i++)
+	{
+		TUniquePtr<FWorker>& Worker = Workers.Add_GetRef(MakeUnique<FWorker>());
+		Worker->Random = FMatchRandomStream(Seed, i);
+		Worker->Nodes.Reserve(4096);
+		Worker->Nodes.AddDefaulted();
+	}
+
+	LaunchWorkers();
+}
+
+void FArenaSearch::Resume()
+{
+	if (Workers.Num() > 0 && ensure(IsIdle()))
+	{
+		LaunchWorkers();
+	}
+}
+
+void FArenaSearch::Stop()
+{
+	bStopRequested = true;
+}
+
+bool FArenaSearch::IsIdle() const
+{
+	for (const UE::Tasks::FTask& Task : Tasks)
+	{
+		if (!Task.IsCompleted())
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+bool FArenaSearch::GetBestAction(FArenaAction& OutAction) const
+{
+	if (Workers.Num() == 0 || !IsIdle())
+	{
+		return false;
+	}
+
+	// Every worker's root has the same children in the same order, so visits can be summed by position.
+	const FNode& FirstRoot = Workers[0]->Nodes[0];
+	int BestChild = INDEX_NONE;
+	int BestVisits = -1;
+	for (int i = 0; i < FirstRoot.NumChildren; i++)
+	{
+		int Visits = 0;
+		for (const TUniquePtr<FWorker>& Worker : Workers)
+		{
+			const FNode& WorkerRoot = Worker->Nodes[0];
+			if (WorkerRoot.NumChildren == FirstRoot.NumChildren)
+			{
+				Visits += Worker->Nodes[WorkerRoot.FirstChild + i].Visits;
+			}
+		}
+
+		if (Visits > BestVisits)
+		{
+			BestVisits = Visits;
+			BestChild = i;
+		}
+	}
+
+	if (BestChild == INDEX_NONE)
+	{
+		return false;
+	}
+
+	OutAction = Workers[0]->Nodes[FirstRoot.FirstChild + BestChild].Action;
+	return true;
+}
+
+int64 FArenaSearch::GetIterations() const
+{
+	int64 Iterations = 0;
+	for (const TUniquePtr<FWorker>& Worker : Workers)
+	{
+		Iterations += Worker->Iterations;
+	}
+	return Iterations;
+}
+
+void FArenaSearch::GetActions(const FArena& Arena, FArenaActionList& OutActions)
+{
+	OutActions.Reset();
+	if (Arena.bIsOver || !Arena.Fighters.IsValidIndex(Arena.CurrentFighter))
+	{
+		return;
+	}
+
+	const FArenaFighter& Self = Arena.Fighters[Arena.CurrentFighter];
+
+	// Shoot, or throw the grenade at, any living enemy.
+	for (int i = 0; i < Arena.Fighters.Num(); i++)
+	{
+		const FArenaFighter& Fighter = Arena.Fighters[i];
+		if (Fighter.bIsDead || Fighter.Team == Self.Team)
+		{
+			continue;
+		}
+
+		if (Arena.CanShoot(Arena.CurrentFighter))
+		{
+			FArenaAction& Shoot = OutActions.AddDefaulted_GetRef();
+			Shoot.Type = EArenaActionType::Shoot;
+			Shoot.Target = i;
+		}
+
+		if (Self.bHasGrenade)
+		{
+			FArenaAction& Grenade = OutActions.AddDefaulted_GetRef();
+			Grenade.Type = EArenaActionType::Grenade;
+			Grenade.Location = Fighter.Location;
+		}
+	}
+
+	// Move towards the nearest enemy, away from them, to either side, or behind an obstacle.
+	float Remaining = Arena.Rules.MovableDistance - Self.DistanceMoved;
+	int Nearest = FArenaBot::FindNearestEnemy(Arena);
+	if (Remaining > 1.0f && Nearest != INDEX_NONE)
+	{
+		FVector EnemyLocation = Arena.Fighters[Nearest].Location;
+		FVector Forward = (EnemyLocation - Self.Location).GetSafeNormal2D();
+		FVector Right(-Forward.Y, Forward.X, 0.0f);
+
+		const FVector Directions[] = { Forward, -Forward, Right, -Right };
+		for (const FVector& Direction : Directions)
+		{
+			FArenaAction& Move = OutActions.AddDefaulted_GetRef();
+			Move.Type = EArenaActionType::Move;
+			Move.Location = Self.Location + Direction * Remaining;
+		}
+
+		for (const FArenaObstacle& Obstacle : Arena.Obstacles)
+		{
+			FVector Away = (Obstacle.Center - EnemyLocation).GetSafeNormal2D();
+			FVector Cover = Obstacle.Center + Away * (Obstacle.Extent.X + Self.Extent.X + Arena.Rules.MoveLookahead);
+			Cover.Z = Self.Location.Z;
+			if (FVector::Dist2D(Cover, Self.Location) <= Remaining)
+			{
+				FArenaAction& Move = OutActions.AddDefaulted_GetRef();
+				Move.Type = EArenaActionType::Move;
+				Move.Location = Cover;
+			}
+		}
+	}
+
+	// Doing nothing is always allowed.
+	OutActions.AddDefaulted();
+}
+
+void FArenaSearch::LaunchWorkers()
+{
+	bStopRequested = false;
+	Tasks.Reset();
+
+	for (const TUniquePtr<FWorker>& Worker : Workers)
+	{
+		FWorker* WorkerPtr = Worker.Get();
+		Tasks.Add(UE::Tasks::Launch(UE_SOURCE_LOCATION, [this, WorkerPtr]() { RunWorker(*WorkerPtr); }, UE::Tasks::ETaskPriority::BackgroundLow));
+	}
+}
+
+void FArenaSearch::RunWorker(FWorker& Worker)
+{
+	while (!bStopRequested)
+	{
+		Iterate(Worker);
+	}
+}
+
+void FArenaSearch::Iterate(FWorker& Worker)
+{
+	// Every iteration rolls with a fresh match seed, so it samples its own outcome of each action.
+	FArena State = Root;
+	State.Seed = Worker.Random.NextSeed();
+	TArray<int, TInlineAllocator<64>> Path;
+	FArenaActionList Actions;
+
+	// Walk down the tree, replaying each node's action with this iteration's rolls.
+	int NodeIndex = 0;
+	Path.Add(NodeIndex);
+	while (!State.bIsOver && State.CurrentFighter != INDEX_NONE)
+	{
+		if (Worker.Nodes[NodeIndex].NumChildren == 0)
+		{
+			// Expand nodes on their second visit, so one-off leaves don't take up room.
+			if ((NodeIndex != 0 && Worker.Nodes[NodeIndex].Visits == 0) || Worker.Nodes.Num() + Actions.Max() * 2 >= MaxNodes)
+			{
+				break;
+			}
+
+			GetActions(State, Actions);
+			Worker.Nodes[NodeIndex].FirstChild = Worker.Nodes.Num();
+			Worker.Nodes[NodeIndex].NumChildren = Actions.Num();
+			for (const FArenaAction& Action : Actions)
+			{
+				FNode& Child = Worker.Nodes.AddDefaulted_GetRef();
+				Child.Action = Action;
+				Child.Team = State.CurrentTeam;
+			}
+		}
+
+		// Pick a child by UCT. Unvisited children go first, starting from a random one so workers spread out.
+		const FNode& Node = Worker.Nodes[NodeIndex];
+		int Best = INDEX_NONE;
+		float BestScore = -BIG_NUMBER;
+		float LogVisits = FMath::Loge(FMath::Max(Node.Visits, 1));
+		int Offset = Worker.Random.RandHelper(Node.NumChildren);
+		for (int i = 0; i < Node.NumChildren; i++)
+		{
+			int ChildIndex = Node.FirstChild + (i + Offset) % Node.NumChildren;
+			const FNode& Child = Worker.Nodes[ChildIndex];
+			if (Child.Visits == 0)
+			{
+				Best = ChildIndex;
+				break;
+			}
+
+			float Score = Child.Value / Child.Visits + Exploration * FMath::Sqrt(LogVisits / Child.Visits);
+			if (Score > BestScore)
+			{
+				BestScore = Score;
+				Best = ChildIndex;
+			}
+		}
+
+		if (Best == INDEX_NONE)
+		{
+			break;
+		}
+
+		// Each node is a whole turn. An action that isn't allowed in this outcome just ends the turn.
+		const FArenaAction& Action = Worker.Nodes[Best].Action;
+		State.Apply(Action);
+		if (Action.Type != EArenaActionType::EndTurn)
+		{
+			State.EndTurn();
+		}
+
+		NodeIndex = Best;
+		Path.Add(NodeIndex);
+	}
+
+	// Play out a few turns and score the result.
+	for (int Turn = 0; Turn < RolloutTurns && !State.bIsOver && State.CurrentFighter != INDEX_NONE; Turn++)
+	{
+		FArenaBot::PlayTurn(State);
+	}
+
+	TArray<float, TInlineAllocator<FArena::MaxTeams>> Scores;
+	Evaluate(State, Scores);
+
+	for (int Index : Path)
+	{
+		FNode& Node = Worker.Nodes[Index];
+		Node.Visits++;
+		if (Scores.IsValidIndex(Node.Team))
+		{
+			Node.Value += Scores[Node.Team];
+		}
+	}
+
+	Worker.Iterations++;
+}
+
+void FArenaSearch::Evaluate(const FArena& Arena, TArray<float, TInlineAllocator<FArena::MaxTeams>>& OutScores)
+{
+	OutScores.Init(0.0f, Arena.NumTeams);
+
+	if (Arena.bIsOver)
+	{
+		if (OutScores.IsValidIndex(Arena.WinningTeam))
+		{
+			OutScores[Arena.WinningTeam] = 1.0f;
+		}
+		else
+		{
+			OutScores.Init(1.0f / Arena.NumTeams, Arena.NumTeams);
+		}
+		return;
+	}
+
+	// Unfinished, so score each team by its share of the health left.
+	float TotalHealth = 0.0f;
+	for (const FArenaFighter& Fighter : Arena.Fighters)
+	{
+		if (OutScores.IsValidIndex(Fighter.Team))
+		{
+			OutScores[Fighter.Team] += Fighter.Health;
+			TotalHealth += Fighter.Health;
+		}
+	}
+
+	for (float& Score : OutScores)
+	{
+		Score = TotalHealth > 0.0f ? Score / TotalHealth : 1.0f / Arena.NumTeams;
+	}
+}
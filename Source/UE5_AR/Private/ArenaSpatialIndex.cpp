@@ -0,0 +1,397 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ArenaSpatialIndex.h"
+
+// Where a segment enters a box, as a fraction along the segment. False if it misses.
+bool FArenaSpatialIndex::IntersectSegmentBox(const FVector& Start, const FVector& Delta, const FVector& Center, const FVector& Extent, float& OutTime)
+{
+	float TimeIn = 0.0f;
+	float TimeOut = 1.0f;
+
+	for (int Axis = 0; Axis < 3; Axis++)
+	{
+		float Min = Center[Axis] - Extent[Axis];
+		float Max = Center[Axis] + Extent[Axis];
+
+		if (FMath::IsNearlyZero(Delta[Axis]))
+		{
+			// Parallel to this slab, so must start inside it.
+			if (Start[Axis] < Min || Start[Axis] > Max)
+			{
+				return false;
+			}
+			continue;
+		}
+
+		float InvDelta = 1.0f / Delta[Axis];
+		float T0 = (Min - Start[Axis]) * InvDelta;
+		float T1 = (Max - Start[Axis]) * InvDelta;
+		if (T0 > T1)
+		{
+			Swap(T0, T1);
+		}
+
+		TimeIn = FMath::Max(TimeIn, T0);
+		TimeOut = FMath::Min(TimeOut, T1);
+		if (TimeIn > TimeOut)
+		{
+			return false;
+		}
+	}
+
+	OutTime = TimeIn;
+	return true;
+}
+
+FArenaSpatialIndex::FArenaSpatialIndex(float InCellSize)
+	: CellSize(FMath::Max(InCellSize, 1.0f))
+{
+	Reset();
+}
+
+void FArenaSpatialIndex::SetArenaTransform(const FTransform& InArenaTransform)
+{
+	ArenaTransform = InArenaTransform;
+	ArenaTransform.SetScale3D(FVector::OneVector);
+}
+
+void FArenaSpatialIndex::Update(AActor* Actor, EArenaEntryKind Kind, int Team, const FVector& WorldCenter, const FVector& Extent)
+{
+	int Index;
+	int* Found = EntryIndices.Find(Actor);
+	bool bIsNew = Found == nullptr;
+
+	if (Found)
+	{
+		Index = *Found;
+	}
+	else if (FreeEntries.Num() > 0)
+	{
+		Index = FreeEntries.Pop(false);
+		Entries[Index] = FArenaSpatialEntry();
+		EntryIndices.Add(Actor, Index);
+	}
+	else
+	{
+		Index = Entries.AddDefaulted();
+		EntryIndices.Add(Actor, Index);
+	}
+
+	FArenaSpatialEntry& Entry = Entries[Index];
+	Entry.Actor = Actor;
+	Entry.Kind = Kind;
+	Entry.Team = Team;
+	Entry.Center = ArenaTransform.InverseTransformPosition(WorldCenter);
+	Entry.Extent = Extent;
+	Entry.UpdateStamp = UpdateStamp;
+
+	// Only re-bucket when the covered cells change.
+	FIntPoint MinCell = GetCell(Entry.Center - Extent);
+	FIntPoint MaxCell = GetCell(Entry.Center + Extent);
+	if (bIsNew || MinCell != Entry.MinCell || MaxCell != Entry.MaxCell)
+	{
+		if (!bIsNew)
+		{
+			RemoveFromCells(Index);
+		}
+		Entry.MinCell = MinCell;
+		Entry.MaxCell = MaxCell;
+		AddToCells(Index);
+	}
+}
+
+void FArenaSpatialIndex::RemoveStale()
+{
+	for (auto It = EntryIndices.CreateIterator(); It; ++It)
+	{
+		if (Entries[It.Value()].UpdateStamp != UpdateStamp)
+		{
+			RemoveFromCells(It.Value());
+			Entries[It.Value()].Actor = nullptr;
+			FreeEntries.Add(It.Value());
+			It.RemoveCurrent();
+		}
+	}
+}
+
+void FArenaSpatialIndex::Remove(AActor* Actor)
+{
+	int Index;
+	if (EntryIndices.RemoveAndCopyValue(Actor, Index))
+	{
+		RemoveFromCells(Index);
+		Entries[Index].Actor = nullptr;
+		FreeEntries.Add(Index);
+	}
+}
+
+void FArenaSpatialIndex::Reset()
+{
+	Entries.Reset();
+	FreeEntries.Reset();
+	EntryIndices.Reset();
+	Cells.Reset();
+	MinOccupied = FIntPoint(MAX_int32, MAX_int32);
+	MaxOccupied = FIntPoint(MIN_int32, MIN_int32);
+}
+
+void FArenaSpatialIndex::QueryRadius(const FVector& WorldCenter, float Radius, TArray<const FArenaSpatialEntry*>& OutEntries, FFilter Filter)
+{
+	OutEntries.Reset();
+	QueryStamp++;
+
+	FVector Center = ArenaTransform.InverseTransformPosition(WorldCenter);
+	FIntPoint MinCell = GetCell(Center - FVector(Radius));
+	FIntPoint MaxCell = GetCell(Center + FVector(Radius));
+
+	// No need to look at cells nothing has been in.
+	MinCell = FIntPoint(FMath::Max(MinCell.X, MinOccupied.X), FMath::Max(MinCell.Y, MinOccupied.Y));
+	MaxCell = FIntPoint(FMath::Min(MaxCell.X, MaxOccupied.X), FMath::Min(MaxCell.Y, MaxOccupied.Y));
+
+	for (int X = MinCell.X; X <= MaxCell.X; X++)
+	{
+		for (int Y = MinCell.Y; Y <= MaxCell.Y; Y++)
+		{
+			const TArray<int>* Cell = Cells.Find(FIntPoint(X, Y));
+			if (!Cell)
+			{
+				continue;
+			}
+
+			for (int Index : *Cell)
+			{
+				FArenaSpatialEntry& Entry = Entries[Index];
+				if (Entry.QueryStamp == QueryStamp)
+				{
+					continue;
+				}
+				Entry.QueryStamp = QueryStamp;
+
+				// Sphere against box, using the closest point on the box.
+				FVector Closest = Center.BoundToBox(Entry.Center - Entry.Extent, Entry.Center + Entry.Extent);
+				if (FVector::DistSquared(Closest, Center) <= Radius * Radius && Filter(Entry))
+				{
+					OutEntries.Add(&Entry);
+				}
+			}
+		}
+	}
+}
+
+bool FArenaSpatialIndex::Raycast(const FVector& WorldStart, const FVector& WorldEnd, FArenaRayHit& OutHit, FFilter Filter)
+{
+	QueryStamp++;
+
+	FVector Start = ArenaTransform.InverseTransformPosition(WorldStart);
+	FVector End = ArenaTransform.InverseTransformPosition(WorldEnd);
+	FVector Delta = End - Start;
+
+	float BestTime = BIG_NUMBER;
+	const FArenaSpatialEntry* BestEntry = nullptr;
+
+	WalkCells(Start, End, [&](const TArray<int>& CellEntries, float ExitTime)
+	{
+		for (int Index : CellEntries)
+		{
+			FArenaSpatialEntry& Entry = Entries[Index];
+			if (Entry.QueryStamp == QueryStamp)
+			{
+				continue;
+			}
+			Entry.QueryStamp = QueryStamp;
+
+			float Time;
+			if (IntersectSegmentBox(Start, Delta, Entry.Center, Entry.Extent, Time) && Time < BestTime && Filter(Entry))
+			{
+				BestTime = Time;
+				BestEntry = &Entry;
+			}
+		}
+
+		// A hit before this cell's exit can't be beaten by later cells.
+		return BestTime > ExitTime;
+	});
+
+	if (!BestEntry)
+	{
+		return false;
+	}
+
+	OutHit.Entry = BestEntry;
+	OutHit.Location = ArenaTransform.TransformPosition(Start + Delta * BestTime);
+	OutHit.Distance = Delta.Size() * BestTime;
+	return true;
+}
+
+const FArenaSpatialEntry* FArenaSpatialIndex::FindNearest(const FVector& WorldLocation, FFilter Filter, float MaxDistance)
+{
+	if (EntryIndices.Num() == 0)
+	{
+		return nullptr;
+	}
+
+	QueryStamp++;
+
+	FVector Location = ArenaTransform.InverseTransformPosition(WorldLocation);
+	FIntPoint Center = GetCell(Location);
+
+	// Rings past the furthest occupied cell can't hold anything.
+	int MaxRing = FMath::Max(FMath::Max(FMath::Abs(Center.X - MinOccupied.X), FMath::Abs(MaxOccupied.X - Center.X)), FMath::Max(FMath::Abs(Center.Y - MinOccupied.Y), FMath::Abs(MaxOccupied.Y - Center.Y)));
+
+	float BestDistSquared = MaxDistance * MaxDistance;
+	const FArenaSpatialEntry* BestEntry = nullptr;
+
+	// Search outwards ring by ring. Anything in ring R is at least (R - 1) cells away.
+	for (int Ring = 0; Ring <= MaxRing; Ring++)
+	{
+		float RingDistance = (Ring - 1) * CellSize;
+		if (Ring > 1 && RingDistance * RingDistance > BestDistSquared)
+		{
+			break;
+		}
+
+		for (int X = Center.X - Ring; X <= Center.X + Ring; X++)
+		{
+			// Only the edge of the ring, the inside was searched already.
+			bool bEdgeColumn = X == Center.X - Ring || X == Center.X + Ring;
+			int StepY = bEdgeColumn ? 1 : FMath::Max(Ring * 2, 1);
+
+			for (int Y = Center.Y - Ring; Y <= Center.Y + Ring; Y += StepY)
+			{
+				const TArray<int>* Cell = Cells.Find(FIntPoint(X, Y));
+				if (!Cell)
+				{
+					continue;
+				}
+
+				for (int Index : *Cell)
+				{
+					FArenaSpatialEntry& Entry = Entries[Index];
+					if (Entry.QueryStamp == QueryStamp)
+					{
+						continue;
+					}
+					Entry.QueryStamp = QueryStamp;
+
+					float DistSquared = FVector::DistSquared(Entry.Center, Location);
+					if (DistSquared < BestDistSquared && Filter(Entry))
+					{
+						BestDistSquared = DistSquared;
+						BestEntry = &Entry;
+					}
+				}
+			}
+		}
+	}
+
+	return BestEntry;
+}
+
+bool FArenaSpatialIndex::IsSegmentBlocked(const FVector& LocalStart, const FVector& LocalEnd, FFilter Filter) const
+{
+	FVector Delta = LocalEnd - LocalStart;
+	bool bBlocked = false;
+
+	// Any hit will do. Entries spanning several cells may be tested more than once.
+	WalkCells(LocalStart, LocalEnd, [&](const TArray<int>& CellEntries, float ExitTime)
+	{
+		for (int Index : CellEntries)
+		{
+			const FArenaSpatialEntry& Entry = Entries[Index];
+
+			float Time;
+			if (Filter(Entry) && IntersectSegmentBox(LocalStart, Delta, Entry.Center, Entry.Extent, Time))
+			{
+				bBlocked = true;
+				return false;
+			}
+		}
+		return true;
+	});
+
+	return bBlocked;
+}
+
+void FArenaSpatialIndex::WalkCells(const FVector& LocalStart, const FVector& LocalEnd, FCellVisitor Visit) const
+{
+	FVector Delta = LocalEnd - LocalStart;
+	FIntPoint Cell = GetCell(LocalStart);
+	FIntPoint EndCell = GetCell(LocalEnd);
+
+	// Walk the cells under the segment in order (Amanatides & Woo).
+	int StepX = Delta.X > 0.0f ? 1 : -1;
+	int StepY = Delta.Y > 0.0f ? 1 : -1;
+	float TimeDeltaX = FMath::IsNearlyZero(Delta.X) ? BIG_NUMBER : CellSize / FMath::Abs(Delta.X);
+	float TimeDeltaY = FMath::IsNearlyZero(Delta.Y) ? BIG_NUMBER : CellSize / FMath::Abs(Delta.Y);
+	float TimeMaxX = FMath::IsNearlyZero(Delta.X) ? BIG_NUMBER : ((Cell.X + (StepX > 0 ? 1 : 0)) * CellSize - LocalStart.X) / Delta.X;
+	float TimeMaxY = FMath::IsNearlyZero(Delta.Y) ? BIG_NUMBER : ((Cell.Y + (StepY > 0 ? 1 : 0)) * CellSize - LocalStart.Y) / Delta.Y;
+
+	int MaxSteps = FMath::Abs(EndCell.X - Cell.X) + FMath::Abs(EndCell.Y - Cell.Y) + 1;
+	for (int Step = 0; Step < MaxSteps; Step++)
+	{
+		const TArray<int>* CellEntries = Cells.Find(Cell);
+		if (CellEntries && !Visit(*CellEntries, FMath::Min(TimeMaxX, TimeMaxY)))
+		{
+			break;
+		}
+
+		if (Cell == EndCell)
+		{
+			break;
+		}
+
+		if (TimeMaxX < TimeMaxY)
+		{
+			Cell.X += StepX;
+			TimeMaxX += TimeDeltaX;
+		}
+		else
+		{
+			Cell.Y += StepY;
+			TimeMaxY += TimeDeltaY;
+		}
+	}
+}
+
+const FArenaSpatialEntry* FArenaSpatialIndex::Find(const AActor* Actor) const
+{
+	const int* Index = EntryIndices.Find(Actor);
+	return Index ? &Entries[*Index] : nullptr;
+}
+
+FIntPoint FArenaSpatialIndex::GetCell(const FVector& LocalPosition) const
+{
+	return FIntPoint(FMath::FloorToInt(LocalPosition.X / CellSize), FMath::FloorToInt(LocalPosition.Y / CellSize));
+}
+
+void FArenaSpatialIndex::AddToCells(int Index)
+{
+	const FArenaSpatialEntry& Entry = Entries[Index];
+	for (int X = Entry.MinCell.X; X <= Entry.MaxCell.X; X++)
+	{
+		for (int Y = Entry.MinCell.Y; Y <= Entry.MaxCell.Y; Y++)
+		{
+			Cells.FindOrAdd(FIntPoint(X, Y)).Add(Index);
+		}
+	}
+
+	MinOccupied = FIntPoint(FMath::Min(MinOccupied.X, Entry.MinCell.X), FMath::Min(MinOccupied.Y, Entry.MinCell.Y));
+	MaxOccupied = FIntPoint(FMath::Max(MaxOccupied.X, Entry.MaxCell.X), FMath::Max(MaxOccupied.Y, Entry.MaxCell.Y));
+}
+
+void FArenaSpatialIndex::RemoveFromCells(int Index)
+{
+	// Empty cells are kept, so actors moving back and forth don't reallocate.
+	const FArenaSpatialEntry& Entry = Entries[Index];
+	for (int X = Entry.MinCell.X; X <= Entry.MaxCell.X; X++)
+	{
+		for (int Y = Entry.MinCell.Y; Y <= Entry.MaxCell.Y; Y++)
+		{
+			if (TArray<int>* Cell = Cells.Find(FIntPoint(X, Y)))
+			{
+				Cell->RemoveSingleSwap(Index, false);
+			}
+		}
+	}
+}
@@ -0,0 +1,231 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BalanceSweepCommandlet.h"
+#include "ArenaBot.h"
+#include "FighterPawn.h"
+#include "Obstacle.h"
+#include "Grenade.h"
+#include "Async/ParallelFor.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogBalanceSweep, Log, All);
+
+UBalanceSweepCommandlet::UBalanceSweepCommandlet()
+{
+	IsClient = false;
+	IsEditor = false;
+	IsServer = false;
+	LogToConsole = true;
+
+	// Default values, matching the game mode and actors.
+	NumTeams = 2;
+	ObstacleCount = 3;
+	MaxTurns = 500;
+	StartDistance = 120.0f;
+	FighterSpacing = 25.0f;
+}
+
+int32 UBalanceSweepCommandlet::Main(const FString& Params)
+{
+	int32 MatchesPerConfig = 1000;
+	uint64 Seed = 0;
+	FString OutputPath = FPaths::Combine(FPaths::ProfilingDir(), TEXT("BalanceSweep.csv"));
+	FParse::Value(*Params, TEXT("Matches="), MatchesPerConfig);
+	FParse::Value(*Params, TEXT("Seed="), Seed);
+	FParse::Value(*Params, TEXT("Teams="), NumTeams);
+	FParse::Value(*Params, TEXT("Obstacles="), ObstacleCount);
+	FParse::Value(*Params, TEXT("MaxTurns="), MaxTurns);
+	FParse::Value(*Params, TEXT("Output="), OutputPath);
+	NumTeams = FMath::Clamp(NumTeams, 2, FArena::MaxTeams);
+	ObstacleCount = FMath::Clamp(ObstacleCount, 0, FArena::MaxObstacles);
+
+	// Sizes come from the actors' defaults, scaled as the game mode places them, so the simulation matches the game.
+	const AFighterPawn* FighterDefaults = GetDefault<AFighterPawn>();
+	FighterExtent = FighterDefaults->GetArenaExtent() * FighterDefaults->GetScale();
+	ObstacleExtent = GetDefault<AObstacle>()->GetArenaExtent();
+	GrenadeScale = FighterDefaults->GetPlacedGrenadeScale();
+
+	// Every combination of the swept parameters.
+	// *** //
+	FArenaRules Defaults;
+	TArray<float> PawnsPerTeamValues = ParseList(Params, TEXT("PawnsPerTeam="), 3);
+	TArray<float> MinDamageValues = ParseList(Params, TEXT("MinDamage="), Defaults.MinDamage);
+	TArray<float> MaxDamageValues = ParseList(Params, TEXT("MaxDamage="), Defaults.MaxDamage);
+	TArray<float> ExplosionRadiusValues = ParseList(Params, TEXT("ExplosionRadius="), GetDefault<AGrenade>()->GetExplosionRadius());
+	TArray<float> MovableDistanceValues = ParseList(Params, TEXT("MovableDistance="), Defaults.MovableDistance);
+
+	TArray<FBalanceSweepConfig> Configs;
+	for (float PawnsPerTeam : PawnsPerTeamValues)
+	{
+		for (float MinDamage : MinDamageValues)
+		{
+			for (float MaxDamage : MaxDamageValues)
+			{
+				for (float ExplosionRadius : ExplosionRadiusValues)
+				{
+					for (float MovableDistance : MovableDistanceValues)
+					{
+						FBalanceSweepConfig& Config = Configs.AddDefaulted_GetRef();
+						Config.PawnsPerTeam = FMath::Clamp(FMath::RoundToInt(PawnsPerTeam), 1, FArena::MaxFighters / NumTeams);
+						Config.Rules.MinDamage = MinDamage;
+						Config.Rules.MaxDamage = FMath::Max(MinDamage, MaxDamage);
+						Config.Rules.MovableDistance = MovableDistance;
+						Config.Rules.GrenadeRadius = ExplosionRadius * GrenadeScale;
+						Config.ExplosionRadius = ExplosionRadius;
+					}
+				}
+			}
+		}
+	}
+	// *** //
+
+	int32 TotalMatches = Configs.Num() * MatchesPerConfig;
+	UE_LOG(LogBalanceSweep, Display, TEXT("Playing %d matches over %d configurations"), TotalMatches, Configs.Num());
+
+	// Every match is independent, so spread them all over the worker threads. Each match's seed is a roll numbered by
+	// the match, so results don't depend on how the work is split.
+	TArray<FBalanceSweepResult> Results;
+	Results.SetNum(TotalMatches);
+	double StartTime = FPlatformTime::Seconds();
+
+	ParallelFor(TotalMatches, [this, &Configs, &Results, MatchesPerConfig, Seed](int32 Match)
+	{
+		Results[Match] = PlayMatch(Configs[Match / MatchesPerConfig], FMatchRandom::Hash(Seed, 0, Match));
+	});
+
+	double Elapsed = FPlatformTime::Seconds() - StartTime;
+
+	// Sum up each configuration's matches.
+	FString Output = TEXT("PawnsPerTeam,MinDamage,MaxDamage,ExplosionRadius,MovableDistance,Matches");
+	for (int Team = 0; Team < NumTeams; Team++)
+	{
+		Output += FString::Printf(TEXT(",WinRate%d"), Team);
+	}
+	Output += TEXT(",DrawRate,UnfinishedRate,MeanTurns,MinTurns,MaxTurns\n");
+
+	int64 TotalTurns = 0;
+	for (int i = 0; i < Configs.Num(); i++)
+	{
+		const FBalanceSweepConfig& Config = Configs[i];
+		TArray<int> Wins;
+		Wins.Init(0, NumTeams);
+		int Draws = 0;
+		int Unfinished = 0;
+		int64 Turns = 0;
+		int MinMatchTurns = MAX_int32;
+		int MaxMatchTurns = 0;
+
+		for (int Match = i * MatchesPerConfig; Match < (i + 1) * MatchesPerConfig; Match++)
+		{
+			const FBalanceSweepResult& Result = Results[Match];
+			if (!Result.bFinished)
+			{
+				Unfinished++;
+			}
+			else if (Wins.IsValidIndex(Result.WinningTeam))
+			{
+				Wins[Result.WinningTeam]++;
+			}
+			else
+			{
+				Draws++;
+			}
+
+			Turns += Result.Turns;
+			MinMatchTurns = FMath::Min(MinMatchTurns, Result.Turns);
+			MaxMatchTurns = FMath::Max(MaxMatchTurns, Result.Turns);
+		}
+		TotalTurns += Turns;
+
+		float Count = FMath::Max(MatchesPerConfig, 1);
+		Output += FString::Printf(TEXT("%d,%g,%g,%g,%g,%d"), Config.PawnsPerTeam, Config.Rules.MinDamage, Config.Rules.MaxDamage, Config.ExplosionRadius, Config.Rules.MovableDistance, MatchesPerConfig);
+		for (int Team = 0; Team < NumTeams; Team++)
+		{
+			Output += FString::Printf(TEXT(",%.4f"), Wins[Team] / Count);
+		}
+		Output += FString::Printf(TEXT(",%.4f,%.4f,%.2f,%d,%d\n"), Draws / Count, Unfinished / Count, Turns / Count, MatchesPerConfig > 0 ? MinMatchTurns : 0, MaxMatchTurns);
+	}
+
+	if (!FFileHelper::SaveStringToFile(Output, *OutputPath))
+	{
+		UE_LOG(LogBalanceSweep, Error, TEXT("Could not write %s"), *OutputPath);
+		return 1;
+	}
+
+	UE_LOG(LogBalanceSweep, Display, TEXT("Played %d matches (%lld turns) in %.2fs, results written to %s"), TotalMatches, TotalTurns, Elapsed, *OutputPath);
+	return 0;
+}
+
+FBalanceSweepResult UBalanceSweepCommandlet::PlayMatch(const FBalanceSweepConfig& Config, uint64 Seed) const
+{
+	FArena Arena;
+	Arena.Seed = Seed;
+	SetupArena(Arena, Config);
+	Arena.StartMatch();
+
+	while (!Arena.bIsOver && Arena.CurrentFighter != INDEX_NONE && Arena.TurnCount < MaxTurns)
+	{
+		FArenaBot::PlayTurn(Arena);
+	}
+
+	FBalanceSweepResult Result;
+	Result.bFinished = Arena.bIsOver;
+	Result.WinningTeam = Arena.WinningTeam;
+	Result.Turns = Arena.TurnCount;
+	return Result;
+}
+
+void UBalanceSweepCommandlet::SetupArena(FArena& Arena, const FBalanceSweepConfig& Config) const
+{
+	Arena.Rules = Config.Rules;
+	Arena.NumTeams = NumTeams;
+
+	// Each team starts on a line facing the middle, spread evenly round it.
+	for (int Team = 0; Team < NumTeams; Team++)
+	{
+		float Angle = 2.0f * PI * Team / NumTeams;
+		FVector Forward(FMath::Cos(Angle), FMath::Sin(Angle), 0.0f);
+		FVector Right(-Forward.Y, Forward.X, 0.0f);
+
+		for (int i = 0; i < Config.PawnsPerTeam; i++)
+		{
+			float Across = (i - (Config.PawnsPerTeam - 1) * 0.5f) * FighterSpacing;
+			FVector Location = Forward * StartDistance + Right * Across;
+			Location.Z = FighterExtent.Z;
+			Arena.AddFighter(Team, Location, FighterExtent);
+		}
+	}
+
+	// Obstacles go somewhere in the middle, between the teams, rolled from the stream that isn't any fighter's.
+	FMatchRandomStream Random(Arena.Seed, 0);
+	float Spread = StartDistance * 0.6f;
+	for (int i = 0; i < ObstacleCount; i++)
+	{
+		FVector Center(Random.FRandRange(-Spread, Spread), Random.FRandRange(-Spread, Spread), ObstacleExtent.Z);
+		Arena.AddObstacle(Center, ObstacleExtent);
+	}
+}
+
+TArray<float> UBalanceSweepCommandlet::ParseList(const FString& Params, const TCHAR* Name, float Default)
+{
+	TArray<float> Values;
+
+	FString List;
+	if (FParse::Value(*Params, Name, List, false))
+	{
+		TArray<FString> Parts;
+		List.ParseIntoArray(Parts, TEXT(","));
+		for (const FString& Part : Parts)
+		{
+			Values.Add(FCString::Atof(*Part));
+		}
+	}
+
+	if (Values.Num() == 0)
+	{
+		Values.Add(Default);
+	}
+	return Values;
+}
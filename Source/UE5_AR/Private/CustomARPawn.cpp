@@ -6,6 +6,7 @@
 #include "ARBlueprintLibrary.h"
 #include "Camera/CameraComponent.h"
 #include "CustomGameMode.h"
+#include "MatchRegistrySubsystem.h"
 #include "Kismet/KismetMathLibrary.h"
 #include "Runtime/Engine/Classes/Kismet/GameplayStatics.h"
 
@@ -30,6 +31,7 @@ void ACustomARPawn::BeginPlay()
 {
 	Super::BeginPlay();
 
+	Registry = GetWorld()->GetSubsystem<UMatchRegistrySubsystem>();
 }
 
 // Called every frame
@@ -38,11 +40,10 @@ void ACustomARPawn::Tick(float DeltaTime)
 	Super::Tick(DeltaTime);
 
 	// Get game mode.
-	auto Temp = GetWorld()->GetAuthGameMode();
-	auto GM = Cast<ACustomGameMode>(Temp);
+	ACustomGameMode* GM = Registry->GetGameMode();
 
 	// If player is in grenade throw phase...
-	if (GM->CurrentPhase == EGamePhase::TURN_GRENADE)
+	if (GM && GM->CurrentPhase == EGamePhase::TURN_GRENADE && !GM->IsAITurn())
 	{
 		// Create a rotator based on direction between touches, and rotate the fighter using this.
 		FVector Dir = UKismetMathLibrary::GetDirectionUnitVector(TouchStart, TouchEnd);
@@ -50,9 +51,53 @@ void ACustomARPawn::Tick(float DeltaTime)
 		FRotator Rot = Dir.Rotation();
 		Rot.Add(0, 90, 0);
 		GM->CurrentFighter->SetActorRotation(Rot);
+
+		// Show where the grenade would go, only while dragging a throw. The touch on the grenade button isn't one.
+		if (bIsScreenTouched && !bGrenadeButtonPressed)
+		{
+			UpdateGrenadePreview(GM->CurrentFighter);
+		}
+		else
+		{
+			HideGrenadePreview();
+		}
+	}
+	else
+	{
+		HideGrenadePreview();
+	}
+}
+
+void ACustomARPawn::UpdateGrenadePreview(AFighterPawn* Fighter)
+{
+	// Only work the arc out again when the drag changes.
+	FVector Drag = TouchEnd - TouchStart;
+	if (GrenadePreviewFighter == Fighter && Drag.Equals(GrenadePreviewDrag))
+	{
+		return;
+	}
+
+	HideGrenadePreview();
+	GrenadePreviewFighter = Fighter;
+	GrenadePreviewDrag = Drag;
+
+	// Drags too short to throw show nothing. The fighter throws with the drag's length.
+	float Dist = Drag.Size();
+	if (Dist > MinThrowDrag)
+	{
+		Fighter->PreviewGrenade(FVector(Dist));
 	}
 }
 
+void ACustomARPawn::HideGrenadePreview()
+{
+	if (GrenadePreviewFighter.IsValid())
+	{
+		GrenadePreviewFighter->HideGrenadePreview();
+	}
+	GrenadePreviewFighter = nullptr;
+}
+
 // Called to bind functionality to input
 void ACustomARPawn::SetupPlayerInputComponent(UInputComponent* PlayerInputComponent)
 {
@@ -66,9 +111,12 @@ void ACustomARPawn::SetupPlayerInputComponent(UInputComponent* PlayerInputCompon
 
 void ACustomARPawn::OnScreenTouch(const ETouchIndex::Type FingerIndex, const FVector ScreenPos)
 {
-	// Get game mode.
-	auto Temp = GetWorld()->GetAuthGameMode();
-	auto GM = Cast<ACustomGameMode>(Temp);
+	// Get game mode. The AI's fighters can't be played.
+	ACustomGameMode* GM = Registry->GetGameMode();
+	if (!GM || GM->IsAITurn())
+	{
+		return;
+	}
 
 	// Start tracking touch.
 	bIsScreenTouched = true;
@@ -119,8 +167,11 @@ void ACustomARPawn::OnScreenTouchHeld(const ETouchIndex::Type FingerIndex, const
 void ACustomARPawn::OnScreenTouchReleased(const ETouchIndex::Type FingerIndex, const FVector ScreenPos)
 {
 	// Get game mode.
-	auto Temp = GetWorld()->GetAuthGameMode();
-	auto GM = Cast<ACustomGameMode>(Temp);
+	ACustomGameMode* GM = Registry->GetGameMode();
+	if (!GM)
+	{
+		return;
+	}
 
 	// Finish tracking touch.
 	bIsScreenTouched = false;
@@ -133,7 +184,7 @@ void ACustomARPawn::OnScreenTouchReleased(const ETouchIndex::Type FingerIndex, c
 	{
 		bGrenadeButtonPressed = false;
 	}
-	else if (GM->CurrentPhase == EGamePhase::TURN_GRENADE) // If in the grenade phase...
+	else if (GM->CurrentPhase == EGamePhase::TURN_GRENADE && !GM->IsAITurn()) // If in the grenade phase, on a player's turn...
 	{
 		// Get distance between
 		float Dist = FVector::Distance(TouchStart, TouchEnd);
@@ -141,7 +192,7 @@ void ACustomARPawn::OnScreenTouchReleased(const ETouchIndex::Type FingerIndex, c
 		//GEngine->AddOnScreenDebugMessage(-1, 5.0f, FColor::Red, FString::Printf(TEXT("Distance: %f"), Dist));
 
 		// If drag is long enough, throw grenade.
-		if (abs(Dist) > 50)
+		if (abs(Dist) > MinThrowDrag)
 		{
 			GM->CurrentFighter->ThrowGrenade(FVector(Dist));
 			GM->CurrentPhase = EGamePhase::TURN_IDLE;
@@ -7,10 +7,15 @@
 #include "ARPlaneActor.h"
 #include "HelloARManager.h"
 #include "ARPin.h"
+#include "ARPinManager.h"
+#include "MatchRegistrySubsystem.h"
+#include "Grenade.h"
 #include "ARBlueprintLibrary.h"
 #include "Runtime/Engine/Classes/Kismet/GameplayStatics.h"
 #include "Kismet/KismetMathLibrary.h"
 
+DEFINE_LOG_CATEGORY_STATIC(LogCustomGameMode, Log, All);
+
 ACustomGameMode::ACustomGameMode()
 {
 	// Add this line to your code if you wish to use the Tick() function
@@ -25,10 +30,27 @@ ACustomGameMode::ACustomGameMode()
 	bIsRedTurn = true;
 	bHasRedWon = false;
 	bHasBlueWon = false;
-	RedTurnCounter = 0;
-	BlueTurnCounter = 0;
+	WinningTeam = INDEX_NONE;
+	CurrentTeam = 0;
+	AliveTeams = 0;
+	CurrentSeed = 0;
+	MatchSeed = 0;
 	PawnsPerTeam = 3;
 	ObstacleLimit = 3;
+	bUseArenaAnchor = true;
+	NumTeams = 2;
+	TurnOrder = ETurnOrder::ROUND_ROBIN;
+	TeamColors = { FColor::Red, FColor::Blue, FColor::Green, FColor::Yellow };
+	AITeam = INDEX_NONE;
+	AITurnTime = 1.0f;
+	bAIPonder = true;
+	AIMaxGrenadeDrag = 1000.0f;
+	TargetSnapDistance = 0.0f;
+	bAIWaitingForMove = false;
+	bIsAIActing = false;
+	bDeferWinner = false;
+	GrenadePoolSize = 2;
+	bBallisticGrenades = false;
 
 	// Create menu widget.
 	ConstructorHelpers::FClassFinder<UUserWidget> MenuWidgetClass(TEXT("WidgetBlueprint'/Game/MenuWidget.MenuWidget_C'"));
@@ -42,13 +64,23 @@ ACustomGameMode::ACustomGameMode()
 
 void ACustomGameMode::StartPlay() 
 {
+	// Register first, so actors can find the game mode as they begin play.
+	GetWorld()->GetSubsystem<UMatchRegistrySubsystem>()->RegisterGameMode(this);
+
 	SpawnInitialActors();
+	ResetTeams();
 
 	// This is called before BeginPlay
 	StartPlayEvent();
 
 	// This function will transcend to call BeginPlay on all the actors 
 	Super::StartPlay();
+
+	// Spawn grenades now rather than mid-throw.
+	for (int i = GrenadePool.Num(); i < GrenadePoolSize; i++)
+	{
+		GrenadePool.Add(GetWorld()->SpawnActor<AGrenade>());
+	}
 	
 	// Add menu to the viewport.
 	if (MenuWidget)
@@ -57,6 +89,14 @@ void ACustomGameMode::StartPlay()
 	}
 }
 
+void ACustomGameMode::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	GetWorld()->GetSubsystem<UMatchRegistrySubsystem>()->UnregisterGameMode(this);
+	Journal.Close();
+
+	Super::EndPlay(EndPlayReason);
+}
+
 // An implementation of the StartPlayEvent which can be triggered by calling StartPlayEvent() 
 void ACustomGameMode::StartPlayEvent_Implementation() 
 {
@@ -75,6 +115,22 @@ void ACustomGameMode::StartGame()
 
 	// Red goes first.
 	bIsRedTurn = true;
+	ResetTeams();
+
+	// Pick the match's seed. The AI searches with its own seeds derived from it.
+	// Logged so a match can be played again by setting MatchSeed to it.
+	CurrentSeed = MatchSeed != 0 ? uint64(MatchSeed) : FMatchRandom::MakeSeed();
+	AI.Seed = CurrentSeed;
+	UE_LOG(LogCustomGameMode, Log, TEXT("Match seed %lld"), int64(CurrentSeed));
+
+	// Record the match if asked to, without overwriting earlier matches' journals.
+	FString JournalPath;
+	if (FParse::Value(FCommandLine::Get(), TEXT("MatchJournal="), JournalPath))
+	{
+		FString MatchSuffix = FString::Printf(TEXT("_%s_%lld"), *FDateTime::Now().ToString(), int64(CurrentSeed));
+		JournalPath = FPaths::GetBaseFilename(JournalPath, false) + MatchSuffix + FPaths::GetExtension(JournalPath, true);
+		Journal.Open(JournalPath, CurrentSeed, Teams.Num());
+	}
 
 	// Select plane phase.
 	CurrentPhase = EGamePhase::PLANE_SETUP;
@@ -82,75 +138,65 @@ void ACustomGameMode::StartGame()
 
 void ACustomGameMode::StartTurn()
 {
-	// Red turn.
-	if (bIsRedTurn)
+	// Ask the scheduler who's next. No one left to play means the game is over.
+	FTurnSlot Turn = Scheduler ? Scheduler->Next(Teams) : FTurnSlot();
+	if (!Turn.IsValid())
 	{
-		// Set selected pawn.
-		CurrentFighter = RedTeamActors[RedTurnCounter];
-
-		// If selected pawn is dead, select a new pawn.
-		int LoopNo = 0;
-		while (CurrentFighter->GetIsDead() || LoopNo < PawnsPerTeam) // just in case to avoid infinite loop, exit after some iterations
-		{
-			RedTurnCounter++;
-			if (RedTurnCounter > (PawnsPerTeam - 1))
-			{
-				RedTurnCounter = 0;
-			}
-			CurrentFighter = RedTeamActors[RedTurnCounter];
-			LoopNo++;
-		}
+		return;
 	}
-	else // Blue turn.
-	{
-		// Set selected pawn.
-		CurrentFighter = BlueTeamActors[BlueTurnCounter];
-		
-		// If selected pawn is dead, select a new pawn.
-		int LoopNo = 0;
-		while (CurrentFighter->GetIsDead() || LoopNo < PawnsPerTeam) // just in case to avoid infinite loop, exit after some iterations
-		{
-			BlueTurnCounter++;
-			if (BlueTurnCounter > (PawnsPerTeam - 1))
-			{
-				BlueTurnCounter = 0;
-			}
-			CurrentFighter = BlueTeamActors[BlueTurnCounter];
-			LoopNo++;
-		}
 
-	}
+	CurrentTeam = Turn.Team;
+	bIsRedTurn = CurrentTeam == 0;
+	CurrentFighter = Teams[Turn.Team].GetFighter(Turn.Slot);
 
 	// Prepare fighter for the turn.
 	CurrentFighter->SetSelectionState(ESelectionState::SELECTED);
 	CurrentFighter->TurnReset();
+
+	// Journal the turn, with the whole arena when a keyframe is due.
+	if (Journal.IsOpen())
+	{
+		FMatchJournalRecord Record;
+		Record.Type = EMatchJournalRecord::StartTurn;
+		Record.Team = Turn.Team;
+		Record.Slot = Turn.Slot;
+
+		FArena State;
+		CaptureArena(State);
+		Journal.WriteStartTurn(Record, State);
+	}
+
+	UpdateAIForTurn();
 }
 
 void ACustomGameMode::EndTurn()
 {
-	// Deselect fighter.
-	CurrentFighter->SetSelectionState(ESelectionState::NONE);
-
-	// Increase counter for relevant team, change to next team for the next turn.
-	if (bIsRedTurn)
+	// The AI ends its own turns.
+	if (!CanTakeTurnAction())
 	{
-		RedTurnCounter++;
-		if (RedTurnCounter > (PawnsPerTeam - 1)) // -1 because start counting at 0
-		{
-			RedTurnCounter = 0;
-		}
-		bIsRedTurn = false;
+		return;
 	}
-	else
+
+	// However the turn ended, nothing the AI was waiting on should end the next one.
+	GetWorldTimerManager().ClearTimer(AITurnEndTimer);
+	bAIWaitingForMove = false;
+
+	// Journal where the fighter ended up.
+	if (Journal.IsOpen())
 	{
-		BlueTurnCounter++;
-		if (BlueTurnCounter > (PawnsPerTeam - 1))
-		{
-			BlueTurnCounter = 0;
-		}
-		bIsRedTurn = true;
+		FArenaFighter State = CurrentFighter->GetArenaState(SpatialIndex.GetArenaTransform());
+		FMatchJournalRecord Record;
+		Record.Type = EMatchJournalRecord::EndTurn;
+		Record.Team = State.Team;
+		Record.Slot = State.Slot;
+		Record.Location = State.Location;
+		Record.Value = State.DistanceMoved;
+		Journal.Write(Record);
 	}
 
+	// Deselect fighter.
+	CurrentFighter->SetSelectionState(ESelectionState::NONE);
+
 	// Start new turn.
 	StartTurn();
 }
@@ -170,41 +216,96 @@ void ACustomGameMode::ReturnToMenu()
 	Reset();
 }
 
+void ACustomGameMode::ApplyExplosionDamage(const FVector& Location, const TArray<AFighterPawn*>& Victims, const TArray<int>& Damage)
+{
+	// Health and death flags for everyone first.
+	TArray<AFighterPawn*> Killed;
+	for (int i = 0; i < Victims.Num(); i++)
+	{
+		if (Victims[i]->ApplyDamage(Damage[i]))
+		{
+			Killed.Add(Victims[i]);
+		}
+	}
+
+	// Then the rosters, with the winner decided once for the whole blast.
+	{
+		TGuardValue<bool> Defer(bDeferWinner, true);
+		for (AFighterPawn* Fighter : Killed)
+		{
+			Fighter->NotifyDied();
+		}
+	}
+	UpdateWinner();
+
+	OnExplosionResolved.Broadcast(Location, Victims);
+}
+
+AGrenade* ACustomGameMode::TakeGrenade()
+{
+	if (GrenadePool.Num() > 0)
+	{
+		return GrenadePool.Pop(false);
+	}
+
+	return GetWorld()->SpawnActor<AGrenade>();
+}
+
+void ACustomGameMode::ReturnGrenade(AGrenade* Grenade)
+{
+	GrenadePool.AddUnique(Grenade);
+}
+
 void ACustomGameMode::Reset()
 {
 	// Return to default values.
 	bIsRedTurn = true;
 	bHasRedWon = false;
 	bHasBlueWon = false;
-	RedTurnCounter = 0;
-	BlueTurnCounter = 0;
+	WinningTeam = INDEX_NONE;
 
 	// Destroy actors, and empty arrays.
 	// *** //
-	for (auto Actor : RedTeamActors)
+	for (const FTeamRoster& Team : Teams)
 	{
-		Actor->Destroy();
+		for (auto Actor : Team.GetFighters())
+		{
+			Actor->Destroy();
+		}
 	}
 
-	for (auto Actor : BlueTeamActors)
+	for (auto Obstacle : Obstacles)
 	{
-		Actor->Destroy();
+		Obstacle->Destroy();
 	}
 
-	for (auto Obstacle : Obstacles)
+	// Copied, as returning a grenade removes it from the registry.
+	TArray<AGrenade*> Grenades = GetWorld()->GetSubsystem<UMatchRegistrySubsystem>()->GetGrenades();
+	for (auto Grenade : Grenades)
 	{
-		Obstacle->Destroy();
+		Grenade->ReturnToPool();
 	}
 
-	RedTeamActors.Empty();
-	BlueTeamActors.Empty();
+	ResetTeams();
 	Obstacles.Empty();
+	SpatialIndex.Reset();
+	LineOfSight.Reset();
 	// *** //
 
+	// Stop the AI.
+	AI.Cancel();
+	GetWorldTimerManager().ClearTimer(AITurnEndTimer);
+	bAIWaitingForMove = false;
+
+	// Finish the match's journal.
+	Journal.Close();
+
+	// Remove the arena anchor.
+	GetWorld()->GetSubsystem<UARPinManager>()->ClearArenaAnchor();
+
 	// Get AR manager, and reset it.
 	// *** //
-	auto Actor = UGameplayStatics::GetActorOfClass(GetWorld(), AHelloARManager::StaticClass());
-	auto ARM = Cast<AHelloARManager>(Actor);
+	auto ARM = GetWorld()->GetSubsystem<UMatchRegistrySubsystem>()->GetARManager();
 
 	if (ARM)
 	{
@@ -217,38 +318,317 @@ void ACustomGameMode::Tick(float DeltaSeconds)
 {
 	Super::Tick(DeltaSeconds);
 
-	// Count dead
-	// *** //
-	int RedDead = 0;
-	int BlueDead = 0;
+	UpdateSpatialIndex();
+
+	UMatchRegistrySubsystem* Registry = GetWorld()->GetSubsystem<UMatchRegistrySubsystem>();
+	LineOfSight.Update(Registry->GetFighters(), Registry->GetObstacles(), SpatialIndex);
+
+	// The AI's action comes back once its thinking time is up.
+	FArenaAction AIAction;
+	if (AI.Poll(DeltaSeconds, AIAction))
+	{
+		ApplyAIAction(AIAction);
+	}
+
+	if (bAIWaitingForMove && CurrentFighter && !CurrentFighter->GetIsMoving())
+	{
+		bAIWaitingForMove = false;
+		EndAITurn();
+	}
+}
+
+bool ACustomGameMode::IsAITurn()
+{
+	bool bInTurn = CurrentPhase >= EGamePhase::TURN_IDLE && CurrentPhase <= EGamePhase::TURN_MOVEMENT;
+	return bInTurn && AITeam != INDEX_NONE && CurrentTeam == AITeam;
+}
+
+void ACustomGameMode::UpdateAIForTurn()
+{
+	if (AITeam == INDEX_NONE)
+	{
+		return;
+	}
+
+	AI.Team = AITeam;
 
-	for (auto Actor : RedTeamActors)
+	FArena State;
+	CaptureArena(State);
+
+	if (CurrentTeam == AITeam)
+	{
+		AI.StartTurn(State, AITurnTime);
+	}
+	else if (bAIPonder)
+	{
+		AI.StartPondering(State);
+	}
+}
+
+void ACustomGameMode::ApplyAIAction(const FArenaAction& Action)
+{
+	if (!CurrentFighter || CurrentPhase == EGamePhase::GAME_END)
 	{
-		if (Actor->GetIsDead())
+		return;
+	}
+
+	// Time for the action to play out before the turn ends.
+	float Delay = 1.0f;
+	const FTransform& ArenaTransform = SpatialIndex.GetArenaTransform();
+	TGuardValue<bool> Acting(bIsAIActing, true);
+
+	switch (Action.Type)
+	{
+	case EArenaActionType::Shoot:
+	{
+		AFighterPawn* Target = GetArenaFighter(Action.Target);
+		if (Target && !Target->GetIsDead())
 		{
-			RedDead++;
+			CurrentFighter->SelectTarget(Target);
+			CurrentFighter->Shoot();
 		}
+		break;
+	}
+	case EArenaActionType::Move:
+		// The turn ends once the fighter stops.
+		CurrentFighter->MoveTo(ArenaTransform.TransformPosition(Action.Location));
+		bAIWaitingForMove = true;
+		return;
+	case EArenaActionType::Grenade:
+	{
+		// Face the landing point and throw with the drag whose predicted flight lands nearest it.
+		FVector Landing = ArenaTransform.TransformPosition(Action.Location);
+		FRotator Rot = UKismetMathLibrary::FindLookAtRotation(CurrentFighter->GetActorLocation(), Landing);
+		Rot.Pitch = 0;
+		CurrentFighter->SetActorRotation(Rot);
+
+		float Drag = CurrentFighter->FindGrenadeDrag(Action.Location, ACustomARPawn::MinThrowDrag, FMath::Max(AIMaxGrenadeDrag, ACustomARPawn::MinThrowDrag));
+		CurrentFighter->ThrowGrenade(FVector(Drag));
+
+		// Wait for the grenade to be released and go off.
+		Delay = 3.0f;
+		break;
 	}
+	default:
+		EndAITurn();
+		return;
+	}
+
+	GetWorldTimerManager().SetTimer(AITurnEndTimer, this, &ACustomGameMode::EndAITurn, Delay, false);
+}
 
-	for (auto Actor : BlueTeamActors)
+void ACustomGameMode::EndAITurn()
+{
+	if (!CurrentFighter || CurrentPhase == EGamePhase::GAME_END)
 	{
-		if (Actor->GetIsDead())
+		return;
+	}
+
+	TGuardValue<bool> Acting(bIsAIActing, true);
+	CurrentFighter->EndTargeting();
+	CurrentPhase = EGamePhase::TURN_IDLE;
+	EndTurn();
+}
+
+AFighterPawn* ACustomGameMode::GetArenaFighter(int Index)
+{
+	for (const FTeamRoster& Team : Teams)
+	{
+		if (Index < Team.Num())
 		{
-			BlueDead++;
+			return Index >= 0 ? Team.GetFighter(Index) : nullptr;
 		}
+		Index -= Team.Num();
 	}
-	// *** //
+	return nullptr;
+}
+
+void ACustomGameMode::UpdateSpatialIndex()
+{
+	UMatchRegistrySubsystem* Registry = GetWorld()->GetSubsystem<UMatchRegistrySubsystem>();
 
-	// Decide winning team based on dead actors.
-	if (RedDead == PawnsPerTeam)
+	// Entries are stored in arena space, so the arena anchor moving doesn't move them in the grid.
+	SpatialIndex.SetArenaTransform(GetWorld()->GetSubsystem<UARPinManager>()->GetArenaTransform());
+	SpatialIndex.BeginUpdate();
+
+	for (AFighterPawn* Fighter : Registry->GetFighters())
 	{
-		bHasBlueWon = true;
-		CurrentPhase = EGamePhase::GAME_END;
+		SpatialIndex.Update(Fighter, EArenaEntryKind::Fighter, Fighter->GetTeam(), Fighter->GetActorLocation(), Fighter->GetArenaExtent());
+	}
+
+	for (AObstacle* Obstacle : Registry->GetObstacles())
+	{
+		SpatialIndex.Update(Obstacle, EArenaEntryKind::Obstacle, INDEX_NONE, Obstacle->GetArenaCenter(), Obstacle->GetArenaExtent());
+	}
+
+	for (AGrenade* Grenade : Registry->GetGrenades())
+	{
+		SpatialIndex.Update(Grenade, EArenaEntryKind::Grenade, INDEX_NONE, Grenade->GetArenaCenter(), Grenade->GetArenaExtent());
+	}
+
+	// Drop anything that's been destroyed.
+	SpatialIndex.RemoveStale();
+}
+
+void ACustomGameMode::CaptureArena(FArena& OutArena)
+{
+	OutArena = FArena();
+	OutArena.Seed = CurrentSeed;
+	OutArena.NumTeams = Teams.Num();
+	OutArena.bInitiativeOrder = TurnOrder == ETurnOrder::INITIATIVE;
+	OutArena.LastFighters.Init(INDEX_NONE, Teams.Num());
+
+	const FTransform& ArenaTransform = SpatialIndex.GetArenaTransform();
+	for (int Team = 0; Team < Teams.Num(); Team++)
+	{
+		const TArray<AFighterPawn*>& Fighters = Teams[Team].GetFighters();
+		for (int Slot = 0; Slot < Fighters.Num(); Slot++)
+		{
+			AFighterPawn* Fighter = Fighters[Slot];
+			OutArena.Rules = Fighter->GetRules();
+			int Index = OutArena.Fighters.Add(Fighter->GetArenaState(ArenaTransform));
+
+			// Carry on from where the scheduler is for every team, not just the one playing.
+			if (Scheduler)
+			{
+				FTurnSlot Turn;
+				Turn.Team = Team;
+				Turn.Slot = Slot;
+				OutArena.Fighters[Index].NextTurnTime = Scheduler->GetNextTurnTime(Turn);
+				if (Scheduler->GetLastSlot(Team) == Slot)
+				{
+					OutArena.LastFighters[Team] = Index;
+				}
+			}
+
+			// Pick up the turn where the live match is.
+			if (Fighter == CurrentFighter)
+			{
+				OutArena.CurrentTeam = Team;
+				OutArena.CurrentFighter = Index;
+				OutArena.LastFighters[Team] = Index;
+			}
+		}
+	}
+
+	// Obstacles come from the spatial index, which already holds their arena space boxes.
+	for (AObstacle* Obstacle : Obstacles)
+	{
+		if (const FArenaSpatialEntry* Entry = SpatialIndex.Find(Obstacle))
+		{
+			OutArena.AddObstacle(Entry->Center, Entry->Extent);
+		}
+	}
+
+	OutArena.bIsOver = CurrentPhase == EGamePhase::GAME_END;
+	OutArena.WinningTeam = OutArena.bIsOver ? WinningTeam : INDEX_NONE;
+}
+
+void ACustomGameMode::ResetTeams()
+{
+	Teams.Reset();
+	Teams.SetNum(FMath::Max(NumTeams, 2));
+	AliveTeams = Teams.Num();
+	CurrentTeam = 0;
+	Scheduler.Reset();
+}
+
+void ACustomGameMode::AddToTeam(AFighterPawn* Fighter, int Team)
+{
+	Fighter->SetRosterSlot(Team, Teams[Team].Add(Fighter));
+	Fighter->OnDied.AddUObject(this, &ACustomGameMode::OnFighterDied);
+}
+
+void ACustomGameMode::OnFighterDied(AFighterPawn* Fighter)
+{
+	// Nothing more to do unless that was the last of the team.
+	if (!Teams[Fighter->GetTeam()].MarkDead(Fighter->GetRosterSlot()))
+	{
+		return;
+	}
+
+	AliveTeams--;
+
+	// Wait for the rest of the action's deaths if there are more to come.
+	if (!bDeferWinner)
+	{
+		UpdateWinner();
 	}
-	else if (BlueDead == PawnsPerTeam)
+}
+
+void ACustomGameMode::UpdateWinner()
+{
+	// The game can only be won once.
+	if (CurrentPhase == EGamePhase::GAME_END)
+	{
+		return;
+	}
+
+	// Decide the winner once one team is left standing.
+	if (AliveTeams <= 1)
 	{
-		bHasRedWon = true;
+		WinningTeam = Teams.IndexOfByPredicate([](const FTeamRoster& Roster) { return Roster.GetAliveCount() > 0; });
+		bHasRedWon = WinningTeam == 0;
+		bHasBlueWon = WinningTeam == 1;
 		CurrentPhase = EGamePhase::GAME_END;
+		OnGameWon.Broadcast(WinningTeam);
+	}
+}
+
+void ACustomGameMode::FaceTeamsTogether()
+{
+	// Sum the positions of each team, so each team's view of everyone else is a subtraction.
+	TArray<FVector> TeamSums;
+	FVector Total = FVector::ZeroVector;
+	int TotalCount = 0;
+	for (const FTeamRoster& Team : Teams)
+	{
+		FVector& Sum = TeamSums.Add_GetRef(FVector::ZeroVector);
+		for (auto Fighter : Team.GetFighters())
+		{
+			Sum += Fighter->GetActorLocation();
+		}
+		Total += Sum;
+		TotalCount += Team.Num();
+	}
+
+	for (int i = 0; i < Teams.Num(); i++)
+	{
+		int OthersCount = TotalCount - Teams[i].Num();
+		if (OthersCount == 0)
+		{
+			continue;
+		}
+
+		FVector AvgOthersPos = (Total - TeamSums[i]) / OthersCount;
+		for (auto Fighter : Teams[i].GetFighters())
+		{
+			Fighter->SetActorRotation(UKismetMathLibrary::FindLookAtRotation(Fighter->GetActorLocation(), AvgOthersPos));
+		}
+	}
+}
+
+FColor ACustomGameMode::GetTeamColor(int Team)
+{
+	if (TeamColors.IsValidIndex(Team))
+	{
+		return TeamColors[Team];
+	}
+
+	// Spread any extra teams round the hue wheel.
+	return FLinearColor::MakeFromHSV8((uint8)(Team * 47), 255, 255).ToFColor(true);
+}
+
+void ACustomGameMode::PinMatchActor(AActor* Actor, UARPin* Pin, float Scale, bool bKeepRotation)
+{
+	UARPinManager* PinManager = GetWorld()->GetSubsystem<UARPinManager>();
+	if (Pin)
+	{
+		PinManager->AddPinnedActor(Actor, Pin, FVector(Scale), bKeepRotation);
+	}
+	else
+	{
+		PinManager->AddArenaActor(Actor, FVector(Scale), bKeepRotation);
 	}
 }
 
@@ -282,16 +662,17 @@ void ACustomGameMode::LineTraceSpawnActor(FVector ScreenPos)
 
 		if (FVector::DotProduct(TrackedTF.GetRotation().GetUpVector(), WorldDir) < 0)
 		{
-			//Spawn the actor pin and get the transform
-			UARPin* ActorPin = UARBlueprintLibrary::PinComponent(nullptr, TraceResult[0].GetLocalToWorldTransform(), TraceResult[0].GetTrackedGeometry());
+			// Actors live in the arena frame when it's anchored, otherwise spawn the actor pin.
+			bool bInArena = bUseArenaAnchor && GetWorld()->GetSubsystem<UARPinManager>()->HasArenaAnchor();
+			UARPin* ActorPin = bInArena ? nullptr : UARBlueprintLibrary::PinComponent(nullptr, TraceResult[0].GetLocalToWorldTransform(), TraceResult[0].GetTrackedGeometry());
 
 			// Check if ARPins are available on your current device. ARPins are currently not supported locally by ARKit, so on iOS, this will always be "FALSE" 
-			if (ActorPin)
+			if (ActorPin || bInArena)
 			{
 				//GEngine->AddOnScreenDebugMessage(-1, 2.0f, FColor::White, TEXT("ARPin is valid"));
 			
 				// Pin transform
-				auto PinTF = ActorPin->GetLocalToWorldTransform();
+				auto PinTF = ActorPin ? ActorPin->GetLocalToWorldTransform() : TrackedTF;
 
 				const FActorSpawnParameters SpawnInfo;
 				const FRotator MyRot(0, 0, 0);
@@ -312,59 +693,46 @@ void ACustomGameMode::LineTraceSpawnActor(FVector ScreenPos)
 				}
 				else
 				{
-					// Spawn red pawns until correct number is reached.
-					if (RedTeamActors.Num() < PawnsPerTeam)
+					// Spawn pawns for each team in turn, until every team has the correct number.
+					int Team = Teams.IndexOfByPredicate([this](const FTeamRoster& Roster) { return Roster.Num() < PawnsPerTeam; });
+					if (Team != INDEX_NONE)
 					{
-						// Spawn actor, set pin, then add to array.
+						// Spawn actor, set pin, then add to team.
 						AFighterPawn* SpawnedActor = GetWorld()->SpawnActor<AFighterPawn>(MyLoc, MyRot, SpawnInfo);
-						SpawnedActor->SetColor(FColor::Red);
+						SpawnedActor->SetColor(GetTeamColor(Team));
 						SpawnedActor->SetActorTransform(PinTF);
-						SpawnedActor->PinComponent = ActorPin;
-						RedTeamActors.Add(SpawnedActor);
+						PinMatchActor(SpawnedActor, ActorPin, SpawnedActor->GetScale(), true);
+						AddToTeam(SpawnedActor, Team);
 
-						// Move onto next turn if all actors have been spawned.
-						if (RedTeamActors.Num() == PawnsPerTeam)
+						if (Journal.IsOpen())
 						{
-							bIsRedTurn = false;
+							FArenaFighter State = SpawnedActor->GetArenaState(SpatialIndex.GetArenaTransform());
+							FMatchJournalRecord Record;
+							Record.Type = EMatchJournalRecord::SpawnFighter;
+							Record.Team = State.Team;
+							Record.Slot = State.Slot;
+							Record.Location = State.Location;
+							Record.Vector = State.Extent;
+							Journal.Write(Record);
 						}
-					}
-					else if (BlueTeamActors.Num() < PawnsPerTeam)
-					{
-						// Spawn actor, set pin, then add to array.
-						AFighterPawn* SpawnedActor = GetWorld()->SpawnActor<AFighterPawn>(MyLoc, MyRot, SpawnInfo);
-						SpawnedActor->SetColor(FColor::Blue);
-						SpawnedActor->SetActorTransform(PinTF);
-						SpawnedActor->PinComponent = ActorPin;
-						BlueTeamActors.Add(SpawnedActor);
 
-						// Once all blue actors have been spawned...
-						if (BlueTeamActors.Num() == PawnsPerTeam)
+						// Move onto the next team once this one has been spawned.
+						if (Teams[Team].Num() == PawnsPerTeam)
 						{
-							// Move to red turn.
-							bIsRedTurn = true;
-
-							// Calculate average position of each teams, and then make them face each other based on this position
-							// *** //
-							TArray<AActor*> Blues(BlueTeamActors);
-							TArray<AActor*> Reds(RedTeamActors);
+							CurrentTeam = (Team + 1) % Teams.Num();
+							bIsRedTurn = CurrentTeam == 0;
 
-							FVector AvgBluePos = UGameplayStatics::GetActorArrayAverageLocation(Blues);
-							FVector AvgRedPos = UGameplayStatics::GetActorArrayAverageLocation(Reds);
-
-							for (auto Blue : BlueTeamActors)
+							// Once the last team has been spawned...
+							if (CurrentTeam == 0)
 							{
-								Blue->SetActorRotation(UKismetMathLibrary::FindLookAtRotation(Blue->GetActorLocation(), AvgRedPos));
-							}
+								FaceTeamsTogether();
 
-							for (auto Red : RedTeamActors)
-							{
-								Red->SetActorRotation(UKismetMathLibrary::FindLookAtRotation(Red->GetActorLocation(), AvgBluePos));
+								// Start the first turn.
+								Scheduler = FTurnScheduler::Create(TurnOrder);
+								Scheduler->Start(Teams);
+								CurrentPhase = EGamePhase::TURN_IDLE;
+								StartTurn();
 							}
-							// *** //
-
-							// Start the next turn.
-							CurrentPhase = EGamePhase::TURN_IDLE;
-							StartTurn();
 						}
 					}
 				}
@@ -392,16 +760,17 @@ void ACustomGameMode::LineTraceSpawnObstacle(FVector ScreenPos)
 
 		if (FVector::DotProduct(TrackedTF.GetRotation().GetUpVector(), WorldDir) < 0)
 		{
-			//Spawn the actor pin and get the transform
-			UARPin* ActorPin = UARBlueprintLibrary::PinComponent(nullptr, TraceResult[0].GetLocalToWorldTransform(), TraceResult[0].GetTrackedGeometry());
+			// Actors live in the arena frame when it's anchored, otherwise spawn the actor pin.
+			bool bInArena = bUseArenaAnchor && GetWorld()->GetSubsystem<UARPinManager>()->HasArenaAnchor();
+			UARPin* ActorPin = bInArena ? nullptr : UARBlueprintLibrary::PinComponent(nullptr, TraceResult[0].GetLocalToWorldTransform(), TraceResult[0].GetTrackedGeometry());
 
 			// Check if ARPins are available on your current device. ARPins are currently not supported locally by ARKit, so on iOS, this will always be "FALSE" 
-			if (ActorPin)
+			if (ActorPin || bInArena)
 			{
 				//GEngine->AddOnScreenDebugMessage(-1, 2.0f, FColor::White, TEXT("ARPin is valid"));
 				
 				// Get pin transform
-				auto PinTF = ActorPin->GetLocalToWorldTransform();
+				auto PinTF = ActorPin ? ActorPin->GetLocalToWorldTransform() : TrackedTF;
 
 				const FActorSpawnParameters SpawnInfo;
 				const FRotator MyRot(0, 0, 0);
@@ -412,8 +781,17 @@ void ACustomGameMode::LineTraceSpawnObstacle(FVector ScreenPos)
 				{
 					AObstacle* SpawnedActor = GetWorld()->SpawnActor<AObstacle>(MyLoc, MyRot, SpawnInfo);
 					SpawnedActor->SetActorTransform(PinTF);
-					SpawnedActor->PinComponent = ActorPin;
+					PinMatchActor(SpawnedActor, ActorPin, SpawnedActor->GetScale(), false);
 					Obstacles.Add(SpawnedActor);
+
+					if (Journal.IsOpen())
+					{
+						FMatchJournalRecord Record;
+						Record.Type = EMatchJournalRecord::SpawnObstacle;
+						Record.Location = SpatialIndex.GetArenaTransform().InverseTransformPosition(SpawnedActor->GetArenaCenter());
+						Record.Vector = SpawnedActor->GetArenaExtent();
+						Journal.Write(Record);
+					}
 				}
 			}
 		}
@@ -422,21 +800,10 @@ void ACustomGameMode::LineTraceSpawnObstacle(FVector ScreenPos)
 
 void ACustomGameMode::TogglePlaneVisibility()
 {
-	// Get all planes.
-	TArray<AActor*> Planes;
-	UGameplayStatics::GetAllActorsOfClass(GetWorld(), AARPlaneActor::StaticClass(), Planes);
-
 	// Toggle visibility on each plane.
-	if (Planes.Num() > 0)
+	for (auto Plane : GetWorld()->GetSubsystem<UMatchRegistrySubsystem>()->GetPlanes())
 	{
-		for (auto Actor : Planes)
-		{
-			auto Plane = Cast<AARPlaneActor>(Actor);
-			if (Plane)
-			{
-				Plane->bIsVisibleOverride = !Plane->bIsVisibleOverride;
-			}
-		}
+		Plane->bIsVisibleOverride = !Plane->bIsVisibleOverride;
 	}
 
 }
@@ -466,10 +833,27 @@ bool ACustomGameMode::LineTraceCheckForPlane(FVector2D ScreenPos)
 		if (PlaneGeometry)
 		{
 			// Set the used plane in the ARManager.
-			AHelloARManager* ARManager = Cast<AHelloARManager>(UGameplayStatics::GetActorOfClass(GetWorld(), AHelloARManager::StaticClass()));
+			AHelloARManager* ARManager = GetWorld()->GetSubsystem<UMatchRegistrySubsystem>()->GetARManager();
 			if (ARManager)
 			{
 				ARManager->SetUsedPlane(PlaneGeometry);
+
+				if (Journal.IsOpen())
+				{
+					FMatchJournalRecord Record;
+					Record.Type = EMatchJournalRecord::SetUsedPlane;
+					Record.Location = PlaneGeometry->GetLocalToWorldTransform().GetLocation();
+					Record.Rotation = PlaneGeometry->GetLocalToWorldTransform().GetRotation();
+					Record.Vector = PlaneGeometry->GetExtent();
+					Journal.Write(Record);
+				}
+
+				// Anchor the arena. If pins aren't available, actors fall back to a pin each.
+				if (bUseArenaAnchor)
+				{
+					UARPin* ArenaPin = UARBlueprintLibrary::PinComponent(nullptr, PlaneGeometry->GetLocalToWorldTransform(), PlaneGeometry);
+					GetWorld()->GetSubsystem<UARPinManager>()->SetArenaAnchor(ArenaPin);
+				}
 				return true;
 			}
 		}
@@ -496,40 +880,28 @@ bool ACustomGameMode::LineTraceSelectPawn(FVector2D ScreenPos)
 		FVector TraceEndVector = WorldDirection * 1000.0;
 		TraceEndVector = WorldPosition + TraceEndVector;
 		
-		FCollisionQueryParams CollisionParameters;
+		// Trace for enemy fighters, ignoring friendly fighters and obstacles.
+		FArenaRayHit Hit;
+		int Team = CurrentTeam;
+		SpatialIndex.Raycast(WorldPosition, TraceEndVector, Hit, [Team](const FArenaSpatialEntry& Entry) { return Entry.Kind == EArenaEntryKind::Fighter && Entry.Team != Team; });
 
-		// Ignore friendly fighters and obstacles when tracing.
-		// *** //
-		if (bIsRedTurn)
-		{
-			for (auto Actor : RedTeamActors)
-			{
-				CollisionParameters.AddIgnoredActor(Actor);
-				CollisionParameters.AddIgnoredActors(Actor->Children);
-			}
-		}
-		else
+		// Cast hit actor to fighter.
+		AFighterPawn* Target = Hit.Entry ? Cast<AFighterPawn>(Hit.Entry->Actor) : nullptr;
+
+		// Optionally, a tap that misses picks the enemy nearest where it meets the arena. Without an anchor there's no arena
+		// plane to meet.
+		if (!Target && TargetSnapDistance > 0.0f && bUseArenaAnchor && GetWorld()->GetSubsystem<UARPinManager>()->HasArenaAnchor())
 		{
-			for (auto Actor : BlueTeamActors)
+			const FTransform& ArenaTransform = SpatialIndex.GetArenaTransform();
+			FVector LocalStart = ArenaTransform.InverseTransformPosition(WorldPosition);
+			FVector LocalDirection = ArenaTransform.InverseTransformVector(WorldDirection);
+			if (LocalDirection.Z < -KINDA_SMALL_NUMBER && LocalStart.Z > 0.0f)
 			{
-				CollisionParameters.AddIgnoredActor(Actor);
-				CollisionParameters.AddIgnoredActors(Actor->Children);
+				FVector LocalTap = LocalStart - LocalDirection * (LocalStart.Z / LocalDirection.Z);
+				Target = FindNearestEnemy(Team, ArenaTransform.TransformPosition(LocalTap), TargetSnapDistance);
 			}
 		}
 
-		for (auto Obstacle : Obstacles)
-		{
-			CollisionParameters.AddIgnoredActor(Obstacle);
-		}
-		// *** //
-
-		// Perform trace.
-		FHitResult Hit;
-		GetWorld()->LineTraceSingleByChannel(Hit, WorldPosition, TraceEndVector, ECollisionChannel::ECC_WorldDynamic, CollisionParameters);
-
-		// Cast hit actor to fighter.
-		AFighterPawn* Target = Cast<AFighterPawn>(Hit.GetActor());
-
 		// If trace hit a fighter, and it's not dead, set that as the target.
 		if (Target)
 		{
@@ -544,6 +916,17 @@ bool ACustomGameMode::LineTraceSelectPawn(FVector2D ScreenPos)
 	return false;
 }
 
+AFighterPawn* ACustomGameMode::FindNearestEnemy(int Team, FVector Location, float MaxDistance)
+{
+	const FArenaSpatialEntry* Entry = SpatialIndex.FindNearest(Location, [Team](const FArenaSpatialEntry& Other)
+	{
+		AFighterPawn* Fighter = Other.Kind == EArenaEntryKind::Fighter ? Cast<AFighterPawn>(Other.Actor) : nullptr;
+		return Fighter && Other.Team != Team && !Fighter->GetIsDead();
+	}, MaxDistance);
+
+	return Entry ? Cast<AFighterPawn>(Entry->Actor) : nullptr;
+}
+
 void ACustomGameMode::LineTraceMovePawn(FVector2D ScreenPos)
 {
 	// Get player controller
@@ -2,13 +2,21 @@
 
 
 #include "FighterPawn.h"
-#include "ARPin.h"
-#include "ARBlueprintLibrary.h"
+#include "ARPinManager.h"
+#include "MatchRegistrySubsystem.h"
+#include "CustomGameMode.h"
+#include "HelloARManager.h"
+#include "ARPlaneActor.h"
+#include "ArenaSpatialIndex.h"
+#include "LineOfSightCache.h"
+#include "Arena.h"
 #include "Kismet/GameplayStatics.h"
 #include "Kismet/KismetMathLibrary.h"
 #include "Components/CapsuleComponent.h"
 #include "Engine/SkeletalMeshSocket.h"
 #include "GameFramework/CharacterMovementComponent.h"
+#include "Components/InstancedStaticMeshComponent.h"
+#include "PhysicsEngine/BodySetup.h"
 
 
 
@@ -20,6 +28,7 @@ AFighterPawn::AFighterPawn()
 {
  	// Set this character to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
 	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.bStartWithTickEnabled = false;
 
 	// Default values.
 	HalfHeight = 88;
@@ -32,11 +41,15 @@ AFighterPawn::AFighterPawn()
 	Scale = 0.1;
 	MovableDistance = 100;
 	DistanceMoved = 0;
-	Offset = FVector(0);
 	MinRange = 30;
 	MaxRange = 300;
 	MinDamage = 25;
 	MaxDamage = 35;
+	Initiative = 1.0f;
+	Team = INDEX_NONE;
+	RosterSlot = INDEX_NONE;
+	RollCount = 0;
+	GrenadeReleaseOffset = FVector(20.0f, -20.0f, 80.0f);
 
 	// Setup player's skeletal mesh and animation class using constructor helpers.
 	static ConstructorHelpers::FObjectFinder<USkeletalMesh> Skeleton(TEXT("SkeletalMesh'/Game/AnimStarterPack/UE4_Mannequin/Mesh/SK_Mannequin.SK_Mannequin'"));
@@ -77,7 +90,28 @@ AFighterPawn::AFighterPawn()
 	GrenadeMesh->AddLocalRotation(FRotator(-180.0f, 0.0f, 180.0f));
 	GrenadeMesh->SetVisibility(false);
 
-	
+	// Setup the grenade preview. It's placed in world space, so it doesn't follow the fighter around.
+	static ConstructorHelpers::FObjectFinder<UStaticMesh> Sphere(TEXT("StaticMesh'/Engine/BasicShapes/Sphere.Sphere'"));
+	GrenadeArc = CreateDefaultSubobject<UInstancedStaticMeshComponent>(TEXT("Grenade Arc"));
+	GrenadeArc->SetupAttachment(GetRootComponent());
+	GrenadeArc->SetStaticMesh(Sphere.Object);
+	GrenadeArc->SetUsingAbsoluteLocation(true);
+	GrenadeArc->SetUsingAbsoluteRotation(true);
+	GrenadeArc->SetUsingAbsoluteScale(true);
+	GrenadeArc->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	GrenadeArc->SetCastShadow(false);
+	GrenadeArc->SetVisibility(false);
+
+	static ConstructorHelpers::FObjectFinder<UStaticMesh> Cylinder(TEXT("StaticMesh'/Engine/BasicShapes/Cylinder.Cylinder'"));
+	GrenadeLandingMarker = CreateDefaultSubobject<UStaticMeshComponent>(TEXT("Grenade Landing Marker"));
+	GrenadeLandingMarker->SetupAttachment(GetRootComponent());
+	GrenadeLandingMarker->SetStaticMesh(Cylinder.Object);
+	GrenadeLandingMarker->SetUsingAbsoluteLocation(true);
+	GrenadeLandingMarker->SetUsingAbsoluteRotation(true);
+	GrenadeLandingMarker->SetUsingAbsoluteScale(true);
+	GrenadeLandingMarker->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	GrenadeLandingMarker->SetCastShadow(false);
+	GrenadeLandingMarker->SetVisibility(false);
 }
 
 // Called when the game starts or when spawned
@@ -97,6 +131,15 @@ void AFighterPawn::BeginPlay()
 	Indicator->SetMaterial(0, DynamicIndicatorMaterial);
 	Indicator->SetVisibility(false);
 	// *** //
+
+	GetWorld()->GetSubsystem<UMatchRegistrySubsystem>()->RegisterFighter(this);
+}
+
+void AFighterPawn::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	GetWorld()->GetSubsystem<UMatchRegistrySubsystem>()->UnregisterFighter(this);
+
+	Super::EndPlay(EndPlayReason);
 }
 
 void AFighterPawn::UpdateIndicator()
@@ -123,27 +166,6 @@ void AFighterPawn::Tick(float DeltaTime)
 {
 	Super::Tick(DeltaTime);
 
-	// If pin exists...
-	if (PinComponent)
-	{
-		auto TrackingState = PinComponent->GetTrackingState();
-
-		switch (TrackingState)
-		{
-			// Update location based on pin location and offset.
-		case EARTrackingState::Tracking:
-			SetActorLocation(PinComponent->GetLocalToWorldTransform().GetLocation() + Offset);
-			SetActorScale3D(FVector(Scale));
-			break;
-
-		case EARTrackingState::NotTracking:
-			PinComponent = nullptr;
-
-			break;
-
-		}
-	}
-
 	// Only update indicator when selected or targeted.
 	switch (Selection)
 	{
@@ -164,9 +186,15 @@ void AFighterPawn::Tick(float DeltaTime)
 	if (bIsMoving)
 	{
 		Move(DeltaTime);
+		UpdateTickEnabled();
 	}
 }
 
+void AFighterPawn::UpdateTickEnabled()
+{
+	SetActorTickEnabled(bIsMoving || Selection != ESelectionState::NONE);
+}
+
 // Called to bind functionality to input
 void AFighterPawn::SetupPlayerInputComponent(UInputComponent* PlayerInputComponent)
 {
@@ -203,16 +231,29 @@ void AFighterPawn::SetSelectionState(ESelectionState S)
 	default:
 		break;
 	}
+
+	UpdateTickEnabled();
 }
 
 // Reset values when start targeting.
 void AFighterPawn::StartTargeting()
 {
+	if (!CanTakeTurnAction())
+	{
+		return;
+	}
+
 	DamageMultiplier = 1.0f;
 	bIsObstructed = false;
 	HitChance = 1;
 }
 
+bool AFighterPawn::CanTakeTurnAction()
+{
+	ACustomGameMode* GM = GetWorld()->GetSubsystem<UMatchRegistrySubsystem>()->GetGameMode();
+	return !GM || GM->CanTakeTurnAction();
+}
+
 // Target the specified fighter.
 void AFighterPawn::SelectTarget(AFighterPawn* Target)
 {
@@ -228,40 +269,30 @@ void AFighterPawn::SelectTarget(AFighterPawn* Target)
 		TargetFighter = Target;
 		TargetFighter->SetSelectionState(ESelectionState::TARGETED);
 
-		// Set hit chance based on distance to target.
-		float Distance = GetDistanceTo(Target);
-		HitChance = UKismetMathLibrary::MapRangeClamped(Distance, MinRange, MaxRange, 1, 0);
-
-		// Ignore fighters when checking for obstacles. Could be changed in future to allow for collaterals.
-		TArray<AActor*> IgnoredActors;
-		UGameplayStatics::GetAllActorsOfClass(GetWorld(), AFighterPawn::StaticClass(), IgnoredActors); 
-		FCollisionQueryParams CollisionParameters;
-		CollisionParameters.AddIgnoredActors(IgnoredActors);
-
-		// Draw line trace.
-		const FName TraceTag("TraceTag");
-		GetWorld()->DebugDrawTraceTag = TraceTag;
-		CollisionParameters.TraceTag = TraceTag;
-
-		// Trace between centre of fighter and its target.
-		FHitResult Hit;
-		FVector TraceStart = GetMesh()->GetSocketByName(FName("Centre"))->GetSocketLocation(GetMesh());
-		FVector TraceEnd = Target->GetMesh()->GetSocketByName(FName("Centre"))->GetSocketLocation(Target->GetMesh());
-		bIsObstructed = GetWorld()->LineTraceSingleByChannel(Hit, TraceStart, TraceEnd, ECollisionChannel::ECC_WorldDynamic, CollisionParameters);
-
-		// If obstacle was found, reduce damage multiplier and hit chance by 0.5. Hit chance cannot drop below 0.
-		if (bIsObstructed)
-		{
-			DamageMultiplier -= 0.5;
-			HitChance -= 0.5;
-			if (HitChance < 0)
-			{
-				HitChance = 0;
-			}
-		}
+		// Set hit chance based on distance to target and obstacles in the way.
+		HitChance = PreviewHitChance(Target, bIsObstructed);
+
+		// If obstacle was found, the damage multiplier is reduced.
+		DamageMultiplier = GetRules().GetDamageMultiplier(bIsObstructed);
+
+		FMatchJournalRecord Record;
+		Record.Type = EMatchJournalRecord::SelectTarget;
+		Record.TargetTeam = Target->GetTeam();
+		Record.TargetSlot = Target->GetRosterSlot();
+		RecordAction(Record);
 	}
 }
 
+float AFighterPawn::PreviewHitChance(AFighterPawn* Target, bool& bOutObstructed)
+{
+	// Line of sight between the centres of the fighters, only looking for obstacles. Could be changed in future to allow for collaterals.
+	FLineOfSightCache* LineOfSight = GetWorld()->GetSubsystem<UMatchRegistrySubsystem>()->GetLineOfSight();
+	bOutObstructed = LineOfSight && LineOfSight->IsObstructed(this, Target);
+
+	// Hit chance based on distance to target, reduced if an obstacle was found.
+	return GetRules().GetHitChance(GetDistanceTo(Target), bOutObstructed);
+}
+
 // Reset target properties.
 void AFighterPawn::EndTargeting()
 {
@@ -275,19 +306,30 @@ void AFighterPawn::EndTargeting()
 // Shoots the target.
 void AFighterPawn::Shoot()
 {
+	// The UI can't shoot for the AI.
+	if (!CanTakeTurnAction())
+	{
+		return;
+	}
+
 	// Can only shoot if there is a target.
 	if (TargetFighter)
 	{
-		// Generate random number.
-		float Rand = FMath::RandRange(0.0f, 1.0f);
-
-		// If random number is less than hit chance, the shot hits.
-		if (Rand < HitChance)
+		// Roll for a hit against the hit chance.
+		FArenaRules Rules = GetRules();
+		bool bHit = Rules.RollHit(HitChance, Roll());
+
+		FMatchJournalRecord Record;
+		Record.Type = EMatchJournalRecord::Shoot;
+		Record.TargetTeam = TargetFighter->GetTeam();
+		Record.TargetSlot = TargetFighter->GetRosterSlot();
+		Record.bHit = bHit;
+		RecordAction(Record);
+
+		if (bHit)
 		{
 			// Randomise damage, apply multiplier, then apply damage to target.
-			float Damage = FMath::RandRange(MinDamage, MaxDamage);
-			Damage *= DamageMultiplier;
-			TargetFighter->ReceiveDamage(Damage);
+			TargetFighter->ReceiveDamage(Rules.RollDamage(DamageMultiplier, Roll()));
 		}
 
 		// Set IsFiring to true so animation blueprint starts animating.
@@ -305,11 +347,16 @@ void AFighterPawn::Shoot()
 // Start throwing grenade process.
 void AFighterPawn::ThrowGrenade(FVector Dir)
 {
-	if (bHasGrenade)
+	if (bHasGrenade && CanTakeTurnAction())
 	{
 		// Grenade's one use is done.
 		bHasGrenade = false;
 
+		FMatchJournalRecord Record;
+		Record.Type = EMatchJournalRecord::ThrowGrenade;
+		Record.Vector = Dir;
+		RecordAction(Record);
+
 		// Show grenade mesh.
 		GrenadeMesh->SetVisibility(true);
 
@@ -323,43 +370,236 @@ void AFighterPawn::ThrowGrenade(FVector Dir)
 	}
 }
 
-// Release grenade - spawns the grenade actor.
+// Release grenade - throws a grenade actor.
 void AFighterPawn::ReleaseGrenade(FVector Dir)
 {
 	// Hide the grenade mesh.
 	GrenadeMesh->SetVisibility(false);
 
-	// Spawn the grenade with the grenade mesh's position, rotation and scale.
-	const FActorSpawnParameters SpawnInfo;
-	auto Grenade = GetWorld()->SpawnActor<AGrenade>(GrenadeMesh->GetComponentLocation(), GrenadeMesh->GetComponentRotation(), SpawnInfo);
-	Grenade->SetActorScale3D(GrenadeMesh->GetComponentScale());
+	// Throw a pooled grenade from the release point, with the grenade mesh's rotation and scale, forward and up.
+	UMatchRegistrySubsystem* Registry = GetWorld()->GetSubsystem<UMatchRegistrySubsystem>();
+	ACustomGameMode* GM = Registry->GetGameMode();
+	AGrenade* Grenade = GM ? GM->TakeGrenade() : GetWorld()->SpawnActor<AGrenade>();
+
+	// Ballistic grenades follow the previewed arc, and move with the arena themselves.
+	FArenaSpatialIndex* SpatialIndex = Registry->GetSpatialIndex();
+	if (GM && GM->bBallisticGrenades && SpatialIndex)
+	{
+		const FTransform& ArenaTransform = SpatialIndex->GetArenaTransform();
+		TArray<FArenaObstacle> Obstacles;
+		GetGrenadeObstacles(Obstacles);
+		Grenade->LaunchBallistic(GetGrenadeReleaseTransform(), GetGrenadeFlight(ArenaTransform), ArenaTransform.InverseTransformVector(GetGrenadeLaunchVelocity(Dir)), Obstacles);
+		return;
+	}
+
+	Grenade->Launch(GetGrenadeReleaseTransform(), GetGrenadeImpulse(Dir));
 
-	// Add force to the grenade forward and up.
+	// Keep the grenade in the arena frame while it flies.
+	UARPinManager* PinManager = GetWorld()->GetSubsystem<UARPinManager>();
+	if (PinManager->HasArenaAnchor())
+	{
+		PinManager->AddArenaPhysicsActor(Grenade);
+	}
+}
+
+FVector AFighterPawn::GetGrenadeImpulse(FVector Dir)
+{
 	float ThrowPower = 0.2f;
-	FVector ThrowDir = Dir.Length() * GrenadeMesh->GetComponentScale() * ThrowPower * GetActorForwardVector();
-	Grenade->GetMesh()->AddImpulse(ThrowDir);
-	Grenade->GetMesh()->AddImpulse(GetActorUpVector() * Dir.Length() * GrenadeMesh->GetComponentScale() * ThrowPower);
+	FVector Power = Dir.Length() * GrenadeMesh->GetComponentScale() * ThrowPower;
+	return Power * GetActorForwardVector() + Power * GetActorUpVector();
+}
 
+FVector AFighterPawn::GetGrenadeLaunchVelocity(FVector Dir)
+{
+	// An impulse changes velocity by itself over the body's mass. The held grenade has the thrown one's mesh and scale,
+	// so it has the same mass.
+	UBodySetup* BodySetup = GrenadeMesh->GetBodySetup();
+	float Mass = BodySetup ? BodySetup->CalculateMass(GrenadeMesh) : 0.0f;
+	return Mass > 0.0f ? GetGrenadeImpulse(Dir) / Mass : FVector::ZeroVector;
+}
 
+FTransform AFighterPawn::GetGrenadeReleaseTransform()
+{
+	return FTransform(GrenadeMesh->GetComponentQuat(), GetActorTransform().TransformPosition(GrenadeReleaseOffset), GrenadeMesh->GetComponentScale());
+}
+
+FGrenadeFlight AFighterPawn::GetGrenadeFlight(const FTransform& ArenaTransform)
+{
+	FGrenadeFlight Flight;
+	Flight.Gravity = ArenaTransform.InverseTransformVector(FVector(0.0f, 0.0f, GetWorld()->GetGravityZ()));
+	Flight.Radius = GrenadeMesh->Bounds.SphereRadius;
+	Flight.FuseTime = GetDefault<AGrenade>()->GetExplosionDelay();
+
+	// Grenades land on the arena plane's collision, so only inside its boundary.
+	AHelloARManager* ARManager = GetWorld()->GetSubsystem<UMatchRegistrySubsystem>()->GetARManager();
+	AARPlaneActor* ArenaPlane = ARManager ? ARManager->GetArenaPlane() : nullptr;
+	if (ArenaPlane)
+	{
+		ArenaPlane->GetArenaFloor(ArenaTransform, Flight.Floor);
+	}
+	return Flight;
+}
+
+void AFighterPawn::GetGrenadeObstacles(TArray<FArenaObstacle>& OutObstacles)
+{
+	OutObstacles.Reset();
+
+	UMatchRegistrySubsystem* Registry = GetWorld()->GetSubsystem<UMatchRegistrySubsystem>();
+	FArenaSpatialIndex* SpatialIndex = Registry->GetSpatialIndex();
+	if (!SpatialIndex)
+	{
+		return;
+	}
+
+	// Obstacles as boxes, from the spatial index.
+	for (AObstacle* Obstacle : Registry->GetObstacles())
+	{
+		if (const FArenaSpatialEntry* Entry = SpatialIndex->Find(Obstacle))
+		{
+			FArenaObstacle& Box = OutObstacles.AddDefaulted_GetRef();
+			Box.Center = Entry->Center;
+			Box.Extent = Entry->Extent;
+		}
+	}
+}
+
+void AFighterPawn::PreviewGrenade(FVector Dir)
+{
+	UMatchRegistrySubsystem* Registry = GetWorld()->GetSubsystem<UMatchRegistrySubsystem>();
+	FArenaSpatialIndex* SpatialIndex = Registry->GetSpatialIndex();
+	if (!SpatialIndex)
+	{
+		return;
+	}
+
+	TArray<FArenaObstacle> Obstacles;
+	GetGrenadeObstacles(Obstacles);
+
+	// Fly the grenade from the release point, as ReleaseGrenade would throw it.
+	const FTransform& ArenaTransform = SpatialIndex->GetArenaTransform();
+	FGrenadeFlight Flight = GetGrenadeFlight(ArenaTransform);
+	FVector Start = ArenaTransform.InverseTransformPosition(GetGrenadeReleaseTransform().GetLocation());
+	FVector Velocity = ArenaTransform.InverseTransformVector(GetGrenadeLaunchVelocity(Dir));
+	FVector Landing = FGrenadeTrajectory::Predict(Flight, Start, Velocity, Obstacles, &GrenadeArcPoints);
+
+	// A dot half the grenade's size at each point along the arc.
+	GrenadeArcDots.Reset();
+	for (const FVector& Point : GrenadeArcPoints)
+	{
+		GrenadeArcDots.Emplace(FQuat::Identity, ArenaTransform.TransformPosition(Point), FVector(Flight.Radius / 100.0f));
+	}
+	GrenadeArc->ClearInstances();
+	GrenadeArc->AddInstances(GrenadeArcDots, false, true);
+	GrenadeArc->SetVisibility(true);
+
+	// A flat disc the size of the blast, lying on the arena. The cylinder mesh is 100 units across.
+	float BlastRadius = GetRules().GrenadeRadius;
+	GrenadeLandingMarker->SetWorldLocationAndRotation(ArenaTransform.TransformPosition(FVector(Landing.X, Landing.Y, 0.0f)), ArenaTransform.GetRotation());
+	GrenadeLandingMarker->SetWorldScale3D(FVector(BlastRadius / 50.0f, BlastRadius / 50.0f, 0.001f));
+	GrenadeLandingMarker->SetVisibility(true);
+}
+
+float AFighterPawn::FindGrenadeDrag(const FVector& Landing, float MinDrag, float MaxDrag)
+{
+	FArenaSpatialIndex* SpatialIndex = GetWorld()->GetSubsystem<UMatchRegistrySubsystem>()->GetSpatialIndex();
+	if (!SpatialIndex || MaxDrag <= MinDrag)
+	{
+		return MinDrag;
+	}
+
+	TArray<FArenaObstacle> Obstacles;
+	GetGrenadeObstacles(Obstacles);
+
+	const FTransform& ArenaTransform = SpatialIndex->GetArenaTransform();
+	FGrenadeFlight Flight = GetGrenadeFlight(ArenaTransform);
+	FVector Start = ArenaTransform.InverseTransformPosition(GetGrenadeReleaseTransform().GetLocation());
+
+	auto GetMiss = [&](float Drag)
+	{
+		FVector Velocity = ArenaTransform.InverseTransformVector(GetGrenadeLaunchVelocity(FVector(Drag)));
+		return FVector::Dist2D(FGrenadeTrajectory::Predict(Flight, Start, Velocity, Obstacles), Landing);
+	};
+
+	// Bounces off obstacles make the landing jump around, so scan the whole range first, then narrow in on the best drag.
+	const int Samples = 16;
+	float Step = (MaxDrag - MinDrag) / Samples;
+	float BestDrag = MinDrag;
+	float BestMiss = GetMiss(MinDrag);
+	for (int i = 1; i <= Samples; i++)
+	{
+		float Drag = MinDrag + Step * i;
+		float Miss = GetMiss(Drag);
+		if (Miss < BestMiss)
+		{
+			BestDrag = Drag;
+			BestMiss = Miss;
+		}
+	}
+
+	for (int i = 0; i < 8; i++)
+	{
+		Step *= 0.5f;
+		for (float Drag : { BestDrag - Step, BestDrag + Step })
+		{
+			float Miss = Drag >= MinDrag && Drag <= MaxDrag ? GetMiss(Drag) : BIG_NUMBER;
+			if (Miss < BestMiss)
+			{
+				BestDrag = Drag;
+				BestMiss = Miss;
+			}
+		}
+	}
+
+	return BestDrag;
+}
+
+void AFighterPawn::HideGrenadePreview()
+{
+	GrenadeArc->SetVisibility(false);
+	GrenadeLandingMarker->SetVisibility(false);
 }
 
 // Take damage.
 void AFighterPawn::ReceiveDamage(int Dmg)
+{
+	if (ApplyDamage(Dmg))
+	{
+		NotifyDied();
+	}
+}
+
+void AFighterPawn::NotifyDied()
+{
+	OnDied.Broadcast(this);
+}
+
+bool AFighterPawn::ApplyDamage(int Dmg)
 {
 	// Start animation in anim bp.
 	bIsHit = true;
 	GetWorld()->GetTimerManager().SetTimer(AnimationResetTimer, this, &AFighterPawn::ResetAnimations, 0.1f, false);
 
+	FMatchJournalRecord Record;
+	Record.Type = EMatchJournalRecord::Damage;
+	Record.Value = Dmg;
+	RecordAction(Record);
+
 	// Reduce health.
 	Health -= Dmg;
 
 	// If health drops below zero, they are dead.
-	if (Health <= 0)
+	if (Health <= 0 && !bIsDead)
 	{
 		Health = 0;
 		bIsDead = true;
 		SetSelectionState(ESelectionState::NONE);
+		return true;
 	}
+	else if (Health < 0)
+	{
+		Health = 0;
+	}
+	return false;
 }
 
 // Give fighter a shot and reset distance moved..
@@ -369,11 +609,82 @@ void AFighterPawn::TurnReset()
 	DistanceMoved = 0.f;
 }
 
+FVector AFighterPawn::GetArenaExtent() const
+{
+	float Radius = GetCapsuleComponent()->GetScaledCapsuleRadius();
+	return FVector(Radius, Radius, GetCapsuleComponent()->GetScaledCapsuleHalfHeight());
+}
+
+FArenaRules AFighterPawn::GetRules()
+{
+	FArenaRules Rules;
+	Rules.MinRange = MinRange;
+	Rules.MaxRange = MaxRange;
+	Rules.MinDamage = MinDamage;
+	Rules.MaxDamage = MaxDamage;
+	Rules.MovableDistance = MovableDistance;
+
+	// The grenade's radius scales with the grenade mesh.
+	const AGrenade* GrenadeDefaults = GetDefault<AGrenade>();
+	Rules.GrenadeDamage = GrenadeDefaults->GetDamage();
+	Rules.GrenadeRadius = GrenadeDefaults->GetExplosionRadius() * GrenadeMesh->GetComponentScale().X;
+	return Rules;
+}
+
+FArenaFighter AFighterPawn::GetArenaState(const FTransform& ArenaTransform)
+{
+	FArenaFighter State;
+	State.Team = Team;
+	State.Location = ArenaTransform.InverseTransformPosition(GetCentreLocation());
+	State.Extent = GetArenaExtent();
+	State.Health = Health;
+	State.Initiative = Initiative;
+	State.DistanceMoved = DistanceMoved;
+	State.bHasShot = bHasShot;
+	State.bHasGrenade = bHasGrenade;
+	State.bIsDead = bIsDead;
+	State.Slot = RosterSlot;
+	State.Rolls = RollCount;
+	return State;
+}
+
+void AFighterPawn::RecordAction(FMatchJournalRecord Record)
+{
+	if (FMatchJournalWriter* Journal = GetWorld()->GetSubsystem<UMatchRegistrySubsystem>()->GetJournal())
+	{
+		Record.Team = Team;
+		Record.Slot = RosterSlot;
+		Journal->Write(Record);
+	}
+}
+
+float AFighterPawn::Roll()
+{
+	// Rolls come from the fighter's own stream of the match seed, the same as in the arena simulation.
+	ACustomGameMode* GameMode = GetWorld()->GetSubsystem<UMatchRegistrySubsystem>()->GetGameMode();
+	uint64 Seed = GameMode ? GameMode->GetMatchSeed() : 0;
+	return FMatchRandom::Roll(Seed, FMatchRandom::GetFighterStream(Team, RosterSlot), RollCount++);
+}
+
+FVector AFighterPawn::GetCentreLocation()
+{
+	return GetMesh()->GetSocketByName(FName("Centre"))->GetSocketLocation(GetMesh());
+}
+
 // Start moving and set target location.
 void AFighterPawn::MoveTo(FVector Location)
 {
+	FMatchJournalRecord Record;
+	Record.Type = EMatchJournalRecord::MoveTo;
+	if (FArenaSpatialIndex* SpatialIndex = GetWorld()->GetSubsystem<UMatchRegistrySubsystem>()->GetSpatialIndex())
+	{
+		Record.Location = SpatialIndex->GetArenaTransform().InverseTransformPosition(Location);
+	}
+	RecordAction(Record);
+
 	bIsMoving = true;
 	TargetPos = Location;
+	UpdateTickEnabled();
 }
 
 void AFighterPawn::Move(float DeltaTime)
@@ -406,15 +717,12 @@ void AFighterPawn::Move(float DeltaTime)
 		// The amount to move forward in this frame.
 		FVector Movement = GetActorForwardVector() * GetCharacterMovement()->MaxWalkSpeed * DeltaTime;
 
-		// Trace forward from the pawn.
-		FHitResult Hit;
-		FVector TraceStart = GetMesh()->GetSocketByName(FName("Centre"))->GetSocketLocation(GetMesh());
+		// Trace forward from the pawn for other fighters and obstacles.
+		FArenaRayHit Hit;
+		FVector TraceStart = GetCentreLocation();
 		FVector TraceEnd = TraceStart + Movement * 5;
-		FCollisionQueryParams Params;
-		Params.AddIgnoredComponent(GetMesh());
-		Params.AddIgnoredComponent(GetCapsuleComponent());
-		Params.AddIgnoredComponent(Cast<UPrimitiveComponent>(Gun));
-		bool TraceSuccess = GetWorld()->LineTraceSingleByChannel(Hit, TraceStart, TraceEnd, ECollisionChannel::ECC_WorldDynamic, Params);
+		FArenaSpatialIndex* SpatialIndex = GetWorld()->GetSubsystem<UMatchRegistrySubsystem>()->GetSpatialIndex();
+		bool TraceSuccess = SpatialIndex && SpatialIndex->Raycast(TraceStart, TraceEnd, Hit, [this](const FArenaSpatialEntry& Entry) { return Entry.Actor != this && Entry.Kind != EArenaEntryKind::Grenade; });
 
 		// If trace hits something, there is something in the way. Stop moving.
 		if (TraceSuccess)
@@ -423,8 +731,10 @@ void AFighterPawn::Move(float DeltaTime)
 		}
 		else // Otherwise increase offset and tracked distance moved.
 		{
-			Offset += Movement;
 			DistanceMoved += Movement.Length();
+
+			// The offset is kept in the pin's frame, which is arena space when the arena is anchored. The pin manager applies it at the end of the frame.
+			GetWorld()->GetSubsystem<UARPinManager>()->AddPinOffset(this, Movement);
 		}
 
 	}
@@ -7,6 +7,9 @@
 #include "ProceduralMeshComponent.h"
 #include "CustomGameMode.h"
 #include "FighterPawn.h"
+#include "MatchRegistrySubsystem.h"
+#include "ArenaSpatialIndex.h"
+#include "ARPinManager.h"
 
 
 // Sets default values
@@ -22,16 +25,7 @@ AGrenade::AGrenade()
 	// Creating the static mesh and using the grenade's static mesh asset.
 	GrenadeMesh = CreateDefaultSubobject<UStaticMeshComponent>(TEXT("Grenade Mesh"));
 	GrenadeMesh->SetStaticMesh(GrenadeAsset);
-	
-	// Use constructor helpers to find a cube for the ground mesh.
-	static ConstructorHelpers::FObjectFinder<UStaticMesh> Cube(TEXT("StaticMesh'/Engine/BasicShapes/Cube.Cube'"));
-	Ground = CreateDefaultSubobject<UStaticMeshComponent>(TEXT("Ground"));
-
-	// Ground mesh setup.
-	Ground->SetStaticMesh(Cube.Object);
-	Ground->AddLocalOffset(FVector(0.0f, 0.0f, -100.0f));
-	Ground->SetRelativeScale3D(FVector(250.0f, 250.0f, 0.1f));
-	Ground->SetVisibility(false);
+	SetRootComponent(GrenadeMesh);
 
 	// Use constructor helpers to find the explosion particle system.
 	static ConstructorHelpers::FObjectFinder<UParticleSystem> ExplosionParticle(TEXT("ParticleSystem'/Game/StarterContent/Particles/P_Explosion.P_Explosion'"));
@@ -50,85 +44,278 @@ AGrenade::AGrenade()
 	// Create the audio component and use the previously created sound cue.
 	ExplosionSound = CreateDefaultSubobject<UAudioComponent>(TEXT("Explosion Sound"));
 	ExplosionSound->SetSound(ExplosionCue);
-	ExplosionSound->SetVolumeMultiplier(0);
 
-	// Grenade uses physics to move.
+	// Effects only play when the grenade explodes, as grenades are spawned ahead of being thrown.
+	Explosion->bAutoActivate = false;
+	ExplosionSound->bAutoActivate = false;
+
+	// Grenade uses physics to move, unless launched ballistically. Ticking is only needed for ballistic flight.
 	GrenadeMesh->SetSimulatePhysics(true);
+	PrimaryActorTick.bStartWithTickEnabled = false;
 
 	// Default values.
 	ExplosionDelay = 1.5f;
 	ExplosionRadius = 3000.f;
 	Damage = 75;
+	EffectTimeout = 5.0f;
+	bIsBallistic = false;
+	FlightTime = 0.0f;
+	bIsInPlay = false;
+	bIsExplosionPlaying = false;
+	bIsSoundPlaying = false;
 }
 
 // Called when the game starts or when spawned
 void AGrenade::BeginPlay()
 {
 	Super::BeginPlay();
-	
-	// Explosion particle system is invisible until we want it to be seen.
-	Explosion->SetVisibility(false);
+
+	Explosion->OnSystemFinished.AddDynamic(this, &AGrenade::OnExplosionFinished);
+	ExplosionSound->OnAudioFinished.AddDynamic(this, &AGrenade::OnSoundFinished);
+
+	// Grenades wait out of play until they're thrown.
+	Deactivate();
+}
+
+void AGrenade::StartThrow(const FTransform& Transform)
+{
+	GetWorld()->GetSubsystem<UMatchRegistrySubsystem>()->RegisterGrenade(this);
+	bIsInPlay = true;
+
+	// Put the grenade in the thrower's hand, with no motion left from its last throw.
+	SetActorTransform(Transform, false, nullptr, ETeleportType::ResetPhysics);
+	SetActorHiddenInGame(false);
+	SetActorEnableCollision(true);
+	GrenadeMesh->SetVisibility(true);
+}
+
+void AGrenade::Launch(const FTransform& Transform, const FVector& Impulse)
+{
+	StartThrow(Transform);
+
+	GrenadeMesh->SetSimulatePhysics(true);
+	GrenadeMesh->SetPhysicsLinearVelocity(FVector::ZeroVector);
+	GrenadeMesh->SetPhysicsAngularVelocityInDegrees(FVector::ZeroVector);
+	GrenadeMesh->AddImpulse(Impulse);
 
 	// Start the timer for the grenade explosion. Calls the explode function after x seconds.
 	GetWorld()->GetTimerManager().SetTimer(ExplodeTimer, this, &AGrenade::Explode, ExplosionDelay, false);
+}
+
+void AGrenade::LaunchBallistic(const FTransform& Transform, const FGrenadeFlight& InFlight, const FVector& Velocity, TArrayView<const FArenaObstacle> Obstacles)
+{
+	StartThrow(Transform);
+
+	FArenaSpatialIndex* SpatialIndex = GetWorld()->GetSubsystem<UMatchRegistrySubsystem>()->GetSpatialIndex();
+	const FTransform ArenaTransform = SpatialIndex ? SpatialIndex->GetArenaTransform() : FTransform::Identity;
+
+	// The grenade is moved by Tick, and explodes when its flight reaches the fuse time.
+	bIsBallistic = true;
+	Flight = InFlight;
+	Flight.FuseTime = ExplosionDelay;
+	FlightObstacles = Obstacles;
+	FlightState = FGrenadeState();
+	FlightState.Position = ArenaTransform.InverseTransformPosition(Transform.GetLocation());
+	FlightState.Velocity = Velocity;
+	FlightTime = 0.0f;
+	SetActorTickEnabled(true);
+}
 
-	// Get the game mode.
-	auto Temp = GetWorld()->GetAuthGameMode();
-	auto GM = Cast<ACustomGameMode>(Temp);
+void AGrenade::Deactivate()
+{
+	GetWorld()->GetTimerManager().ClearTimer(ExplodeTimer);
+	GetWorld()->GetTimerManager().ClearTimer(ReturnTimer);
+
+	// Stop the effects.
+	Explosion->DeactivateImmediate();
+	Explosion->SetVisibility(false);
+	ExplosionSound->Stop();
+	bIsExplosionPlaying = false;
+	bIsSoundPlaying = false;
+
+	// Take the grenade out of the physics scene and out of sight.
+	bIsBallistic = false;
+	SetActorTickEnabled(false);
+	GrenadeMesh->SetSimulatePhysics(false);
+	SetActorHiddenInGame(true);
+	SetActorEnableCollision(false);
+
+	GetWorld()->GetSubsystem<UMatchRegistrySubsystem>()->UnregisterGrenade(this);
+	GetWorld()->GetSubsystem<UARPinManager>()->RemovePinnedActor(this);
+}
+
+void AGrenade::ReturnToPool()
+{
+	if (!bIsInPlay)
+	{
+		return;
+	}
 
-	// Setup ground.
+	bIsInPlay = false;
+	Deactivate();
+
+	ACustomGameMode* GM = GetWorld()->GetSubsystem<UMatchRegistrySubsystem>()->GetGameMode();
 	if (GM)
 	{
-		FVector SpawnLocation = GM->CurrentFighter->GetMesh()->GetComponentLocation();
-		Ground->SetWorldLocation(SpawnLocation);
+		GM->ReturnGrenade(this);
+	}
+	else
+	{
+		Destroy();
+	}
+}
+
+void AGrenade::OnExplosionFinished(UParticleSystemComponent* System)
+{
+	bIsExplosionPlaying = false;
+	if (bIsInPlay && !bIsSoundPlaying)
+	{
+		// Not from inside the particle system's own callback.
+		GetWorld()->GetTimerManager().SetTimerForNextTick(this, &AGrenade::ReturnToPool);
 	}
 }
 
+void AGrenade::OnSoundFinished()
+{
+	bIsSoundPlaying = false;
+	if (bIsInPlay && !bIsExplosionPlaying)
+	{
+		GetWorld()->GetTimerManager().SetTimerForNextTick(this, &AGrenade::ReturnToPool);
+	}
+}
+
+void AGrenade::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	GetWorld()->GetSubsystem<UMatchRegistrySubsystem>()->UnregisterGrenade(this);
+
+	Super::EndPlay(EndPlayReason);
+}
+
 // Called every frame
 void AGrenade::Tick(float DeltaTime)
 {
 	Super::Tick(DeltaTime);
 
+	if (!bIsBallistic)
+	{
+		return;
+	}
+
+	// Take the flight's fixed steps up to the current time. The frame rate only changes how many are taken per frame.
+	FlightTime += DeltaTime;
+	while (FlightState.Time < FlightTime && FlightState.Time < Flight.FuseTime && !FlightState.bAtRest)
+	{
+		FGrenadeTrajectory::Step(Flight, FlightState, FlightObstacles);
+	}
+
+	// Follow the arena, in case its anchor moved.
+	FArenaSpatialIndex* SpatialIndex = GetWorld()->GetSubsystem<UMatchRegistrySubsystem>()->GetSpatialIndex();
+	const FTransform ArenaTransform = SpatialIndex ? SpatialIndex->GetArenaTransform() : FTransform::Identity;
+	SetActorLocation(ArenaTransform.TransformPosition(FlightState.Position));
+
+	if (FlightTime >= Flight.FuseTime)
+	{
+		Explode();
+	}
 }
 
 // Explode function. Handles particles, sounds and damage.
 void AGrenade::Explode()
 {
+	// Stop following the flight.
+	bIsBallistic = false;
+	SetActorTickEnabled(false);
+
 	// Start particle effect.
 	Explosion->SetVisibility(true);
 	Explosion->ResetParticles();
-	Explosion->Activate();
+	Explosion->Activate(true);
+	bIsExplosionPlaying = true;
 
-	// Hide mesh as it has just exploded.
+	// Hide mesh as it has just exploded, and stop it rolling.
 	GrenadeMesh->SetVisibility(false);
+	GrenadeMesh->SetSimulatePhysics(false);
 
 	// Play explosion sound.
-	ExplosionSound->SetVolumeMultiplier(1);
 	ExplosionSound->Play();
+	bIsSoundPlaying = ExplosionSound->IsPlaying();
 
-	// Variables for sphere overlap function. Only looking for pawns.
-	TArray<TEnumAsByte<EObjectTypeQuery>> ObjectTypes;
-	ObjectTypes.Add(UEngineTypes::ConvertToObjectType(ECollisionChannel::ECC_Pawn));
-	TArray<AActor*> ActorsToIgnore;
-	TArray<AActor*> OutActors;
+	// Go back to the pool once the effects are done.
+	GetWorld()->GetTimerManager().SetTimer(ReturnTimer, this, &AGrenade::ReturnToPool, EffectTimeout, false);
 
-	// Grenade does damage within a sphere. If enemies are inside the sphere, they take damage.
-	// This function gets the overlapping actors within the specified radius (explosion radius * scale).
-	UKismetSystemLibrary::SphereOverlapActors(GetWorld(), GrenadeMesh->GetComponentLocation(), ExplosionRadius * GrenadeMesh->GetComponentScale().X, ObjectTypes, nullptr, ActorsToIgnore, OutActors);
+	UMatchRegistrySubsystem* Registry = GetWorld()->GetSubsystem<UMatchRegistrySubsystem>();
+	FArenaSpatialIndex* SpatialIndex = Registry->GetSpatialIndex();
+	if (!SpatialIndex)
+	{
+		return;
+	}
 
-	// Iterate through the found actors, then damage them if they're fighters. Does not check for enemies, allows for friendly fire.
-	for (auto Actor : OutActors)
+	FVector Blast = SpatialIndex->GetArenaTransform().InverseTransformPosition(GrenadeMesh->GetComponentLocation());
+	if (FMatchJournalWriter* Journal = Registry->GetJournal())
 	{
-		if (Actor)
+		FMatchJournalRecord Record;
+		Record.Type = EMatchJournalRecord::Explode;
+		Record.Location = Blast;
+		Journal->Write(Record);
+	}
+
+	// One query for the fighters in the blast and the obstacles that might shield them. The radius is the explosion
+	// radius * scale.
+	FArenaRules Rules;
+	Rules.GrenadeDamage = Damage;
+	Rules.GrenadeRadius = ExplosionRadius * GrenadeMesh->GetComponentScale().X;
+
+	TArray<const FArenaSpatialEntry*> Hits;
+	SpatialIndex->QueryRadius(GrenadeMesh->GetComponentLocation(), Rules.GrenadeRadius, Hits, [](const FArenaSpatialEntry& Entry) { return Entry.Kind == EArenaEntryKind::Fighter || Entry.Kind == EArenaEntryKind::Obstacle; });
+
+	TArray<AFighterPawn*> Victims;
+	TArray<FVector, TInlineAllocator<FArena::MaxFighters>> Centers;
+	TArray<FVector, TInlineAllocator<FArena::MaxFighters>> Extents;
+	TArray<FArenaObstacle, TInlineAllocator<FArena::MaxObstacles>> Obstacles;
+	for (const FArenaSpatialEntry* Hit : Hits)
+	{
+		if (Hit->Kind == EArenaEntryKind::Obstacle)
+		{
+			FArenaObstacle& Box = Obstacles.AddDefaulted_GetRef();
+			Box.Center = Hit->Center;
+			Box.Extent = Hit->Extent;
+		}
+		else if (!Cast<AFighterPawn>(Hit->Actor)->GetIsDead())
 		{
-			auto Fighter = Cast<AFighterPawn>(Actor);
+			Victims.Add(Cast<AFighterPawn>(Hit->Actor));
+			Centers.Add(Hit->Center);
+			Extents.Add(Hit->Extent);
+		}
+	}
 
-			if (Fighter)
-			{
-				Fighter->ReceiveDamage(Damage);
-			}
+	// Falloff and cover for every fighter at once. Does not check for enemies, allows for friendly fire.
+	TArray<float, TInlineAllocator<FArena::MaxFighters>> BlastDamage;
+	BlastDamage.SetNumUninitialized(Victims.Num());
+	Rules.GetBlastDamage(Blast, Centers, Extents, Obstacles, BlastDamage);
 
+	TArray<AFighterPawn*> Damaged;
+	TArray<int> DamageDealt;
+	for (int i = 0; i < Victims.Num(); i++)
+	{
+		int Dmg = FMath::TruncToInt(BlastDamage[i]);
+		if (Dmg > 0)
+		{
+			Damaged.Add(Victims[i]);
+			DamageDealt.Add(Dmg);
 		}
 	}
-}
 
+	// Apply it as one batch, so the UI reacts once per explosion.
+	ACustomGameMode* GM = Registry->GetGameMode();
+	if (GM)
+	{
+		GM->ApplyExplosionDamage(GrenadeMesh->GetComponentLocation(), Damaged, DamageDealt);
+	}
+	else
+	{
+		for (int i = 0; i < Damaged.Num(); i++)
+		{
+			Damaged[i]->ReceiveDamage(DamageDealt[i]);
+		}
+	}
+}
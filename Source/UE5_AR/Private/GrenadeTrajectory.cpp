@@ -0,0 +1,269 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GrenadeTrajectory.h"
+#include "ArenaSpatialIndex.h"
+
+// Most bounces off the ground worked out before the grenade is taken to have stopped.
+static const int MaxBounces = 8;
+
+// Surfaces facing up at least this much can be landed on. Steeper ones are bounced or slid off.
+static const float MinGroundNormalZ = 0.7f;
+
+// The face of a box a point on its surface is on.
+static FVector GetBoxNormal(const FVector& Point, const FVector& Center, const FVector& Extent)
+{
+	FVector Local = Point - Center;
+	int Axis = 0;
+	float Best = -1.0f;
+	for (int i = 0; i < 3; i++)
+	{
+		float Depth = FMath::Abs(Local[i]) / FMath::Max(Extent[i], KINDA_SMALL_NUMBER);
+		if (Depth > Best)
+		{
+			Best = Depth;
+			Axis = i;
+		}
+	}
+
+	FVector Normal = FVector::ZeroVector;
+	Normal[Axis] = FMath::Sign(Local[Axis]);
+	return Normal;
+}
+
+// Sweep obstacles, grown by the grenade's radius, along a chord. Keeps the first hit if it's before HitFraction.
+static void SweepObstacles(const FGrenadeFlight& Flight, const FVector& Start, const FVector& Delta, TArrayView<const FArenaObstacle> Obstacles, float& HitFraction, FVector& HitNormal)
+{
+	for (const FArenaObstacle& Obstacle : Obstacles)
+	{
+		float HitTime;
+		FVector Extent = Obstacle.Extent + FVector(Flight.Radius);
+		if (FArenaSpatialIndex::IntersectSegmentBox(Start, Delta, Obstacle.Center, Extent, HitTime) && HitTime < HitFraction)
+		{
+			HitFraction = HitTime;
+			HitNormal = GetBoxNormal(Start + Delta * HitTime, Obstacle.Center, Extent);
+		}
+	}
+}
+
+FVector FGrenadeTrajectory::Predict(const FGrenadeFlight& Flight, const FVector& Start, const FVector& Velocity, TArrayView<const FArenaObstacle> Obstacles, TArray<FVector>* OutPoints)
+{
+	FGrenadeState State;
+	State.Position = Start;
+	State.Velocity = Velocity;
+
+	if (OutPoints)
+	{
+		OutPoints->Reset();
+		OutPoints->Add(State.Position);
+	}
+
+	while (State.Time < Flight.FuseTime && !State.bAtRest)
+	{
+		Step(Flight, State, Obstacles);
+
+		if (OutPoints)
+		{
+			OutPoints->Add(State.Position);
+		}
+	}
+
+	return State.Position;
+}
+
+void FGrenadeTrajectory::Step(const FGrenadeFlight& Flight, FGrenadeState& State, TArrayView<const FArenaObstacle> Obstacles)
+{
+	if (State.bAtRest || State.Time >= Flight.FuseTime)
+	{
+		return;
+	}
+
+	float DeltaTime = FMath::Min(1.0f / FMath::Max(Flight.StepsPerSecond, 1.0f), Flight.FuseTime - State.Time);
+
+	// Rolling off the edge of the plane starts the grenade falling again.
+	if (State.bOnFloor && !IsOverFloor(Flight, State.Position))
+	{
+		State.bOnFloor = false;
+	}
+
+	if (State.bOnFloor)
+	{
+		Slide(Flight, State, Obstacles, DeltaTime);
+		return;
+	}
+
+	FVector& Position = State.Position;
+	FVector& Speed = State.Velocity;
+	FVector Next = Position + Speed * DeltaTime + 0.5f * Flight.Gravity * DeltaTime * DeltaTime;
+
+	// Find the first surface hit during this step, as a fraction of it.
+	float HitFraction = 2.0f;
+	FVector HitNormal = FVector::UpVector;
+	bool bHitFloor = false;
+
+	// The plane, solving the parabola exactly for when the grenade's bottom touches it. Once the grenade is below the
+	// plane it has fallen off the edge.
+	if (Next.Z < Flight.Radius && Position.Z > 0.0f)
+	{
+		float A = 0.5f * Flight.Gravity.Z;
+		float B = Speed.Z;
+		float C = Position.Z - Flight.Radius;
+		float HitTime = DeltaTime;
+		if (FMath::IsNearlyZero(A))
+		{
+			HitTime = FMath::IsNearlyZero(B) ? 0.0f : -C / B;
+		}
+		else
+		{
+			// The root on the way down.
+			float Discriminant = FMath::Max(B * B - 4.0f * A * C, 0.0f);
+			HitTime = (-B - FMath::Sqrt(Discriminant)) / (2.0f * A);
+		}
+		HitTime = FMath::Clamp(HitTime, 0.0f, DeltaTime);
+
+		// Only over the plane's boundary.
+		if (IsOverFloor(Flight, Position + Speed * HitTime + 0.5f * Flight.Gravity * HitTime * HitTime))
+		{
+			HitFraction = HitTime / DeltaTime;
+			bHitFloor = true;
+		}
+	}
+
+	// Obstacles, against the step's chord.
+	float FloorFraction = HitFraction;
+	SweepObstacles(Flight, Position, Next - Position, Obstacles, HitFraction, HitNormal);
+	bHitFloor = bHitFloor && HitFraction == FloorFraction;
+
+	if (HitFraction > 1.0f)
+	{
+		Position = Next;
+		Speed += Flight.Gravity * DeltaTime;
+		State.Time += DeltaTime;
+		return;
+	}
+
+	float HitTime = HitFraction * DeltaTime;
+	Position += Speed * HitTime + 0.5f * Flight.Gravity * HitTime * HitTime;
+	Speed += Flight.Gravity * HitTime;
+	State.Time += HitTime;
+
+	float SpeedIn = -FVector::DotProduct(Speed, HitNormal);
+	bool bSettles = SpeedIn * Flight.Restitution < Flight.RestSpeed;
+
+	if (HitNormal.Z < MinGroundNormalZ)
+	{
+		// Walls are bounced off, or slid down when barely moving into them. The grenade can't stop against one.
+		if (bSettles)
+		{
+			Speed += HitNormal * SpeedIn;
+		}
+		else
+		{
+			Speed = Bounce(Flight, Speed, HitNormal);
+		}
+	}
+	else if (bSettles || ++State.Bounces >= MaxBounces)
+	{
+		// Done bouncing on the ground. The plane is slid along until friction stops the grenade. Obstacle tops are small,
+		// so the grenade stops on them.
+		Speed += HitNormal * SpeedIn;
+		if (bHitFloor)
+		{
+			Speed.Z = 0.0f;
+			State.bOnFloor = true;
+		}
+		else
+		{
+			Speed = FVector::ZeroVector;
+			State.bAtRest = true;
+			return;
+		}
+	}
+	else
+	{
+		Speed = Bounce(Flight, Speed, HitNormal);
+	}
+
+	Position += HitNormal * KINDA_SMALL_NUMBER;
+}
+
+void FGrenadeTrajectory::Slide(const FGrenadeFlight& Flight, FGrenadeState& State, TArrayView<const FArenaObstacle> Obstacles, float DeltaTime)
+{
+	FVector& Position = State.Position;
+	FVector& Speed = State.Velocity;
+
+	// Friction slows the grenade at a constant rate until it stops.
+	float SlideSpeed = Speed.Size();
+	float Deceleration = Flight.Friction * Flight.Gravity.Size();
+	float StopTime = Deceleration > 0.0f ? SlideSpeed / Deceleration : BIG_NUMBER;
+	float MoveTime = FMath::Min(DeltaTime, StopTime);
+	FVector Direction = Speed.GetSafeNormal();
+	FVector Delta = Direction * (SlideSpeed * MoveTime - 0.5f * Deceleration * MoveTime * MoveTime);
+
+	// Obstacles in the way are bounced off, along the plane.
+	float HitFraction = 2.0f;
+	FVector HitNormal = FVector::ZeroVector;
+	SweepObstacles(Flight, Position, Delta, Obstacles, HitFraction, HitNormal);
+
+	if (HitFraction <= 1.0f)
+	{
+		float HitTime = HitFraction * MoveTime;
+		Position += Delta * HitFraction;
+		Speed = Direction * (SlideSpeed - Deceleration * HitTime);
+		Speed = Bounce(Flight, Speed, HitNormal);
+		Speed.Z = 0.0f;
+		Position += HitNormal * KINDA_SMALL_NUMBER;
+		State.Time += HitTime;
+		return;
+	}
+
+	Position += Delta;
+	State.Time += DeltaTime;
+	if (MoveTime >= StopTime)
+	{
+		Speed = FVector::ZeroVector;
+		State.bAtRest = true;
+	}
+	else
+	{
+		Speed = Direction * (SlideSpeed - Deceleration * MoveTime);
+	}
+}
+
+FVector FGrenadeTrajectory::Bounce(const FGrenadeFlight& Flight, const FVector& Velocity, const FVector& Normal)
+{
+	FVector Into = FVector::DotProduct(Velocity, Normal) * Normal;
+	FVector Along = Velocity - Into;
+
+	// Friction takes off sliding speed in proportion to the bounce's impulse.
+	float AlongSpeed = Along.Size();
+	float Impulse = (1.0f + Flight.Restitution) * Into.Size();
+	if (AlongSpeed > KINDA_SMALL_NUMBER)
+	{
+		Along *= FMath::Max(1.0f - Flight.Friction * Impulse / AlongSpeed, 0.0f);
+	}
+
+	return Along - Into * Flight.Restitution;
+}
+
+bool FGrenadeTrajectory::IsOverFloor(const FGrenadeFlight& Flight, const FVector& Point)
+{
+	if (Flight.Floor.Num() < 3)
+	{
+		return true;
+	}
+
+	// Count the boundary edges a ray along +X crosses.
+	bool bInside = false;
+	for (int i = 0, j = Flight.Floor.Num() - 1; i < Flight.Floor.Num(); j = i++)
+	{
+		const FVector2D& A = Flight.Floor[i];
+		const FVector2D& B = Flight.Floor[j];
+		if ((A.Y > Point.Y) != (B.Y > Point.Y) && Point.X < A.X + (Point.Y - A.Y) * (B.X - A.X) / (B.Y - A.Y))
+		{
+			bInside = !bInside;
+		}
+	}
+
+	return bInside;
+}
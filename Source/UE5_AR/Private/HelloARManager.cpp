@@ -3,12 +3,16 @@
 
 #include "HelloARManager.h"
 #include "ARPlaneActor.h"
+#include "ARPlaneBatchComponent.h"
 #include "ARPin.h"
 #include "ARSessionConfig.h"
 #include "ARBlueprintLibrary.h"
 #include "CustomGameMode.h"
+#include "MatchRegistrySubsystem.h"
 #include "Runtime/Engine/Classes/Kismet/GameplayStatics.h"
 
+DEFINE_LOG_CATEGORY_STATIC(LogHelloARManager, Log, All);
+
 // Sets default values
 AHelloARManager::AHelloARManager()
 {
@@ -23,6 +27,10 @@ AHelloARManager::AHelloARManager()
 	static ConstructorHelpers::FObjectFinder<UARSessionConfig> ConfigAsset(TEXT("ARSessionConfig'/Game/Blueprints/HelloARSessionConfig.HelloARSessionConfig'"));
 	Config = ConfigAsset.Object;
 
+	// Setup the batched plane renderer. It's only filled when batching is turned on.
+	PlaneBatch = CreateDefaultSubobject<UARPlaneBatchComponent>(TEXT("PlaneBatch"));
+	SetRootComponent(PlaneBatch);
+
 	//Populate the plane colours array
 	PlaneColors.Add(FColor::Blue);
 	PlaneColors.Add(FColor::Red);
@@ -45,12 +53,41 @@ void AHelloARManager::BeginPlay()
 {
 	Super::BeginPlay();
 
+	GetWorld()->GetSubsystem<UMatchRegistrySubsystem>()->RegisterARManager(this);
+
+	// Listen for trackable changes, so only geometries that changed get processed.
+	OnTrackableAddedHandle = UARBlueprintLibrary::AddOnTrackableAddedDelegate_Handle(FOnTrackableAddedDelegate::CreateUObject(this, &AHelloARManager::OnTrackableAdded));
+	OnTrackableUpdatedHandle = UARBlueprintLibrary::AddOnTrackableUpdatedDelegate_Handle(FOnTrackableUpdatedDelegate::CreateUObject(this, &AHelloARManager::OnTrackableUpdated));
+	OnTrackableRemovedHandle = UARBlueprintLibrary::AddOnTrackableRemovedDelegate_Handle(FOnTrackableRemovedDelegate::CreateUObject(this, &AHelloARManager::OnTrackableRemoved));
+	bNeedsFullSync = true;
+
+	// Warm up the plane pool so the first planes found don't cause spawn hitches.
+	for (int i = 0; i < PlanePoolWarmupCount; i++)
+	{
+		AARPlaneActor* Plane = SpawnPlaneActor();
+		Plane->ResetForPool();
+		PlanePool.Add(Plane);
+	}
+
 	//Start the AR Session
 	UARBlueprintLibrary::StartARSession(Config);
 
 	
 }
 
+void AHelloARManager::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	UARBlueprintLibrary::ClearOnTrackableAddedDelegate_Handle(OnTrackableAddedHandle);
+	UARBlueprintLibrary::ClearOnTrackableUpdatedDelegate_Handle(OnTrackableUpdatedHandle);
+	UARBlueprintLibrary::ClearOnTrackableRemovedDelegate_Handle(OnTrackableRemovedHandle);
+
+	UE_LOG(LogHelloARManager, Log, TEXT("Plane pool: %d hits, %d misses, %d pooled"), PlanePoolHits, PlanePoolMisses, PlanePool.Num());
+
+	GetWorld()->GetSubsystem<UMatchRegistrySubsystem>()->UnregisterARManager(this);
+
+	Super::EndPlay(EndPlayReason);
+}
+
 // Called every frame
 void AHelloARManager::Tick(float DeltaTime)
 {
@@ -62,6 +99,11 @@ void AHelloARManager::Tick(float DeltaTime)
 		// If AR is running, update the planes and track images.
 	case EARSessionStatus::Running:
 		UpdatePlaneActors();
+		CommitPlaneMeshes();
+		if (bBatchPlaneRendering)
+		{
+			PlaneBatch->UpdateBatch();
+		}
 		UpdateImageTracking();
 		break;
 
@@ -77,82 +119,145 @@ void AHelloARManager::Tick(float DeltaTime)
 
 
 
+void AHelloARManager::OnTrackableAdded(UARTrackedGeometry* Geometry)
+{
+	OnTrackableUpdated(Geometry);
+}
+
+void AHelloARManager::OnTrackableUpdated(UARTrackedGeometry* Geometry)
+{
+	// Queue the geometry to be processed on the next tick.
+	if (UARPlaneGeometry* Plane = Cast<UARPlaneGeometry>(Geometry))
+	{
+		DirtyPlanes.Add(Plane);
+	}
+	else if (UARTrackedImage* Image = Cast<UARTrackedImage>(Geometry))
+	{
+		DirtyImages.Add(Image);
+	}
+}
+
+void AHelloARManager::OnTrackableRemoved(UARTrackedGeometry* Geometry)
+{
+	// Removed geometries report StoppedTracking, which is handled like any other update.
+	OnTrackableUpdated(Geometry);
+}
+
+void AHelloARManager::QueueAllTrackables()
+{
+	for (UARPlaneGeometry* Plane : UARBlueprintLibrary::GetAllGeometriesByClass<UARPlaneGeometry>())
+	{
+		DirtyPlanes.Add(Plane);
+	}
+
+	for (UARTrackedImage* Image : UARBlueprintLibrary::GetAllGeometriesByClass<UARTrackedImage>())
+	{
+		DirtyImages.Add(Image);
+	}
+}
+
 //Updates the geometry actors in the world
 void AHelloARManager::UpdatePlaneActors()
 {
-	// Get all world geometries and store in an array.
-	auto Geometries = UARBlueprintLibrary::GetAllGeometriesByClass<UARPlaneGeometry>();
-	bool bFound = false;
+	// Geometries that existed before the notifications were hooked up, or before a reset, are picked up with one full scan.
+	if (bNeedsFullSync)
+	{
+		bNeedsFullSync = false;
+		QueueAllTrackables();
+	}
 
-	// Loop through all geometries
-	for (auto& It : Geometries)
+	// Only look at the planes that changed since the last tick.
+	for (UARPlaneGeometry* It : DirtyPlanes)
 	{
+		if (!IsValid(It))
+		{
+			continue;
+		}
+
+		AARPlaneActor** Found = PlaneActors.Find(It);
+
 		// Check if current plane exists 
-		if (PlaneActors.Contains(It))
+		if (Found)
 		{
-			AARPlaneActor* CurrentPActor = *PlaneActors.Find(It);
+			AARPlaneActor* CurrentPActor = *Found;
 
-			// Check if plane is subsumed
-			if (It->GetSubsumedBy()->IsValidLowLevel())
+			// Check if plane is subsumed, or no longer tracked. Either way destroy the actor and remove it from the map.
+			if (It->GetSubsumedBy()->IsValidLowLevel() || It->GetTrackingState() == EARTrackingState::StoppedTracking)
 			{
-				CurrentPActor->Destroy();
+				ReleasePlaneActor(CurrentPActor);
 				PlaneActors.Remove(It);
-				break;
 			}
-			else
+			else if (It->GetTrackingState() == EARTrackingState::Tracking)
 			{
-				// Get tracking state switch
-				switch (It->GetTrackingState())
-				{
-					// If tracking update
-				case EARTrackingState::Tracking:
-					CurrentPActor->UpdatePlanePolygonMesh();
-					break;
-					// If not tracking destroy the actor and remove from map of actors
-				case EARTrackingState::StoppedTracking:
-					CurrentPActor->Destroy();
-					PlaneActors.Remove(It);
-					break;
-				}
+				// If tracking update
+				CurrentPActor->UpdatePlanePolygonMesh();
+				QueueMeshCommit(CurrentPActor);
 			}
 		}
-		else
+		else if (It->GetTrackingState() == EARTrackingState::Tracking && !It->GetSubsumedBy()->IsValidLowLevel())
+		{
+			// Spawn new planes, only when a plane has not been selected yet.
+			if (bPlaneSelected == false)
+			{
+				PlaneActor = AcquirePlaneActor();
+				PlaneActor->SetColor(GetPlaneColor(PlaneIndex));
+				PlaneActor->ARCorePlaneObject = It;
+
+				PlaneActors.Add(It, PlaneActor);
+				PlaneActor->UpdatePlanePolygonMesh();
+				QueueMeshCommit(PlaneActor);
+				PlaneIndex++;
+			}
+		}
+	}
+
+	DirtyPlanes.Reset();
+}
+
+void AHelloARManager::QueueMeshCommit(AARPlaneActor* Plane)
+{
+	if (Plane->IsMeshUpdatePending())
+	{
+		PendingMeshCommits.AddUnique(Plane);
+	}
+}
+
+void AHelloARManager::CommitPlaneMeshes()
+{
+	const double StartTime = FPlatformTime::Seconds();
+	const double Budget = MeshCommitBudgetMs / 1000.0;
+
+	// Commit finished meshes oldest first. Always commit at least one so large planes can't stall forever.
+	for (int i = 0; i < PendingMeshCommits.Num(); )
+	{
+		if (PendingMeshCommits[i]->CommitPendingMesh())
 		{
-			// Get tracking state switch
-			switch (It->GetTrackingState())
+			// Revisit the plane in case its boundary changed while the mesh was building.
+			if (PendingMeshCommits[i]->ARCorePlaneObject)
 			{
+				DirtyPlanes.Add(PendingMeshCommits[i]->ARCorePlaneObject);
+			}
+			PendingMeshCommits.RemoveAt(i);
 
-			case EARTrackingState::Tracking:
-				if (!It->GetSubsumedBy()->IsValidLowLevel())
-				{
-					// Spawn new planes, only when a plane has not been selected yet.
-					if (bPlaneSelected == false)
-					{
-						PlaneActor = SpawnPlaneActor();
-						PlaneActor->SetColor(GetPlaneColor(PlaneIndex));
-						PlaneActor->ARCorePlaneObject = It;
-
-						PlaneActors.Add(It, PlaneActor);
-						PlaneActor->UpdatePlanePolygonMesh();
-						PlaneIndex++;
-					}
-				}
+			if (FPlatformTime::Seconds() - StartTime > Budget)
+			{
 				break;
 			}
 		}
-
+		else
+		{
+			i++;
+		}
 	}
 }
 
 void AHelloARManager::UpdateImageTracking()
 {
-	// Get tracked images.
-	TArray<UARTrackedImage*> TrackedImages = UARBlueprintLibrary::GetAllGeometriesByClass<UARTrackedImage>();
-
-	for (auto TrackedImage : TrackedImages)
+	// Only look at the images that changed since the last tick.
+	for (auto TrackedImage : DirtyImages)
 	{
 		// Get detected image.
-		if (TrackedImage->GetDetectedImage())
+		if (IsValid(TrackedImage) && TrackedImage->GetDetectedImage())
 		{
 			// If the image is Van Gogh...
 			if (TrackedImage->GetDetectedImage()->GetFriendlyName().Equals("VanGogh"))
@@ -177,6 +282,8 @@ void AHelloARManager::UpdateImageTracking()
 			}
 		}
 	}
+
+	DirtyImages.Reset();
 }
 
 // Simple spawn function for the tracked AR planes
@@ -191,6 +298,45 @@ AARPlaneActor* AHelloARManager::SpawnPlaneActor()
 	return CustomPlane;
 }
 
+AARPlaneActor* AHelloARManager::AcquirePlaneActor()
+{
+	AARPlaneActor* Plane = nullptr;
+
+	if (PlanePool.Num() > 0)
+	{
+		Plane = PlanePool.Pop(false);
+		PlanePoolHits++;
+	}
+	else
+	{
+		Plane = SpawnPlaneActor();
+		PlanePoolMisses++;
+	}
+
+	Plane->SetActorHiddenInGame(false);
+	Plane->SetActorTickEnabled(true);
+
+	// Batched planes are drawn by the manager, and don't need to tick.
+	Plane->SetBatched(bBatchPlaneRendering);
+	if (bBatchPlaneRendering)
+	{
+		PlaneBatch->AddPlane(Plane);
+	}
+	return Plane;
+}
+
+void AHelloARManager::ReleasePlaneActor(AARPlaneActor* Plane)
+{
+	PendingMeshCommits.Remove(Plane);
+	PlaneBatch->RemovePlane(Plane);
+	if (Plane == ArenaPlane)
+	{
+		ArenaPlane = nullptr;
+	}
+	Plane->ResetForPool();
+	PlanePool.Add(Plane);
+}
+
 // Gets the colour to set the plane to when its spawned
 FColor AHelloARManager::GetPlaneColor(int Index)
 {
@@ -200,16 +346,20 @@ FColor AHelloARManager::GetPlaneColor(int Index)
 void AHelloARManager::ResetARCoreSession()
 {
 
-	// Get all actors in the level and destroy them as well as emptying the respective arrays and resetting plane selection.
-	TArray<AActor*> Planes;
-	UGameplayStatics::GetAllActorsOfClass(GetWorld(), AARPlaneActor::StaticClass(), Planes);
+	// Return all planes to the pool as well as emptying the respective arrays and resetting plane selection.
+	for (auto& It : PlaneActors)
+	{
+		ReleasePlaneActor(It.Value);
+	}
 
-	for ( auto& It : Planes)
-		It->Destroy();
-	
-	Planes.Empty();
 	PlaneActors.Empty();
+	PendingMeshCommits.Empty();
 	bPlaneSelected = false;
+
+	// Planes that are still tracked need new actors, so rescan everything once.
+	DirtyPlanes.Empty();
+	DirtyImages.Empty();
+	bNeedsFullSync = true;
 }
 
 // Sets the used plane for the arena and deletes the others.
@@ -218,14 +368,21 @@ void AHelloARManager::SetUsedPlane(UARPlaneGeometry* Plane)
 	// Set plane selected to true.
 	bPlaneSelected = true;
 
+	// Only the arena plane needs collision, for grenades and traces.
+	if (AARPlaneActor** Selected = PlaneActors.Find(Plane))
+	{
+		ArenaPlane = *Selected;
+		ArenaPlane->EnableArenaCollision();
+	}
+
 	// Iterate through the planes, and delete any that aren't the selected one.
-	for (auto P : PlaneActors)
+	for (auto P = PlaneActors.CreateIterator(); P; ++P)
 	{
-		if (P.Key != Plane)
+		if (P.Key() != Plane)
 		{
 			GEngine->AddOnScreenDebugMessage(-1, 2.0f, FColor::Yellow, TEXT("Plane deleted"));
-			P.Value->Destroy();
-			PlaneActors.Remove(P.Key);
+			ReleasePlaneActor(P.Value());
+			P.RemoveCurrent();
 		}
 	}
 }
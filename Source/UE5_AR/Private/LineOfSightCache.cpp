@@ -0,0 +1,193 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "LineOfSightCache.h"
+#include "ArenaSpatialIndex.h"
+#include "FighterPawn.h"
+#include "Obstacle.h"
+#include "Async/ParallelFor.h"
+
+void FLineOfSightCache::Update(const TArray<AFighterPawn*>& InFighters, const TArray<AObstacle*>& Obstacles, const FArenaSpatialIndex& InSpatialIndex)
+{
+	SpatialIndex = &InSpatialIndex;
+	LastRetraceCount = 0;
+
+	int Num = InFighters.Num();
+
+	if (Fighters != InFighters)
+	{
+		// Fighters were added or removed, so start the matrix again. Only happens while setting up.
+		Fighters = InFighters;
+		FighterIndices.Reset();
+		Centres.Reset(Num);
+		for (int i = 0; i < Num; i++)
+		{
+			FighterIndices.Add(Fighters[i], i);
+			Centres.Add(GetLocalCentre(Fighters[i]));
+		}
+		Obstructed.Init(false, Num * Num);
+		Dirty.Init(true, Num * Num);
+
+		// A fighter can't block its own line of sight.
+		for (int i = 0; i < Num; i++)
+		{
+			Dirty[GetPairIndex(i, i)] = false;
+		}
+	}
+	else
+	{
+		// Re-trace every pair involving a fighter that moved.
+		for (int i = 0; i < Num; i++)
+		{
+			FVector Centre = GetLocalCentre(Fighters[i]);
+			if (Centre.Equals(Centres[i], MoveTolerance))
+			{
+				continue;
+			}
+
+			Centres[i] = Centre;
+			for (int j = 0; j < Num; j++)
+			{
+				if (j == i)
+				{
+					continue;
+				}
+				Dirty[GetPairIndex(i, j)] = true;
+				Dirty[GetPairIndex(j, i)] = true;
+			}
+		}
+	}
+
+	// Re-trace pairs whose line an obstacle moved onto or off.
+	TSet<const AObstacle*> SeenObstacles;
+	for (AObstacle* Obstacle : Obstacles)
+	{
+		const FArenaSpatialEntry* Entry = InSpatialIndex.Find(Obstacle);
+		if (!Entry)
+		{
+			continue;
+		}
+		SeenObstacles.Add(Obstacle);
+
+		FBox Bounds(Entry->Center - Entry->Extent, Entry->Center + Entry->Extent);
+		FBox* OldBounds = ObstacleBounds.Find(Obstacle);
+		if (!OldBounds)
+		{
+			InvalidatePairsThrough(Bounds);
+			ObstacleBounds.Add(Obstacle, Bounds);
+		}
+		else if (!OldBounds->Min.Equals(Bounds.Min, MoveTolerance) || !OldBounds->Max.Equals(Bounds.Max, MoveTolerance))
+		{
+			InvalidatePairsThrough(*OldBounds);
+			InvalidatePairsThrough(Bounds);
+			*OldBounds = Bounds;
+		}
+	}
+
+	for (auto It = ObstacleBounds.CreateIterator(); It; ++It)
+	{
+		if (!SeenObstacles.Contains(It.Key()))
+		{
+			InvalidatePairsThrough(It.Value());
+			It.RemoveCurrent();
+		}
+	}
+
+	// Gather the dirty pairs. The matrix is mirrored, so only one half needs tracing.
+	TArray<FIntPoint> Pairs;
+	for (int i = 0; i < Num; i++)
+	{
+		for (int j = i + 1; j < Num; j++)
+		{
+			if (Dirty[GetPairIndex(i, j)])
+			{
+				Pairs.Add(FIntPoint(i, j));
+			}
+		}
+	}
+
+	if (Pairs.Num() == 0)
+	{
+		return;
+	}
+
+	// Trace on worker threads. Nothing writes to the spatial index until this returns.
+	TArray<bool> Results;
+	Results.SetNumZeroed(Pairs.Num());
+	ParallelFor(Pairs.Num(), [this, &Pairs, &Results, &InSpatialIndex](int32 k)
+	{
+		Results[k] = TraceObstacles(InSpatialIndex, Centres[Pairs[k].X], Centres[Pairs[k].Y]);
+	});
+
+	for (int k = 0; k < Pairs.Num(); k++)
+	{
+		int A = Pairs[k].X;
+		int B = Pairs[k].Y;
+		Obstructed[GetPairIndex(A, B)] = Results[k];
+		Obstructed[GetPairIndex(B, A)] = Results[k];
+		Dirty[GetPairIndex(A, B)] = false;
+		Dirty[GetPairIndex(B, A)] = false;
+	}
+
+	LastRetraceCount = Pairs.Num();
+}
+
+bool FLineOfSightCache::IsObstructed(AFighterPawn* From, AFighterPawn* To) const
+{
+	if (!SpatialIndex || !From || !To)
+	{
+		return false;
+	}
+
+	FVector FromCentre = GetLocalCentre(From);
+	FVector ToCentre = GetLocalCentre(To);
+
+	// Use the cached result if neither fighter has moved since it was traced.
+	const int* A = FighterIndices.Find(From);
+	const int* B = FighterIndices.Find(To);
+	if (A && B && !Dirty[GetPairIndex(*A, *B)] && FromCentre.Equals(Centres[*A], MoveTolerance) && ToCentre.Equals(Centres[*B], MoveTolerance))
+	{
+		return Obstructed[GetPairIndex(*A, *B)];
+	}
+
+	return TraceObstacles(*SpatialIndex, FromCentre, ToCentre);
+}
+
+void FLineOfSightCache::Reset()
+{
+	SpatialIndex = nullptr;
+	Fighters.Reset();
+	Centres.Reset();
+	FighterIndices.Reset();
+	ObstacleBounds.Reset();
+	Obstructed.Empty();
+	Dirty.Empty();
+	LastRetraceCount = 0;
+}
+
+void FLineOfSightCache::InvalidatePairsThrough(const FBox& Box)
+{
+	int Num = Fighters.Num();
+	for (int i = 0; i < Num; i++)
+	{
+		for (int j = i + 1; j < Num; j++)
+		{
+			int Pair = GetPairIndex(i, j);
+			if (!Dirty[Pair] && FMath::LineBoxIntersection(Box, Centres[i], Centres[j], Centres[j] - Centres[i]))
+			{
+				Dirty[Pair] = true;
+				Dirty[GetPairIndex(j, i)] = true;
+			}
+		}
+	}
+}
+
+FVector FLineOfSightCache::GetLocalCentre(AFighterPawn* Fighter) const
+{
+	return SpatialIndex->GetArenaTransform().InverseTransformPosition(Fighter->GetCentreLocation());
+}
+
+bool FLineOfSightCache::TraceObstacles(const FArenaSpatialIndex& Index, const FVector& Start, const FVector& End)
+{
+	return Index.IsSegmentBlocked(Start, End, [](const FArenaSpatialEntry& Entry) { return Entry.Kind == EArenaEntryKind::Obstacle; });
+}
@@ -0,0 +1,469 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MatchBenchmarkSubsystem.h"
+#include "CustomARPawn.h"
+#include "FighterPawn.h"
+#include "ARBlueprintLibrary.h"
+#include "ARTrackable.h"
+#include "Misc/CoreDelegates.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Dom/JsonObject.h"
+#include "Serialization/JsonSerializer.h"
+#include "Serialization/JsonWriter.h"
+#include "Kismet/GameplayStatics.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogMatchBenchmark, Log, All);
+
+// Allocator wrapper that counts game thread allocations while a benchmark frame is being measured.
+class FBenchmarkCountingMalloc : public FMalloc
+{
+public:
+	FBenchmarkCountingMalloc(FMalloc* InInner) : Inner(InInner) {}
+
+	virtual void* Malloc(SIZE_T Count, uint32 Alignment) override
+	{
+		if (bIsCounting)
+		{
+			Allocations++;
+		}
+		return Inner->Malloc(Count, Alignment);
+	}
+
+	virtual void* Realloc(void* Original, SIZE_T Count, uint32 Alignment) override
+	{
+		if (bIsCounting)
+		{
+			Allocations++;
+		}
+		return Inner->Realloc(Original, Count, Alignment);
+	}
+
+	virtual void Free(void* Original) override { Inner->Free(Original); }
+	virtual bool GetAllocationSize(void* Original, SIZE_T& SizeOut) override { return Inner->GetAllocationSize(Original, SizeOut); }
+	virtual SIZE_T QuantizeSize(SIZE_T Count, uint32 Alignment) override { return Inner->QuantizeSize(Count, Alignment); }
+	virtual void Trim(bool bTrimThreadCaches) override { Inner->Trim(bTrimThreadCaches); }
+	virtual void SetupTLSCachesOnCurrentThread() override { Inner->SetupTLSCachesOnCurrentThread(); }
+	virtual void ClearAndDisableTLSCachesOnCurrentThread() override { Inner->ClearAndDisableTLSCachesOnCurrentThread(); }
+	virtual bool IsInternallyThreadSafe() const override { return Inner->IsInternallyThreadSafe(); }
+	virtual void UpdateStats() override { Inner->UpdateStats(); }
+	virtual void GetAllocatorStats(FGenericMemoryStats& OutStats) override { Inner->GetAllocatorStats(OutStats); }
+	virtual void DumpAllocatorStats(FOutputDevice& Ar) override { Inner->DumpAllocatorStats(Ar); }
+	virtual const TCHAR* GetDescriptiveName() override { return Inner->GetDescriptiveName(); }
+
+	// Only ever set on the game thread, so allocations on other threads are never counted.
+	static thread_local bool bIsCounting;
+
+	// Only incremented while the game thread is counting.
+	static uint64 Allocations;
+
+private:
+	FMalloc* Inner;
+};
+
+thread_local bool FBenchmarkCountingMalloc::bIsCounting = false;
+uint64 FBenchmarkCountingMalloc::Allocations = 0;
+
+static bool bIsCountingMallocInstalled = false;
+
+// Value at the given percentile of a sorted array.
+static float GetPercentile(const TArray<float>& Sorted, float Percentile)
+{
+	if (Sorted.Num() == 0)
+	{
+		return 0.0f;
+	}
+	int32 Index = FMath::Clamp(FMath::CeilToInt(Percentile * Sorted.Num()) - 1, 0, Sorted.Num() - 1);
+	return Sorted[Index];
+}
+
+void UMatchBenchmarkSubsystem::InstallAllocationCounter()
+{
+	if (bIsCountingMallocInstalled || FCString::Strifind(FCommandLine::Get(), TEXT("-MatchBenchmark")) == nullptr)
+	{
+		return;
+	}
+
+	// The wrapper forwards everything to the allocator it replaces, so threads still holding the old GMalloc stay safe.
+	GMalloc = new FBenchmarkCountingMalloc(GMalloc);
+	bIsCountingMallocInstalled = true;
+}
+
+bool UMatchBenchmarkSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	return FCString::Strifind(FCommandLine::Get(), TEXT("-MatchBenchmark")) != nullptr;
+}
+
+void UMatchBenchmarkSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	// Default values.
+	Step = EBenchmarkStep::WaitForSession;
+	WaitTime = 0.0f;
+	TurnsPlayed = 0;
+	MaxTurns = 60;
+	PlacementIndex = 0;
+	FrameStartTime = 0.0;
+	FrameStartAllocations = 0;
+	FrameStartPhase = EGamePhase::MENU;
+	BenchmarkStartTime = FPlatformTime::Seconds();
+
+	UWorld* World = GetWorld();
+	if (!World || !World->IsGameWorld())
+	{
+		Step = EBenchmarkStep::Finished;
+		return;
+	}
+
+	FParse::Value(FCommandLine::Get(), TEXT("MatchBenchmarkTurns="), MaxTurns);
+	if (!FParse::Value(FCommandLine::Get(), TEXT("MatchBenchmark="), OutputPath))
+	{
+		OutputPath = FPaths::Combine(FPaths::ProfilingDir(), TEXT("MatchBenchmark.json"));
+	}
+
+	if (!bIsCountingMallocInstalled)
+	{
+		UE_LOG(LogMatchBenchmark, Warning, TEXT("Allocation counter isn't installed, allocations will be reported as 0"));
+	}
+
+	BeginFrameHandle = FCoreDelegates::OnBeginFrame.AddUObject(this, &UMatchBenchmarkSubsystem::OnBeginFrame);
+	EndFrameHandle = FCoreDelegates::OnEndFrame.AddUObject(this, &UMatchBenchmarkSubsystem::OnEndFrame);
+
+	UE_LOG(LogMatchBenchmark, Log, TEXT("Match benchmark running, results will be written to %s"), *OutputPath);
+}
+
+void UMatchBenchmarkSubsystem::Deinitialize()
+{
+	FCoreDelegates::OnBeginFrame.Remove(BeginFrameHandle);
+	FCoreDelegates::OnEndFrame.Remove(EndFrameHandle);
+	FBenchmarkCountingMalloc::bIsCounting = false;
+
+	Super::Deinitialize();
+}
+
+TStatId UMatchBenchmarkSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UMatchBenchmarkSubsystem, STATGROUP_Tickables);
+}
+
+void UMatchBenchmarkSubsystem::OnBeginFrame()
+{
+	ACustomGameMode* GM = GetWorld()->GetAuthGameMode<ACustomGameMode>();
+	FrameStartPhase = GM ? GM->CurrentPhase : EGamePhase::MENU;
+	FrameStartAllocations = FBenchmarkCountingMalloc::Allocations;
+	FrameStartTime = FPlatformTime::Seconds();
+	FBenchmarkCountingMalloc::bIsCounting = true;
+}
+
+void UMatchBenchmarkSubsystem::OnEndFrame()
+{
+	FBenchmarkCountingMalloc::bIsCounting = false;
+
+	if (Step == EBenchmarkStep::Finished || FrameStartTime == 0.0)
+	{
+		return;
+	}
+
+	// Cost of this frame, attributed to the phase it started in.
+	float FrameMs = (float)((FPlatformTime::Seconds() - FrameStartTime) * 1000.0);
+	uint64 FrameAllocations = FBenchmarkCountingMalloc::Allocations - FrameStartAllocations;
+
+	FrameTimesMs.Add(FrameMs);
+
+	FBenchmarkPhaseStats& Stats = PhaseStats.FindOrAdd(FrameStartPhase);
+	Stats.Frames++;
+	Stats.TotalMs += FrameMs;
+	Stats.Allocations += FrameAllocations;
+}
+
+// Called every frame
+void UMatchBenchmarkSubsystem::Tick(float DeltaTime)
+{
+	if (Step == EBenchmarkStep::Finished)
+	{
+		return;
+	}
+
+	ACustomGameMode* GM = GetWorld()->GetAuthGameMode<ACustomGameMode>();
+	ACustomARPawn* Pawn = Cast<ACustomARPawn>(UGameplayStatics::GetPlayerPawn(GetWorld(), 0));
+	if (!GM || !Pawn)
+	{
+		return;
+	}
+
+	// The game can end on any step.
+	if (GM->CurrentPhase == EGamePhase::GAME_END)
+	{
+		Finish();
+		return;
+	}
+
+	// Let the previous action play out.
+	if (WaitTime > 0.0f)
+	{
+		WaitTime -= DeltaTime;
+		return;
+	}
+
+	switch (Step)
+	{
+	case EBenchmarkStep::WaitForSession:
+		// Start the game as the menu would, once AR is running.
+		if (UARBlueprintLibrary::GetARSessionStatus().Status == EARSessionStatus::Running)
+		{
+			GM->StartGame();
+			Step = EBenchmarkStep::PickPlane;
+		}
+		break;
+
+	case EBenchmarkStep::PickPlane:
+		PickPlane(GM, Pawn);
+		break;
+
+	case EBenchmarkStep::PlaceObstacles:
+		PlaceObstacles(GM, Pawn);
+		break;
+
+	case EBenchmarkStep::PlaceFighters:
+		PlaceFighters(GM, Pawn);
+		break;
+
+	case EBenchmarkStep::TakeTurn:
+		TakeTurn(GM, Pawn);
+		break;
+
+	case EBenchmarkStep::WaitForTurn:
+		// Finish the turn as the end turn button would.
+		GM->CurrentPhase = EGamePhase::TURN_IDLE;
+		GM->EndTurn();
+		TurnsPlayed++;
+		Step = EBenchmarkStep::TakeTurn;
+		if (TurnsPlayed >= MaxTurns)
+		{
+			Finish();
+		}
+		break;
+
+	default:
+		break;
+	}
+}
+
+void UMatchBenchmarkSubsystem::PickPlane(ACustomGameMode* GM, ACustomARPawn* Pawn)
+{
+	// Use the largest tracked plane as the arena.
+	UARPlaneGeometry* Largest = nullptr;
+	for (UARPlaneGeometry* Plane : UARBlueprintLibrary::GetAllGeometriesByClass<UARPlaneGeometry>())
+	{
+		if (Plane->GetTrackingState() == EARTrackingState::Tracking && !Plane->GetSubsumedBy())
+		{
+			if (!Largest || Plane->GetExtent().SizeSquared2D() > Largest->GetExtent().SizeSquared2D())
+			{
+				Largest = Plane;
+			}
+		}
+	}
+
+	if (!Largest)
+	{
+		return;
+	}
+
+	PlaneTransform = Largest->GetLocalToWorldTransform();
+	PlaneTransform.SetLocation(PlaneTransform.TransformPosition(Largest->GetCenter()));
+	PlaneExtent = Largest->GetExtent();
+
+	// Tap the middle of the plane to select it.
+	TouchWorldLocation(Pawn, PlaneTransform.GetLocation());
+	if (GM->CurrentPhase == EGamePhase::OBSTACLE_SETUP)
+	{
+		PlacementIndex = 0;
+		Step = EBenchmarkStep::PlaceObstacles;
+	}
+}
+
+void UMatchBenchmarkSubsystem::PlaceObstacles(ACustomGameMode* GM, ACustomARPawn* Pawn)
+{
+	// A line of obstacles across the middle of the arena.
+	static const FVector2D ObstaclePoints[] = { FVector2D(0.0f, 0.0f), FVector2D(-0.5f, 0.0f), FVector2D(0.5f, 0.0f) };
+
+	if (PlacementIndex < UE_ARRAY_COUNT(ObstaclePoints))
+	{
+		TouchWorldLocation(Pawn, GetPlanePoint(ObstaclePoints[PlacementIndex]));
+		PlacementIndex++;
+		return;
+	}
+
+	// Move on as the UI button would.
+	GM->CurrentPhase = EGamePhase::PAWN_SETUP;
+	PlacementIndex = 0;
+	Step = EBenchmarkStep::PlaceFighters;
+}
+
+void UMatchBenchmarkSubsystem::PlaceFighters(ACustomGameMode* GM, ACustomARPawn* Pawn)
+{
+	// Each team gets a row, red on one side of the obstacles and the last team on the other. Fighters are spread along the row.
+	int32 Team = GM->CurrentTeam;
+	int32 TeamIndex = GM->GetTeam(Team).Num();
+	float Along = GM->GetPawnsPerTeam() > 1 ? FMath::Lerp(-0.6f, 0.6f, (float)TeamIndex / (GM->GetPawnsPerTeam() - 1)) : 0.0f;
+	float Across = FMath::Lerp(-0.5f, 0.5f, (float)Team / FMath::Max(GM->GetNumTeams() - 1, 1));
+
+	TouchWorldLocation(Pawn, GetPlanePoint(FVector2D(Along, Across)));
+
+	// The game mode starts the first turn once everyone is placed.
+	if (GM->CurrentPhase == EGamePhase::TURN_IDLE)
+	{
+		Step = EBenchmarkStep::TakeTurn;
+	}
+
+	// Give up if the arena is too small to place everyone.
+	if (++PlacementIndex > GM->GetPawnsPerTeam() * 8)
+	{
+		UE_LOG(LogMatchBenchmark, Error, TEXT("Could not place all fighters"));
+		Finish();
+	}
+}
+
+void UMatchBenchmarkSubsystem::TakeTurn(ACustomGameMode* GM, ACustomARPawn* Pawn)
+{
+	AFighterPawn* Fighter = GM->CurrentFighter;
+	if (!Fighter)
+	{
+		return;
+	}
+
+	// Rotate between shooting, moving and throwing grenades.
+	switch (TurnsPlayed % 3)
+	{
+	case 0:
+	{
+		// Target the first living enemy, then shoot.
+		GM->CurrentPhase = EGamePhase::TURN_SHOOT;
+		AFighterPawn* Target = nullptr;
+		for (int32 Team = 0; Team < GM->GetNumTeams() && !Target; Team++)
+		{
+			if (Team == GM->CurrentTeam)
+			{
+				continue;
+			}
+
+			for (AFighterPawn* Enemy : GM->GetTeam(Team))
+			{
+				if (!Enemy->GetIsDead())
+				{
+					Target = Enemy;
+					break;
+				}
+			}
+		}
+		if (Target)
+		{
+			TouchWorldLocation(Pawn, Target->GetActorLocation());
+		}
+		Fighter->Shoot();
+		WaitTime = 0.5f;
+		break;
+	}
+	case 1:
+		// Walk towards the middle of the arena.
+		GM->CurrentPhase = EGamePhase::TURN_MOVEMENT;
+		TouchWorldLocation(Pawn, FMath::Lerp(Fighter->GetActorLocation(), PlaneTransform.GetLocation(), 0.5f));
+		WaitTime = 2.0f;
+		break;
+
+	case 2:
+	{
+		// Drag across the screen to throw.
+		GM->CurrentPhase = EGamePhase::TURN_GRENADE;
+		FVector2D ViewportSize(1280.0f, 720.0f);
+		if (GEngine && GEngine->GameViewport)
+		{
+			GEngine->GameViewport->GetViewportSize(ViewportSize);
+		}
+		FVector Start(ViewportSize.X * 0.5f, ViewportSize.Y * 0.75f, 0.0f);
+		FVector End(ViewportSize.X * 0.5f, ViewportSize.Y * 0.25f, 0.0f);
+		Touch(Pawn, Start, End);
+
+		// Release and fuse time.
+		WaitTime = 2.5f;
+		break;
+	}
+	}
+
+	Step = EBenchmarkStep::WaitForTurn;
+}
+
+bool UMatchBenchmarkSubsystem::TouchWorldLocation(ACustomARPawn* Pawn, const FVector& Location)
+{
+	APlayerController* PlayerController = UGameplayStatics::GetPlayerController(GetWorld(), 0);
+	FVector2D ScreenPos;
+	if (!UGameplayStatics::ProjectWorldToScreen(PlayerController, Location, ScreenPos))
+	{
+		return false;
+	}
+
+	Touch(Pawn, FVector(ScreenPos, 0.0f), FVector(ScreenPos, 0.0f));
+	return true;
+}
+
+void UMatchBenchmarkSubsystem::Touch(ACustomARPawn* Pawn, const FVector& ScreenPos, const FVector& ReleasePos)
+{
+	Pawn->OnScreenTouch(ETouchIndex::Touch1, ScreenPos);
+	Pawn->OnScreenTouchHeld(ETouchIndex::Touch1, ReleasePos);
+	Pawn->OnScreenTouchReleased(ETouchIndex::Touch1, ReleasePos);
+}
+
+FVector UMatchBenchmarkSubsystem::GetPlanePoint(const FVector2D& LocalPoint) const
+{
+	// Stay well inside the plane's extent.
+	FVector Local(LocalPoint.X * PlaneExtent.X * 0.8f, LocalPoint.Y * PlaneExtent.Y * 0.8f, 0.0f);
+	return PlaneTransform.TransformPosition(Local);
+}
+
+void UMatchBenchmarkSubsystem::Finish()
+{
+	Step = EBenchmarkStep::Finished;
+
+	TArray<float> Sorted = FrameTimesMs;
+	Sorted.Sort();
+
+	uint64 TotalAllocations = 0;
+	TArray<TSharedPtr<FJsonValue>> Phases;
+	const UEnum* PhaseEnum = StaticEnum<EGamePhase>();
+	for (const auto& It : PhaseStats)
+	{
+		TSharedRef<FJsonObject> Phase = MakeShared<FJsonObject>();
+		Phase->SetStringField(TEXT("phase"), PhaseEnum->GetNameStringByValue((int64)It.Key));
+		Phase->SetNumberField(TEXT("frames"), It.Value.Frames);
+		Phase->SetNumberField(TEXT("total_ms"), It.Value.TotalMs);
+		Phase->SetNumberField(TEXT("mean_ms"), It.Value.Frames > 0 ? It.Value.TotalMs / It.Value.Frames : 0.0);
+		Phase->SetNumberField(TEXT("allocations"), (double)It.Value.Allocations);
+		Phases.Add(MakeShared<FJsonValueObject>(Phase));
+
+		TotalAllocations += It.Value.Allocations;
+	}
+
+	TSharedRef<FJsonObject> Root = MakeShared<FJsonObject>();
+	Root->SetStringField(TEXT("build"), LexToString(FApp::GetBuildConfiguration()));
+	Root->SetStringField(TEXT("changelist"), FApp::GetBuildVersion());
+	Root->SetNumberField(TEXT("turns"), TurnsPlayed);
+	Root->SetNumberField(TEXT("frames"), FrameTimesMs.Num());
+	Root->SetNumberField(TEXT("wall_seconds"), FPlatformTime::Seconds() - BenchmarkStartTime);
+	Root->SetNumberField(TEXT("p50_ms"), GetPercentile(Sorted, 0.50f));
+	Root->SetNumberField(TEXT("p95_ms"), GetPercentile(Sorted, 0.95f));
+	Root->SetNumberField(TEXT("p99_ms"), GetPercentile(Sorted, 0.99f));
+	Root->SetNumberField(TEXT("max_ms"), Sorted.Num() > 0 ? Sorted.Last() : 0.0f);
+	Root->SetNumberField(TEXT("allocations"), (double)TotalAllocations);
+	Root->SetArrayField(TEXT("phases"), Phases);
+
+	FString Output;
+	TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&Output);
+	FJsonSerializer::Serialize(Root, Writer);
+	FFileHelper::SaveStringToFile(Output, *OutputPath);
+
+	UE_LOG(LogMatchBenchmark, Log, TEXT("Match benchmark finished: %d frames, p50 %.2fms, p95 %.2fms, p99 %.2fms"), FrameTimesMs.Num(), GetPercentile(Sorted, 0.50f), GetPercentile(Sorted, 0.95f), GetPercentile(Sorted, 0.99f));
+
+	FPlatformMisc::RequestExit(false);
+}
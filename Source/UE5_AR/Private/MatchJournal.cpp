@@ -0,0 +1,553 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MatchJournal.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformFileManager.h"
+#include "Async/MappedFileHandle.h"
+#include "Misc/FileHelper.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogMatchJournal, Log, All);
+
+static const uint32 JournalMagic = 0x4C4E4A4D;
+static const uint16 JournalVersion = 4;
+
+// Each record starts with its type byte and a two byte size.
+static const int RecordHeaderSize = 3;
+
+// Small ints are stored as two signed bytes. Teams, slots and counts that don't fit mark the archive as failed rather
+// than wrapping round.
+// *** //
+static void SerializeShort(FArchive& Ar, int& Value)
+{
+	int16 Short = Value;
+	if (Ar.IsSaving() && Short != Value)
+	{
+		UE_LOG(LogMatchJournal, Error, TEXT("%d is too big to store in the match journal"), Value);
+		Ar.SetError();
+	}
+	Ar << Short;
+	Value = Short;
+}
+
+static void SerializeFlag(FArchive& Ar, bool& Value)
+{
+	uint8 Byte = Value;
+	Ar << Byte;
+	Value = Byte != 0;
+}
+// *** //
+
+// Vectors are stored single precision, which is plenty in arena space.
+static void SerializeVector(FArchive& Ar, FVector& Value)
+{
+	FVector3f Single(Value);
+	Ar << Single;
+	Value = FVector(Single);
+}
+
+static void SerializeRecord(FArchive& Ar, FMatchJournalRecord& Record)
+{
+	switch (Record.Type)
+	{
+	case EMatchJournalRecord::SpawnFighter:
+		SerializeShort(Ar, Record.Team);
+		SerializeShort(Ar, Record.Slot);
+		SerializeVector(Ar, Record.Location);
+		SerializeVector(Ar, Record.Vector);
+		break;
+	case EMatchJournalRecord::SpawnObstacle:
+		SerializeVector(Ar, Record.Location);
+		SerializeVector(Ar, Record.Vector);
+		break;
+	case EMatchJournalRecord::SetUsedPlane:
+	{
+		FQuat4f Rotation(Record.Rotation);
+		SerializeVector(Ar, Record.Location);
+		Ar << Rotation;
+		SerializeVector(Ar, Record.Vector);
+		Record.Rotation = FQuat(Rotation);
+		break;
+	}
+	case EMatchJournalRecord::SelectTarget:
+	case EMatchJournalRecord::Shoot:
+		SerializeShort(Ar, Record.Team);
+		SerializeShort(Ar, Record.Slot);
+		SerializeShort(Ar, Record.TargetTeam);
+		SerializeShort(Ar, Record.TargetSlot);
+		if (Record.Type == EMatchJournalRecord::Shoot)
+		{
+			SerializeFlag(Ar, Record.bHit);
+		}
+		break;
+	case EMatchJournalRecord::Damage:
+		SerializeShort(Ar, Record.Team);
+		SerializeShort(Ar, Record.Slot);
+		Ar << Record.Value;
+		break;
+	case EMatchJournalRecord::MoveTo:
+		SerializeShort(Ar, Record.Team);
+		SerializeShort(Ar, Record.Slot);
+		SerializeVector(Ar, Record.Location);
+		break;
+	case EMatchJournalRecord::ThrowGrenade:
+		SerializeShort(Ar, Record.Team);
+		SerializeShort(Ar, Record.Slot);
+		SerializeVector(Ar, Record.Vector);
+		break;
+	case EMatchJournalRecord::Explode:
+		SerializeVector(Ar, Record.Location);
+		break;
+	case EMatchJournalRecord::StartTurn:
+		SerializeShort(Ar, Record.Team);
+		SerializeShort(Ar, Record.Slot);
+		break;
+	case EMatchJournalRecord::EndTurn:
+		SerializeShort(Ar, Record.Team);
+		SerializeShort(Ar, Record.Slot);
+		SerializeVector(Ar, Record.Location);
+		Ar << Record.Value;
+		break;
+	default:
+		break;
+	}
+}
+
+static void SerializeArena(FArchive& Ar, FArena& Arena)
+{
+	FArenaRules& Rules = Arena.Rules;
+	Ar << Rules.MaxHealth << Rules.MinRange << Rules.MaxRange << Rules.MinDamage << Rules.MaxDamage;
+	Ar << Rules.ObstructedHitPenalty << Rules.ObstructedDamagePenalty << Rules.MovableDistance << Rules.MoveLookahead;
+	Ar << Rules.GrenadeDamage << Rules.GrenadeRadius << Rules.GrenadeFalloff;
+
+	Ar << Arena.Seed;
+	Ar << Arena.TurnCount;
+	SerializeShort(Ar, Arena.NumTeams);
+	SerializeFlag(Ar, Arena.bInitiativeOrder);
+	SerializeShort(Ar, Arena.CurrentTeam);
+	SerializeShort(Ar, Arena.CurrentFighter);
+	SerializeFlag(Ar, Arena.bIsOver);
+	SerializeShort(Ar, Arena.WinningTeam);
+
+	int NumLastFighters = Arena.LastFighters.Num();
+	SerializeShort(Ar, NumLastFighters);
+	Arena.LastFighters.SetNum(NumLastFighters);
+	for (int& LastFighter : Arena.LastFighters)
+	{
+		SerializeShort(Ar, LastFighter);
+	}
+
+	int NumFighters = Arena.Fighters.Num();
+	SerializeShort(Ar, NumFighters);
+	Arena.Fighters.SetNum(NumFighters);
+	for (FArenaFighter& Fighter : Arena.Fighters)
+	{
+		SerializeShort(Ar, Fighter.Team);
+		SerializeShort(Ar, Fighter.Slot);
+		SerializeVector(Ar, Fighter.Location);
+		SerializeVector(Ar, Fighter.Extent);
+		Ar << Fighter.Health << Fighter.Initiative << Fighter.NextTurnTime << Fighter.DistanceMoved << Fighter.Rolls;
+		SerializeFlag(Ar, Fighter.bHasShot);
+		SerializeFlag(Ar, Fighter.bHasGrenade);
+		SerializeFlag(Ar, Fighter.bIsDead);
+	}
+
+	int NumObstacles = Arena.Obstacles.Num();
+	SerializeShort(Ar, NumObstacles);
+	Arena.Obstacles.SetNum(NumObstacles);
+	for (FArenaObstacle& Obstacle : Arena.Obstacles)
+	{
+		SerializeVector(Ar, Obstacle.Center);
+		SerializeVector(Ar, Obstacle.Extent);
+	}
+}
+
+FMatchJournalWriter::~FMatchJournalWriter()
+{
+	Close();
+}
+
+bool FMatchJournalWriter::Open(const FString& Path, uint64 Seed, int NumTeams)
+{
+	Close();
+
+	File.Reset(IFileManager::Get().CreateFileWriter(*Path));
+	if (!File)
+	{
+		UE_LOG(LogMatchJournal, Error, TEXT("Couldn't open match journal %s"), *Path);
+		return false;
+	}
+
+	uint32 Magic = JournalMagic;
+	uint16 Version = JournalVersion;
+	*File << Magic << Version << Seed;
+	SerializeShort(*File, NumTeams);
+	if (File->IsError())
+	{
+		Close();
+		return false;
+	}
+	Turns = 0;
+	return true;
+}
+
+void FMatchJournalWriter::Close()
+{
+	if (File)
+	{
+		File->Close();
+		File.Reset();
+	}
+}
+
+void FMatchJournalWriter::Write(const FMatchJournalRecord& Record)
+{
+	if (!File)
+	{
+		return;
+	}
+
+	Buffer.Reset();
+	FMemoryWriter Writer(Buffer);
+	FMatchJournalRecord Copy = Record;
+	SerializeRecord(Writer, Copy);
+	if (!Commit(Record.Type, Writer))
+	{
+		return;
+	}
+
+	// Keep whole turns on disk, so a crash loses at most the turn in progress.
+	if (Record.Type == EMatchJournalRecord::EndTurn)
+	{
+		File->Flush();
+	}
+}
+
+void FMatchJournalWriter::WriteStartTurn(const FMatchJournalRecord& Record, FArena& Arena)
+{
+	if (!File)
+	{
+		return;
+	}
+
+	Write(Record);
+	if (!File)
+	{
+		return;
+	}
+	Turns++;
+
+	if ((Turns - 1) % FMath::Max(KeyframeInterval, 1) == 0)
+	{
+		// The turn number goes first, so the reader can index keyframes without reading them.
+		Arena.TurnCount = Turns;
+		Buffer.Reset();
+		FMemoryWriter Writer(Buffer);
+		int32 Turn = Turns;
+		Writer << Turn;
+		SerializeArena(Writer, Arena);
+		Commit(EMatchJournalRecord::Keyframe, Writer);
+	}
+}
+
+bool FMatchJournalWriter::Commit(EMatchJournalRecord Type, const FArchive& Writer)
+{
+	// A journal that can't hold the match is no use, so stop rather than write a broken record.
+	if (Writer.IsError() || Buffer.Num() > MAX_uint16)
+	{
+		UE_LOG(LogMatchJournal, Error, TEXT("A %d byte record doesn't fit in the match journal, so recording has stopped"), Buffer.Num());
+		Close();
+		return false;
+	}
+
+	uint8 TypeByte = (uint8)Type;
+	uint16 Size = Buffer.Num();
+	*File << TypeByte << Size;
+	File->Serialize(Buffer.GetData(), Buffer.Num());
+	return true;
+}
+
+FMatchJournalReader::FMatchJournalReader()
+{
+}
+
+FMatchJournalReader::~FMatchJournalReader()
+{
+	Close();
+}
+
+bool FMatchJournalReader::Open(const FString& Path)
+{
+	Close();
+
+	// Map the file if the platform can, otherwise load it.
+	MappedFile.Reset(FPlatformFileManager::Get().GetPlatformFile().OpenMapped(*Path));
+	if (MappedFile)
+	{
+		MappedRegion.Reset(MappedFile->MapRegion(0, MappedFile->GetFileSize()));
+	}
+
+	if (MappedRegion)
+	{
+		Data = TArrayView<const uint8>(MappedRegion->GetMappedPtr(), (int32)MappedRegion->GetMappedSize());
+	}
+	else if (FFileHelper::LoadFileToArray(LoadedFile, *Path))
+	{
+		Data = LoadedFile;
+	}
+	else
+	{
+		UE_LOG(LogMatchJournal, Error, TEXT("Couldn't open match journal %s"), *Path);
+		return false;
+	}
+
+	FMemoryReaderView Header(Data);
+	uint32 Magic = 0;
+	uint16 Version = 0;
+	Header << Magic << Version << Seed;
+	SerializeShort(Header, NumTeams);
+	if (Header.IsError() || Magic != JournalMagic || Version != JournalVersion)
+	{
+		UE_LOG(LogMatchJournal, Error, TEXT("%s isn't a match journal this version can read"), *Path);
+		Close();
+		return false;
+	}
+	FirstRecordOffset = (int)Header.Tell();
+
+	// Walk the record headers, noting keyframes, turns and the plane each keyframe was recorded on.
+	int Offset = FirstRecordOffset;
+	int PlaneOffset = INDEX_NONE;
+	while (Offset + RecordHeaderSize <= Data.Num())
+	{
+		EMatchJournalRecord Type = (EMatchJournalRecord)Data[Offset];
+		FMemoryReaderView Record(Data.Slice(Offset + 1, Data.Num() - Offset - 1));
+		uint16 Size = 0;
+		Record << Size;
+
+		// A session that crashed mid-write leaves a partial record at the end.
+		if (Offset + RecordHeaderSize + Size > Data.Num())
+		{
+			break;
+		}
+
+		if (Type == EMatchJournalRecord::Keyframe)
+		{
+			FKeyframe& Keyframe = Keyframes.AddDefaulted_GetRef();
+			Keyframe.Offset = Offset;
+			Keyframe.PlaneOffset = PlaneOffset;
+			Record << Keyframe.Turn;
+		}
+		else if (Type == EMatchJournalRecord::SetUsedPlane)
+		{
+			PlaneOffset = Offset;
+		}
+		else if (Type == EMatchJournalRecord::StartTurn)
+		{
+			NumTurns++;
+		}
+
+		NumRecords++;
+		Offset += RecordHeaderSize + Size;
+	}
+	Data = Data.Left(Offset);
+
+	Rewind();
+	return true;
+}
+
+void FMatchJournalReader::Close()
+{
+	// The region has to go before the file it maps.
+	MappedRegion.Reset();
+	MappedFile.Reset();
+	LoadedFile.Empty();
+	Data = TArrayView<const uint8>();
+
+	Keyframes.Reset();
+	NumRecords = 0;
+	NumTurns = 0;
+	ReadOffset = 0;
+}
+
+bool FMatchJournalReader::SeekToTurn(int Turn)
+{
+	if (Data.Num() == 0 || Turn < 0 || Turn > NumTurns)
+	{
+		return false;
+	}
+
+	// Start from the last keyframe at or before the turn.
+	const FKeyframe* Start = nullptr;
+	for (const FKeyframe& Keyframe : Keyframes)
+	{
+		if (Keyframe.Turn <= Turn)
+		{
+			Start = &Keyframe;
+		}
+	}
+
+	FMatchJournalRecord Record;
+	if (Start)
+	{
+		// Keyframes hold the arena but not the plane, so the plane comes from the record that chose it.
+		PlaneTransform = FTransform::Identity;
+		PlaneExtent = FVector::ZeroVector;
+		if (Start->PlaneOffset != INDEX_NONE)
+		{
+			ReadOffset = Start->PlaneOffset;
+			ReadRecord(Record, nullptr);
+			ApplyPlane(Record);
+		}
+
+		ReadOffset = Start->Offset;
+		ReadRecord(Record, &Arena);
+	}
+	else
+	{
+		Rewind();
+	}
+
+	// Turn 0 is everything before the first turn starts.
+	if (Turn == 0)
+	{
+		while (ReadOffset < Data.Num() && (EMatchJournalRecord)Data[ReadOffset] != EMatchJournalRecord::StartTurn)
+		{
+			Step(Record);
+		}
+		return true;
+	}
+
+	while (Arena.TurnCount < Turn)
+	{
+		if (!Step(Record))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+bool FMatchJournalReader::Step(FMatchJournalRecord& OutRecord)
+{
+	// Keyframes are read straight into the arena.
+	if (!ReadRecord(OutRecord, &Arena))
+	{
+		return false;
+	}
+
+	ApplyPlane(OutRecord);
+	ApplyRecord(Arena, OutRecord);
+	return true;
+}
+
+void FMatchJournalReader::ApplyPlane(const FMatchJournalRecord& Record)
+{
+	if (Record.Type == EMatchJournalRecord::SetUsedPlane)
+	{
+		PlaneTransform = FTransform(Record.Rotation, Record.Location);
+		PlaneExtent = Record.Vector;
+	}
+}
+
+void FMatchJournalReader::ApplyRecord(FArena& Arena, const FMatchJournalRecord& Record)
+{
+	int Fighter = FindFighter(Arena, Record.Team, Record.Slot);
+
+	switch (Record.Type)
+	{
+	case EMatchJournalRecord::SpawnFighter:
+		Arena.AddFighter(Record.Team, Record.Location, Record.Vector);
+		break;
+	case EMatchJournalRecord::SpawnObstacle:
+		Arena.AddObstacle(Record.Location, Record.Vector);
+		break;
+	case EMatchJournalRecord::Shoot:
+		if (Fighter != INDEX_NONE)
+		{
+			// A hit rolls for damage too.
+			Arena.Fighters[Fighter].bHasShot = true;
+			Arena.Fighters[Fighter].Rolls += Record.bHit ? 2 : 1;
+		}
+		break;
+	case EMatchJournalRecord::Damage:
+		if (Fighter != INDEX_NONE)
+		{
+			Arena.ApplyDamage(Fighter, Record.Value);
+		}
+		break;
+	case EMatchJournalRecord::ThrowGrenade:
+		if (Fighter != INDEX_NONE)
+		{
+			Arena.Fighters[Fighter].bHasGrenade = false;
+		}
+		break;
+	case EMatchJournalRecord::StartTurn:
+		if (Fighter != INDEX_NONE)
+		{
+			Arena.StartTurn(Fighter);
+		}
+		break;
+	case EMatchJournalRecord::EndTurn:
+		// Where the fighter actually stopped, which the move destination alone doesn't say.
+		if (Fighter != INDEX_NONE)
+		{
+			Arena.Fighters[Fighter].Location = Record.Location;
+			Arena.Fighters[Fighter].DistanceMoved = Record.Value;
+		}
+		break;
+	default:
+		// Targeting, move orders, explosions and the plane don't change the arena by themselves.
+		break;
+	}
+}
+
+int FMatchJournalReader::FindFighter(const FArena& Arena, int Team, int Slot)
+{
+	return Arena.Fighters.IndexOfByPredicate([Team, Slot](const FArenaFighter& Fighter) { return Fighter.Team == Team && Fighter.Slot == Slot; });
+}
+
+void FMatchJournalReader::Rewind()
+{
+	Arena = FArena();
+	Arena.Seed = Seed;
+	Arena.NumTeams = NumTeams;
+	Arena.LastFighters.Init(INDEX_NONE, NumTeams);
+	ReadOffset = FirstRecordOffset;
+	PlaneTransform = FTransform::Identity;
+	PlaneExtent = FVector::ZeroVector;
+}
+
+bool FMatchJournalReader::ReadRecord(FMatchJournalRecord& OutRecord, FArena* OutKeyframe)
+{
+	if (ReadOffset + RecordHeaderSize > Data.Num())
+	{
+		return false;
+	}
+
+	FMemoryReaderView Header(Data.Slice(ReadOffset + 1, RecordHeaderSize - 1));
+	uint16 Size = 0;
+	Header << Size;
+
+	OutRecord = FMatchJournalRecord();
+	OutRecord.Type = (EMatchJournalRecord)Data[ReadOffset];
+
+	FMemoryReaderView Reader(Data.Slice(ReadOffset + RecordHeaderSize, Size));
+	if (OutRecord.Type == EMatchJournalRecord::Keyframe)
+	{
+		int32 Turn = 0;
+		Reader << Turn;
+		if (OutKeyframe)
+		{
+			SerializeArena(Reader, *OutKeyframe);
+		}
+	}
+	else
+	{
+		SerializeRecord(Reader, OutRecord);
+	}
+
+	ReadOffset += RecordHeaderSize + Size;
+	return true;
+}
@@ -0,0 +1,73 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MatchJournalCommandlet.h"
+#include "MatchJournal.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogMatchJournalCommandlet, Log, All);
+
+// Names of the record types, in EMatchJournalRecord's order.
+static const TCHAR* RecordNames[] = { TEXT("Keyframe"), TEXT("SpawnFighter"), TEXT("SpawnObstacle"), TEXT("SetUsedPlane"), TEXT("SelectTarget"), TEXT("Shoot"),
+	TEXT("Damage"), TEXT("MoveTo"), TEXT("ThrowGrenade"), TEXT("Explode"), TEXT("StartTurn"), TEXT("EndTurn") };
+
+UMatchJournalCommandlet::UMatchJournalCommandlet()
+{
+	IsClient = false;
+	IsEditor = false;
+	IsServer = false;
+	LogToConsole = true;
+}
+
+int32 UMatchJournalCommandlet::Main(const FString& Params)
+{
+	FString Path;
+	int32 Turn = 0;
+	int32 NumRecords = 20;
+	FParse::Value(*Params, TEXT("Turn="), Turn);
+	FParse::Value(*Params, TEXT("Records="), NumRecords);
+	if (!FParse::Value(*Params, TEXT("Journal="), Path))
+	{
+		UE_LOG(LogMatchJournalCommandlet, Error, TEXT("Pass the journal to read with -Journal=<file>"));
+		return 1;
+	}
+
+	FMatchJournalReader Reader;
+	if (!Reader.Open(Path))
+	{
+		return 1;
+	}
+
+	UE_LOG(LogMatchJournalCommandlet, Display, TEXT("%s: seed %llu, %d records, %d turns, %d keyframes"), *Path, Reader.GetSeed(), Reader.GetNumRecords(), Reader.GetNumTurns(), Reader.GetNumKeyframes());
+
+	// Seek to every turn, which is what scrubbing through a match does.
+	double StartTime = FPlatformTime::Seconds();
+	for (int i = 0; i <= Reader.GetNumTurns(); i++)
+	{
+		Reader.SeekToTurn(i);
+	}
+	UE_LOG(LogMatchJournalCommandlet, Display, TEXT("Seeked to all %d turns in %.3fms"), Reader.GetNumTurns() + 1, (FPlatformTime::Seconds() - StartTime) * 1000.0);
+
+	if (!Reader.SeekToTurn(Turn))
+	{
+		UE_LOG(LogMatchJournalCommandlet, Error, TEXT("Turn %d isn't in the journal"), Turn);
+		return 1;
+	}
+
+	const FArena& Arena = Reader.GetArena();
+	UE_LOG(LogMatchJournalCommandlet, Display, TEXT("Turn %d, fighter %d of team %d to play%s"), Arena.TurnCount, Arena.CurrentFighter, Arena.CurrentTeam, Arena.bIsOver ? TEXT(", match over") : TEXT(""));
+	for (int i = 0; i < Arena.Fighters.Num(); i++)
+	{
+		const FArenaFighter& Fighter = Arena.Fighters[i];
+		UE_LOG(LogMatchJournalCommandlet, Display, TEXT("  Fighter %d (team %d slot %d): health %.0f at %s, moved %.1f%s%s%s"), i, Fighter.Team, Fighter.Slot, Fighter.Health, *Fighter.Location.ToCompactString(),
+			Fighter.DistanceMoved, Fighter.bHasShot ? TEXT(", has shot") : TEXT(""), Fighter.bHasGrenade ? TEXT(", has grenade") : TEXT(""), Fighter.bIsDead ? TEXT(", dead") : TEXT(""));
+	}
+
+	FMatchJournalRecord Record;
+	for (int i = 0; i < NumRecords && Reader.Step(Record); i++)
+	{
+		UE_LOG(LogMatchJournalCommandlet, Display, TEXT("  %s: team %d slot %d, target team %d slot %d, location %s, value %.1f%s"), RecordNames[(int)Record.Type], Record.Team, Record.Slot, Record.TargetTeam, Record.TargetSlot,
+			*Record.Location.ToCompactString(), Record.Value, Record.bHit ? TEXT(", hit") : TEXT(""));
+	}
+
+	return 0;
+}
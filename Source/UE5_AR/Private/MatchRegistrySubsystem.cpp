@@ -0,0 +1,46 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MatchRegistrySubsystem.h"
+#include "CustomGameMode.h"
+
+void UMatchRegistrySubsystem::RegisterGameMode(ACustomGameMode* InGameMode)
+{
+	GameMode = InGameMode;
+}
+
+void UMatchRegistrySubsystem::UnregisterGameMode(ACustomGameMode* InGameMode)
+{
+	if (GameMode == InGameMode)
+	{
+		GameMode = nullptr;
+	}
+}
+
+FArenaSpatialIndex* UMatchRegistrySubsystem::GetSpatialIndex() const
+{
+	return GameMode ? &GameMode->GetSpatialIndex() : nullptr;
+}
+
+FLineOfSightCache* UMatchRegistrySubsystem::GetLineOfSight() const
+{
+	return GameMode ? &GameMode->GetLineOfSight() : nullptr;
+}
+
+FMatchJournalWriter* UMatchRegistrySubsystem::GetJournal() const
+{
+	return GameMode && GameMode->GetJournal().IsOpen() ? &GameMode->GetJournal() : nullptr;
+}
+
+void UMatchRegistrySubsystem::RegisterARManager(AHelloARManager* InARManager)
+{
+	ARManager = InARManager;
+}
+
+void UMatchRegistrySubsystem::UnregisterARManager(AHelloARManager* InARManager)
+{
+	if (ARManager == InARManager)
+	{
+		ARManager = nullptr;
+	}
+}
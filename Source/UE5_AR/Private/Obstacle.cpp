@@ -2,13 +2,13 @@
 
 
 #include "Obstacle.h"
-#include "ARPin.h"
+#include "MatchRegistrySubsystem.h"
 
 // Sets default values
 AObstacle::AObstacle()
 {
- 	// Set this actor to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
-	PrimaryActorTick.bCanEverTick = true;
+ 	// Obstacles are kept at their pin by UARPinManager, so don't need to tick.
+	PrimaryActorTick.bCanEverTick = false;
 
 	// Default root component.
 	Root = CreateDefaultSubobject<USceneComponent>(TEXT("Root"));
@@ -37,36 +37,12 @@ void AObstacle::BeginPlay()
 {
 	Super::BeginPlay();
 
+	GetWorld()->GetSubsystem<UMatchRegistrySubsystem>()->RegisterObstacle(this);
 }
 
-// Called every frame
-void AObstacle::Tick(float DeltaTime)
+void AObstacle::EndPlay(const EEndPlayReason::Type EndPlayReason)
 {
-	Super::Tick(DeltaTime);
-
-	// Keep the crate locked to the pin when it is tracking.
-	if (PinComponent)
-	{
-		auto TrackingState = PinComponent->GetTrackingState();
-
-		switch (TrackingState)
-		{
-		case EARTrackingState::Tracking:
-			// Use the pin's transform.
-			SetActorTransform(PinComponent->GetLocalToWorldTransform());
-
-			// Set scale and rotation.
-			SetActorScale3D(FVector(Scale));
-			SetActorRotation(FRotator(0));
-			break;
-
-		case EARTrackingState::NotTracking:
-			// If not tracking, remove pin.
-			PinComponent = nullptr;
-			break;
-
-		}
-	}
+	GetWorld()->GetSubsystem<UMatchRegistrySubsystem>()->UnregisterObstacle(this);
 
+	Super::EndPlay(EndPlayReason);
 }
-
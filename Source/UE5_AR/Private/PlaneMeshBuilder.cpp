@@ -0,0 +1,165 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "PlaneMeshBuilder.h"
+
+// Twice the signed area of a triangle in the XY plane. Positive when A, B, C turn counter-clockwise.
+static float SignedArea2D(const FVector& A, const FVector& B, const FVector& C)
+{
+	return (B.X - A.X) * (C.Y - A.Y) - (B.Y - A.Y) * (C.X - A.X);
+}
+
+void FPlaneMeshBuilder::Build(const TArray<FVector>& BoundaryVertices, const FVector& PlaneNormal, float EdgeFeatheringDistance, FPlaneMeshData& OutMesh)
+{
+	int BoundaryVerticesNum = BoundaryVertices.Num();
+	int PolygonMeshVerticesNum = BoundaryVerticesNum * 2;
+	// Triangle number is interior (n-2) plus perimeter (EdgeNum * 2);
+	int TriangleNum = BoundaryVerticesNum - 2 + BoundaryVerticesNum * 2;
+
+	OutMesh.Vertices.Reset(PolygonMeshVerticesNum);
+	OutMesh.VertexColors.Reset(PolygonMeshVerticesNum);
+	OutMesh.Normals.Reset(PolygonMeshVerticesNum);
+	OutMesh.UVs.Reset(PolygonMeshVerticesNum);
+	OutMesh.Indices.Reset(TriangleNum * 3);
+
+	if (BoundaryVerticesNum < 3)
+	{
+		return;
+	}
+
+	// Boundary vertices are even, feathered interior vertices are odd.
+	TArray<FVector> InteriorPolygon;
+	InteriorPolygon.Reserve(BoundaryVerticesNum);
+
+	for (int i = 0; i < BoundaryVerticesNum; i++)
+	{
+		FVector BoundaryPoint = BoundaryVertices[i];
+		float BoundaryToCenterDist = BoundaryPoint.Size();
+		float FeatheringDist = FMath::Min(BoundaryToCenterDist, EdgeFeatheringDistance);
+		FVector InteriorPoint = BoundaryPoint - BoundaryPoint.GetUnsafeNormal() * FeatheringDist;
+
+		OutMesh.Vertices.Add(BoundaryPoint);
+		OutMesh.Vertices.Add(InteriorPoint);
+		InteriorPolygon.Add(InteriorPoint);
+
+		OutMesh.UVs.Add(FVector2D(BoundaryPoint.X, BoundaryPoint.Y));
+		OutMesh.UVs.Add(FVector2D(InteriorPoint.X, InteriorPoint.Y));
+
+		OutMesh.Normals.Add(PlaneNormal);
+		OutMesh.Normals.Add(PlaneNormal);
+
+		OutMesh.VertexColors.Add(FLinearColor(0.0f, 0.f, 0.f, 0.f));
+		OutMesh.VertexColors.Add(FLinearColor(0.0f, 0.f, 0.f, 1.f));
+	}
+
+	// Perimeter triangles
+	for (int i = 0; i < BoundaryVerticesNum - 1; i++)
+	{
+		OutMesh.Indices.Add(i * 2);
+		OutMesh.Indices.Add(i * 2 + 2);
+		OutMesh.Indices.Add(i * 2 + 1);
+
+		OutMesh.Indices.Add(i * 2 + 1);
+		OutMesh.Indices.Add(i * 2 + 2);
+		OutMesh.Indices.Add(i * 2 + 3);
+	}
+
+	// Adding the last triangles to close the plane mesh completely
+	OutMesh.Indices.Add((BoundaryVerticesNum - 1) * 2);
+	OutMesh.Indices.Add(0);
+	OutMesh.Indices.Add((BoundaryVerticesNum - 1) * 2 + 1);
+
+	OutMesh.Indices.Add((BoundaryVerticesNum - 1) * 2 + 1);
+	OutMesh.Indices.Add(0);
+	OutMesh.Indices.Add(1);
+
+	// Interior triangles, mapped from interior polygon indices to the odd mesh vertices.
+	TArray<int> InteriorIndices;
+	Triangulate(InteriorPolygon, InteriorIndices);
+	for (int Index : InteriorIndices)
+	{
+		OutMesh.Indices.Add(Index * 2 + 1);
+	}
+}
+
+void FPlaneMeshBuilder::Triangulate(const TArray<FVector>& Polygon, TArray<int>& OutIndices)
+{
+	int Num = Polygon.Num();
+	OutIndices.Reset((Num - 2) * 3);
+
+	if (Num < 3)
+	{
+		return;
+	}
+
+	// Work out the winding so convex corners can be recognised either way round.
+	float Area = 0.0f;
+	for (int i = 0, j = Num - 1; i < Num; j = i++)
+	{
+		Area += Polygon[j].X * Polygon[i].Y - Polygon[i].X * Polygon[j].Y;
+	}
+	float Winding = Area >= 0.0f ? 1.0f : -1.0f;
+
+	// Remaining polygon as a ring of indices.
+	TArray<int> Ring;
+	Ring.Reserve(Num);
+	for (int i = 0; i < Num; i++)
+	{
+		Ring.Add(i);
+	}
+
+	// Clip one ear per pass. If no ear is found the polygon is degenerate, so fall back to a fan for what's left.
+	int Current = 0;
+	int Attempts = 0;
+	while (Ring.Num() > 3 && Attempts < Ring.Num())
+	{
+		int PrevIndex = Ring[(Current + Ring.Num() - 1) % Ring.Num()];
+		int CurrIndex = Ring[Current];
+		int NextIndex = Ring[(Current + 1) % Ring.Num()];
+
+		const FVector& A = Polygon[PrevIndex];
+		const FVector& B = Polygon[CurrIndex];
+		const FVector& C = Polygon[NextIndex];
+
+		bool bIsEar = SignedArea2D(A, B, C) * Winding > 0.0f;
+
+		// An ear can't contain any other remaining vertex.
+		for (int k = 0; bIsEar && k < Ring.Num(); k++)
+		{
+			int Other = Ring[k];
+			if (Other == PrevIndex || Other == CurrIndex || Other == NextIndex)
+			{
+				continue;
+			}
+
+			const FVector& P = Polygon[Other];
+			if (SignedArea2D(A, B, P) * Winding >= 0.0f && SignedArea2D(B, C, P) * Winding >= 0.0f && SignedArea2D(C, A, P) * Winding >= 0.0f)
+			{
+				bIsEar = false;
+			}
+		}
+
+		if (bIsEar)
+		{
+			OutIndices.Add(PrevIndex);
+			OutIndices.Add(CurrIndex);
+			OutIndices.Add(NextIndex);
+
+			Ring.RemoveAt(Current);
+			Current = Current % Ring.Num();
+			Attempts = 0;
+		}
+		else
+		{
+			Current = (Current + 1) % Ring.Num();
+			Attempts++;
+		}
+	}
+
+	for (int i = 1; i < Ring.Num() - 1; i++)
+	{
+		OutIndices.Add(Ring[0]);
+		OutIndices.Add(Ring[i]);
+		OutIndices.Add(Ring[i + 1]);
+	}
+}
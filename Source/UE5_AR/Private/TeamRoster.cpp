@@ -0,0 +1,93 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TeamRoster.h"
+
+int FTeamRoster::Add(AFighterPawn* Fighter)
+{
+	// Insert at the end of the ring, after the last living fighter.
+	int First = GetAliveFrom(0);
+
+	int Slot = Fighters.Add(Fighter);
+	FRosterSlot& NewSlot = Slots.AddDefaulted_GetRef();
+
+	if (First == INDEX_NONE)
+	{
+		NewSlot.Next = Slot;
+		NewSlot.Prev = Slot;
+	}
+	else
+	{
+		int Last = Slots[First].Prev;
+		NewSlot.Next = First;
+		NewSlot.Prev = Last;
+		Slots[Last].Next = Slot;
+		Slots[First].Prev = Slot;
+	}
+
+	AliveCount++;
+	return Slot;
+}
+
+bool FTeamRoster::MarkDead(int Slot)
+{
+	if (!IsAlive(Slot))
+	{
+		return false;
+	}
+
+	// Unlink from the ring. The dead slot keeps pointing at its old neighbours so turn order can continue from it.
+	FRosterSlot& DeadSlot = Slots[Slot];
+	DeadSlot.bAlive = false;
+	Slots[DeadSlot.Prev].Next = DeadSlot.Next;
+	Slots[DeadSlot.Next].Prev = DeadSlot.Prev;
+
+	AliveCount--;
+	return AliveCount == 0;
+}
+
+void FTeamRoster::Reset()
+{
+	Fighters.Reset();
+	Slots.Reset();
+	AliveCount = 0;
+}
+
+int FTeamRoster::GetNextAlive(int Slot) const
+{
+	if (AliveCount == 0 || !Slots.IsValidIndex(Slot))
+	{
+		return INDEX_NONE;
+	}
+
+	// A dead slot's link may lead to fighters that have died since, so follow it until a living one is found.
+	int Next = Slots[Slot].Next;
+	for (int Steps = 0; Steps < Slots.Num(); Steps++)
+	{
+		if (Slots[Next].bAlive)
+		{
+			return Next;
+		}
+		Next = Slots[Next].Next;
+	}
+
+	// Only reachable if fighters were added after the whole team died. Fall back to a scan.
+	for (int i = 1; i <= Slots.Num(); i++)
+	{
+		int Candidate = (Slot + i) % Slots.Num();
+		if (Slots[Candidate].bAlive)
+		{
+			return Candidate;
+		}
+	}
+	return INDEX_NONE;
+}
+
+int FTeamRoster::GetAliveFrom(int Slot) const
+{
+	if (IsAlive(Slot))
+	{
+		return Slot;
+	}
+	return GetNextAlive(Slot);
+}
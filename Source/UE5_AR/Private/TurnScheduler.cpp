@@ -0,0 +1,115 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TurnScheduler.h"
+#include "FighterPawn.h"
+
+TUniquePtr<FTurnScheduler> FTurnScheduler::Create(ETurnOrder Order)
+{
+	switch (Order)
+	{
+	case ETurnOrder::INITIATIVE:
+		return MakeUnique<FInitiativeScheduler>();
+	default:
+		return MakeUnique<FRoundRobinScheduler>();
+	}
+}
+
+void FRoundRobinScheduler::Start(const TArray<FTeamRoster>& Teams)
+{
+	// The first team goes first, starting with its first fighter.
+	CurrentTeam = Teams.Num() - 1;
+	LastSlots.Init(INDEX_NONE, Teams.Num());
+}
+
+FTurnSlot FRoundRobinScheduler::Next(const TArray<FTeamRoster>& Teams)
+{
+	FTurnSlot Turn;
+
+	for (int i = 1; i <= Teams.Num(); i++)
+	{
+		int Team = (CurrentTeam + i) % Teams.Num();
+		const FTeamRoster& Roster = Teams[Team];
+		if (Roster.GetAliveCount() == 0)
+		{
+			continue;
+		}
+
+		// Carry on from the team's last fighter, or start from the top.
+		int Slot = LastSlots[Team] == INDEX_NONE ? Roster.GetAliveFrom(0) : Roster.GetNextAlive(LastSlots[Team]);
+
+		CurrentTeam = Team;
+		LastSlots[Team] = Slot;
+		Turn.Team = Team;
+		Turn.Slot = Slot;
+		break;
+	}
+
+	return Turn;
+}
+
+int FRoundRobinScheduler::GetLastSlot(int Team) const
+{
+	return LastSlots.IsValidIndex(Team) ? LastSlots[Team] : INDEX_NONE;
+}
+
+void FInitiativeScheduler::Start(const TArray<FTeamRoster>& Teams)
+{
+	Heap.Reset();
+
+	for (int Team = 0; Team < Teams.Num(); Team++)
+	{
+		const FTeamRoster& Roster = Teams[Team];
+		for (int Slot = 0; Slot < Roster.Num(); Slot++)
+		{
+			if (!Roster.IsAlive(Slot))
+			{
+				continue;
+			}
+
+			FInitiativeEntry Entry;
+			Entry.NextTime = GetTurnInterval(Roster.GetFighter(Slot));
+			Entry.Order = Slot * Teams.Num() + Team;
+			Entry.Turn.Team = Team;
+			Entry.Turn.Slot = Slot;
+			Heap.Add(Entry);
+		}
+	}
+
+	Heap.Heapify();
+}
+
+FTurnSlot FInitiativeScheduler::Next(const TArray<FTeamRoster>& Teams)
+{
+	while (Heap.Num() > 0)
+	{
+		FInitiativeEntry Entry;
+		Heap.HeapPop(Entry, false);
+
+		// Dead fighters leave the queue.
+		if (!Teams.IsValidIndex(Entry.Turn.Team) || !Teams[Entry.Turn.Team].IsAlive(Entry.Turn.Slot))
+		{
+			continue;
+		}
+
+		// Queue the fighter's next turn.
+		FTurnSlot Turn = Entry.Turn;
+		Entry.NextTime += GetTurnInterval(Teams[Turn.Team].GetFighter(Turn.Slot));
+		Heap.HeapPush(Entry);
+
+		return Turn;
+	}
+
+	return FTurnSlot();
+}
+
+float FInitiativeScheduler::GetNextTurnTime(const FTurnSlot& Turn) const
+{
+	const FInitiativeEntry* Entry = Heap.FindByPredicate([&Turn](const FInitiativeEntry& Other) { return Other.Turn.Team == Turn.Team && Other.Turn.Slot == Turn.Slot; });
+	return Entry ? Entry->NextTime : 0.0f;
+}
+
+float FInitiativeScheduler::GetTurnInterval(AFighterPawn* Fighter)
+{
+	return 1.0f / FMath::Max(Fighter->GetInitiative(), KINDA_SMALL_NUMBER);
+}
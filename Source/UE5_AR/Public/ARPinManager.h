@@ -0,0 +1,108 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ARPinManager.generated.h"
+
+class UARPin;
+
+// An actor kept in the same real world position, either by its own AR pin or by the arena anchor.
+USTRUCT()
+struct FPinnedActor
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	AActor* Actor = nullptr;
+
+	// The actor's own pin. Null when the actor lives in the arena frame.
+	UPROPERTY()
+	UARPin* Pin = nullptr;
+
+	// Location in the actor's frame. For actors with their own pin, this is the offset from the pin's location.
+	FVector Offset = FVector::ZeroVector;
+
+	// Scale applied to the actor.
+	FVector Scale = FVector::OneVector;
+
+	// Whether the actor keeps its own rotation, or is locked to Rotation in its frame.
+	bool bKeepRotation = true;
+	FRotator Rotation = FRotator::ZeroRotator;
+
+	// Physics actors move themselves, so they're only carried along when the arena anchor moves.
+	bool bSimulatesPhysics = false;
+
+	// Transform worked out this frame, and whether it needs to be applied.
+	FTransform TargetTransform;
+	bool bNeedsCommit = false;
+};
+
+/**
+ * Keeps pinned actors locked to their AR pins. Ticks once per frame after the actors, by which point the AR frame for this
+ * game frame has been applied. All pinned actors are kept in one flat array. Their transforms are worked out in one pass,
+ * then each actor that actually moved gets a single SetActorTransform, so pinned actors don't need to tick themselves.
+ *
+ * With an arena anchor set, match actors can be added in arena space instead of getting a pin each. Only the anchor is
+ * queried from the AR system, and every arena actor moves with it, so they can't drift relative to each other.
+ */
+UCLASS()
+class UE5_AR_API UARPinManager : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Deinitialize() override;
+
+	// Called every frame
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	// Start keeping an actor at a pin. Rotation is only applied if bKeepRotation is false.
+	void AddPinnedActor(AActor* Actor, UARPin* Pin, const FVector& Scale, bool bKeepRotation = true, const FRotator& Rotation = FRotator::ZeroRotator);
+
+	// Start keeping an actor at its current position in the arena. Needs an arena anchor.
+	void AddArenaActor(AActor* Actor, const FVector& Scale, bool bKeepRotation = true, const FRotator& Rotation = FRotator::ZeroRotator);
+
+	// Carry a physics actor along with the arena anchor, without otherwise touching its transform.
+	void AddArenaPhysicsActor(AActor* Actor);
+
+	// Stop updating an actor from its pin.
+	void RemovePinnedActor(AActor* Actor);
+
+	// Move the actor within its frame by a world space amount.
+	void AddPinOffset(AActor* Actor, const FVector& WorldDelta);
+
+	// Whether the actor is currently following a pin.
+	bool IsPinned(const AActor* Actor) const;
+
+	// Arena anchor.
+	// *** //
+	void SetArenaAnchor(UARPin* Pin);
+	void ClearArenaAnchor();
+	bool HasArenaAnchor() const { return ArenaAnchor != nullptr; }
+	const FTransform& GetArenaTransform() const { return ArenaTransform; }
+	// *** //
+
+	// Number of transform commits made in the last tick.
+	int GetLastCommitCount() const { return LastCommitCount; }
+
+protected:
+	FPinnedActor* FindEntry(const AActor* Actor);
+	const FPinnedActor* FindEntry(const AActor* Actor) const;
+
+	// All pinned actors.
+	UPROPERTY()
+	TArray<FPinnedActor> PinnedActors;
+
+	// The single pin shared by arena actors, and its pose when last updated.
+	UPROPERTY()
+	UARPin* ArenaAnchor = nullptr;
+	FTransform ArenaTransform;
+
+	// Distance and angle below which a pose counts as unchanged.
+	float PoseTolerance = 0.01f;
+
+	int LastCommitCount = 0;
+};
@@ -19,6 +19,8 @@
 #include "CoreMinimal.h"
 #include "GameFramework/Actor.h"
 #include "ARTrackable.h"
+#include "Tasks/Task.h"
+#include "PlaneMeshBuilder.h"
 
 #include "ARPlaneActor.generated.h"
 
@@ -35,6 +37,11 @@ public:
 	UPROPERTY(Category = GoogleARCorePlaneActor, EditAnywhere, BlueprintReadWrite)
 		class UProceduralMeshComponent* PlanePolygonMeshComponent;
 
+	// Holds the arena plane's collision. Kept apart from the drawn mesh, as every section change on a procedural mesh
+	// re-cooks all of its collision.
+	UPROPERTY(Category = GoogleARCorePlaneActor, VisibleAnywhere, BlueprintReadOnly)
+		class UProceduralMeshComponent* CollisionMeshComponent;
+
 	/** When set to true, the actor will remove the ARAnchor object from the current tracking session when the Actor gets destroyed.*/
 	UPROPERTY(Category = GoogleARCorePlaneActor, BlueprintReadWrite)
 		class UARPlaneGeometry* ARCorePlaneObject = nullptr;
@@ -56,20 +63,89 @@ public:
 protected:
 	// Called at the time of spawning
 	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 
 public:
 
 	// Called every frame
 	virtual void Tick(float DeltaTime) override;
 
-	// Update plane's procedural mesh
+	// Start rebuilding the plane's procedural mesh on a worker thread. Does nothing if the boundary hasn't changed since the last update.
 	UFUNCTION(BlueprintCallable, Category = "GoogleARCorePlaneActor", meta = (Keywords = "googlear arcore plane"))
 		void UpdatePlanePolygonMesh();
 
+	// How far a boundary vertex has to move before the mesh is updated.
+	UPROPERTY(Category = GoogleARCorePlaneActor, EditAnywhere, BlueprintReadWrite)
+		float BoundaryChangeTolerance = 0.1f;
+
+	// How long the boundary has to stay unchanged before collision is cooked for it, in seconds.
+	UPROPERTY(Category = GoogleARCorePlaneActor, EditAnywhere, BlueprintReadWrite)
+		float CollisionStableTime = 1.0f;
+
+	// Start generating collision for this plane. Only the arena plane needs it, so this is off by default.
+	void EnableArenaCollision();
+
+	// The boundary the plane's collision was cooked from, in arena space and dropped onto the arena's XY plane. Empty until
+	// collision has been cooked.
+	void GetArenaFloor(const FTransform& ArenaTransform, TArray<FVector2D>& OutFloor) const;
+
+	// Return the actor to its spawned state so it can be reused for another plane. Hides it and stops it ticking.
+	void ResetForPool();
+
 	// Set plane's colour
 	UFUNCTION(BlueprintCallable, Category = "GoogleARCorePlaneActor")
 		void SetColor(FColor InColor);
 
 	// Boolean for manually setting visibility
 	bool bIsVisibleOverride = false;
-};
+
+	// Whether the plane should be drawn, based on tracking state and the visibility override.
+	bool ShouldBeVisible() const;
+
+	// Let a UARPlaneBatchComponent draw this plane. The actor then keeps its mesh data but doesn't draw or tick,
+	// unless it's the arena plane and needs its collision kept in place.
+	void SetBatched(bool bInBatched);
+
+	// Getters for the current mesh and how many times it has changed.
+	const FPlaneMeshData& GetMeshData() const { return MeshData; }
+	int32 GetMeshVersion() const { return MeshVersion; }
+
+	// Whether a mesh build is running or waiting to be committed.
+	bool IsMeshUpdatePending() const { return MeshTask.IsValid(); }
+
+	// Commit a finished mesh build to the procedural mesh. Returns false while the build is still running, and true once
+	// there's nothing left to wait for, including when the build was dropped.
+	bool CommitPendingMesh();
+
+protected:
+	// Whether the boundary or normal differ from what the last mesh build was started with.
+	bool HasBoundaryChanged(const TArray<FVector>& BoundaryVertices, const FVector& PlaneNormal) const;
+
+	// The geometry update, boundary and normal the last mesh build was started with.
+	uint32 MeshFrameNumber = 0;
+	TArray<FVector> MeshBoundary;
+	FVector MeshNormal = FVector::ZeroVector;
+
+	// Mesh build running on a worker thread, and whether the boundary changed again while it was running.
+	UE::Tasks::TTask<FPlaneMeshData> MeshTask;
+	bool bRebuildQueued = false;
+
+	// Cook collision from the current mesh, once it has been stable for long enough.
+	void UpdateCollision();
+
+	// The mesh currently in the procedural mesh section, and the boundary it was built from.
+	FPlaneMeshData MeshData;
+	TArray<FVector> MeshDataBoundary;
+
+	// The boundary the collision was last cooked from.
+	TArray<FVector> CollisionBoundary;
+
+	// Collision state. The collision section is rebuilt when its version falls behind the visual mesh.
+	// *** //
+	bool bArenaCollision = false;
+	bool bBatched = false;
+	int32 MeshVersion = 0;
+	int32 CollisionVersion = 0;
+	float LastMeshChangeTime = 0.0f;
+	// *** //
+};
\ No newline at end of file
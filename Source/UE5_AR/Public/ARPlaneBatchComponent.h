@@ -0,0 +1,60 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ProceduralMeshComponent.h"
+#include "ARPlaneBatchComponent.generated.h"
+
+class AARPlaneActor;
+
+/**
+ * Draws every detected AR plane from a single mesh section, so draw calls and component updates stay flat as the plane count grows.
+ * Each plane is a sub-range of the section. Plane-local vertices are moved into world space in one pass, and the plane's tint is
+ * written to the vertex colour, so the material used here has to multiply by vertex colour instead of reading a PlaneTint parameter.
+ */
+UCLASS()
+class UE5_AR_API UARPlaneBatchComponent : public UProceduralMeshComponent
+{
+	GENERATED_BODY()
+
+public:
+	UARPlaneBatchComponent(const FObjectInitializer& ObjectInitializer);
+
+	// Add and remove planes from the batch.
+	// *** //
+	void AddPlane(AARPlaneActor* Plane);
+	void RemovePlane(AARPlaneActor* Plane);
+	// *** //
+
+	// Rebuild the batched section if any plane's mesh, transform or visibility changed.
+	void UpdateBatch();
+
+	// Material for the batch. Must use vertex colour for the tint.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	UMaterialInterface* BatchMaterial;
+
+protected:
+	// What a plane looked like the last time the batch was built.
+	struct FBatchedPlane
+	{
+		AARPlaneActor* Plane = nullptr;
+		FTransform Transform;
+		int32 MeshVersion = -1;
+		bool bVisible = false;
+	};
+
+	TArray<FBatchedPlane> Planes;
+
+	// Set when planes are added or removed.
+	bool bDirty = false;
+
+	// Batched buffers, kept between rebuilds.
+	// *** //
+	TArray<FVector> Vertices;
+	TArray<FLinearColor> VertexColors;
+	TArray<int> Indices;
+	TArray<FVector> Normals;
+	TArray<FVector2D> UVs;
+	// *** //
+};
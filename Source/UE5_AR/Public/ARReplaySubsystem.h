@@ -0,0 +1,62 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Dom/JsonObject.h"
+#include "ARReplaySubsystem.generated.h"
+
+class FARReplaySystem;
+class UARTrackedGeometry;
+
+/**
+ * Drives AR session playback and recording.
+ * -ARReplay=<file> swaps the device AR backend for FARReplaySystem and plays the file back.
+ * -ARReplayRate=<n> sets the playback speed, 1 being real time. 0 applies one recorded frame per game frame (uncapped).
+ * -ARRecord=<file> records the live session so it can be replayed later.
+ */
+UCLASS()
+class UE5_AR_API UARReplaySubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	// Called every frame
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	// Whether the game is running against a recorded session.
+	bool IsReplaying() const { return ReplaySystem.IsValid(); }
+
+	// Whether the whole recording has been played back.
+	bool IsReplayFinished() const;
+
+protected:
+	// Write the changes in the live session since the last frame to the recording.
+	void RecordFrame(float DeltaTime);
+
+	// Write a transform to a json object.
+	static TSharedRef<FJsonObject> MakeTransformObject(const FTransform& Transform);
+
+	// Playback.
+	// *** //
+	TSharedPtr<FARReplaySystem, ESPMode::ThreadSafe> ReplaySystem;
+	float PlaybackRate;
+	double PlaybackTime;
+	// *** //
+
+	// Recording.
+	// *** //
+	FString RecordPath;
+	double RecordTime;
+	TArray<TSharedPtr<FJsonValue>> RecordedFrames;
+	TMap<UARTrackedGeometry*, uint32> LastRecordedFrameNumbers;
+	TMap<UARTrackedGeometry*, FString> RecordedIds;
+	TArray<uint8> LastPinStates;
+	// *** //
+};
@@ -0,0 +1,186 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "XRTrackingSystemBase.h"
+#include "ARSystemSupport.h"
+#include "ARTypes.h"
+#include "UObject/GCObject.h"
+
+class UARPlaneGeometry;
+class UARTrackedImage;
+class UARTrackedGeometry;
+class UARCandidateImage;
+class UARPin;
+
+// A single plane as it appears in one frame of a recorded session.
+struct FARReplayPlane
+{
+	FString Id;
+	EARTrackingState TrackingState = EARTrackingState::Tracking;
+	FTransform LocalToTracking;
+	FVector Center = FVector::ZeroVector;
+	FVector Extent = FVector::ZeroVector;
+	TArray<FVector> Boundary;
+	FString SubsumedBy;
+};
+
+// A single tracked image as it appears in one frame of a recorded session.
+struct FARReplayImage
+{
+	FString Id;
+	FString FriendlyName;
+	EARTrackingState TrackingState = EARTrackingState::Tracking;
+	FTransform LocalToTracking;
+	FVector2D EstimatedSize = FVector2D::ZeroVector;
+};
+
+// A tracking state change for a pin. Pins are identified by the order the game created them in.
+struct FARReplayPinEvent
+{
+	int32 PinIndex = 0;
+	EARTrackingState TrackingState = EARTrackingState::Tracking;
+	bool bHasTransform = false;
+	FTransform LocalToTracking;
+};
+
+// One recorded frame. Only geometries that changed since the previous frame are stored.
+struct FARReplayFrame
+{
+	double Time = 0.0;
+	EARSessionStatus Status = EARSessionStatus::Running;
+	bool bHasCameraPose = false;
+	FTransform CameraPose;
+	TArray<FARReplayPlane> Planes;
+	TArray<FARReplayImage> Images;
+	TArray<FARReplayPinEvent> Pins;
+};
+
+/**
+ * A local AR backend that plays back a recorded session file instead of talking to ARCore/ARKit.
+ * It is registered as the AR system so everything still goes through UARBlueprintLibrary, which lets
+ * the game run headless (-nullrhi) on desktop against identical input.
+ */
+class UE5_AR_API FARReplaySystem : public FXRTrackingSystemBase, public IARSystemSupport, public FGCObject
+{
+public:
+	FARReplaySystem();
+	virtual ~FARReplaySystem() = default;
+
+	// Load a session file. Returns false if the file could not be read or parsed.
+	bool LoadSession(const FString& Path);
+
+	// Register this system with UARBlueprintLibrary, and hand back to the AR system it replaced. UARBlueprintLibrary only
+	// keeps the system it's given, so the replay has to be unregistered before it's destroyed.
+	// *** //
+	void Register();
+	void Unregister();
+	// *** //
+
+	// Set the world used for screen space line traces.
+	void SetWorld(UWorld* InWorld) { World = InWorld; }
+
+	// Advance playback to the given session time, applying every recorded frame up to it.
+	void AdvanceTo(double Time);
+
+	// Apply exactly one recorded frame, regardless of its timestamp. Used for uncapped playback.
+	void AdvanceFrame();
+
+	// Whether every recorded frame has been applied.
+	bool IsFinished() const { return NextFrame >= Frames.Num(); }
+
+	// The latest recorded camera pose.
+	const FTransform& GetCameraPose() const { return CameraPose; }
+
+	// Total length of the recording in seconds.
+	double GetDuration() const { return Frames.Num() > 0 ? Frames.Last().Time : 0.0; }
+
+	// IXRTrackingSystem
+	// *** //
+	virtual FName GetSystemName() const override;
+	virtual int32 GetXRSystemFlags() const override;
+	virtual bool EnumerateTrackedDevices(TArray<int32>& OutDevices, EXRTrackedDeviceType Type = EXRTrackedDeviceType::Any) override;
+	virtual bool GetCurrentPose(int32 DeviceId, FQuat& OutOrientation, FVector& OutPosition) override;
+	virtual float GetWorldToMetersScale() const override { return 100.0f; }
+	// *** //
+
+	// IARSystemSupport
+	// *** //
+	virtual EARTrackingQuality OnGetTrackingQuality() const override { return EARTrackingQuality::Normal; }
+	virtual EARTrackingQualityReason OnGetTrackingQualityReason() const override { return EARTrackingQualityReason::None; }
+	virtual void OnStartARSession(UARSessionConfig* SessionConfig) override;
+	virtual void OnPauseARSession() override;
+	virtual void OnStopARSession() override;
+	virtual FARSessionStatus OnGetARSessionStatus() const override { return FARSessionStatus(SessionStatus); }
+	virtual void OnSetAlignmentTransform(const FTransform& InAlignmentTransform) override;
+	virtual TArray<FARTraceResult> OnLineTraceTrackedObjects(const FVector2D ScreenCoord, EARLineTraceChannels TraceChannels) override;
+	virtual TArray<FARTraceResult> OnLineTraceTrackedObjects(const FVector Start, const FVector End, EARLineTraceChannels TraceChannels) override;
+	virtual TArray<UARTrackedGeometry*> OnGetAllTrackedGeometries() const override;
+	virtual TArray<UARPin*> OnGetAllPins() const override { return Pins; }
+	virtual bool OnIsTrackingTypeSupported(EARSessionType SessionType) const override { return SessionType == EARSessionType::World; }
+	virtual UARLightEstimate* OnGetCurrentLightEstimate() const override { return nullptr; }
+	virtual UARPin* OnPinComponent(USceneComponent* ComponentToPin, const FTransform& PinToWorldTransform, UARTrackedGeometry* TrackedGeometry = nullptr, const FName DebugName = NAME_None) override;
+	virtual void OnRemovePin(UARPin* PinToRemove) override;
+	virtual UARTexture* OnGetARTexture(EARTextureType TextureType) const override { return nullptr; }
+	virtual bool OnAddManualEnvironmentCaptureProbe(FVector Location, FVector Extent) override { return false; }
+	virtual TSharedPtr<FARGetCandidateObjectAsyncTask, ESPMode::ThreadSafe> OnGetCandidateObject(FVector Location, FVector Extent) const override { return nullptr; }
+	virtual TSharedPtr<FARSaveWorldAsyncTask, ESPMode::ThreadSafe> OnSaveWorld() const override { return nullptr; }
+	virtual EARWorldMappingState OnGetWorldMappingStatus() const override { return EARWorldMappingState::Mapped; }
+	virtual TArray<FARVideoFormat> OnGetSupportedVideoFormats(EARSessionType SessionType) const override { return TArray<FARVideoFormat>(); }
+	virtual TArray<FVector> OnGetPointCloud() const override { return TArray<FVector>(); }
+	virtual bool OnAddRuntimeCandidateImage(UARSessionConfig* SessionConfig, UTexture2D* CandidateTexture, FString FriendlyName, float PhysicalWidth) override { return false; }
+	virtual void* GetARSessionRawPointer() override { return nullptr; }
+	virtual void* GetGameThreadARFrameRawPointer() override { return nullptr; }
+	// *** //
+
+	// FGCObject
+	// *** //
+	virtual void AddReferencedObjects(FReferenceCollector& Collector) override;
+	virtual FString GetReferencerName() const override { return TEXT("FARReplaySystem"); }
+	// *** //
+
+protected:
+	// Apply a recorded frame to the tracked geometries and pins.
+	void ApplyFrame(const FARReplayFrame& Frame);
+
+	// Apply a recorded plane. Its geometry has already been created, and bIsNew says whether that was this frame.
+	void ApplyPlane(const FARReplayPlane& Plane, bool bIsNew);
+
+	// Apply a recorded tracked image, spawning the geometry the first time it is seen.
+	void ApplyImage(const FARReplayImage& Image);
+
+	// Change a geometry's tracking state, notifying listeners when it is removed.
+	void SetGeometryTrackingState(UARTrackedGeometry* Geometry, EARTrackingState NewState);
+
+	// Get or create the candidate image with the given name.
+	UARCandidateImage* FindOrAddCandidateImage(const FString& FriendlyName, const FVector2D& Size);
+
+	// The recorded frames and playback position.
+	TArray<FARReplayFrame> Frames;
+	int32 NextFrame;
+	uint32 FrameNumber;
+	double CurrentTime;
+	double PausedTime;
+
+	// Session state. A paused session reports NotStarted but keeps its playback position.
+	EARSessionStatus SessionStatus;
+	bool bIsPaused;
+	FTransform CameraPose;
+
+	// Geometries, keyed by their recorded id.
+	TMap<FString, UARPlaneGeometry*> PlaneGeometries;
+	TMap<FString, UARTrackedImage*> ImageGeometries;
+	TMap<FString, UARCandidateImage*> CandidateImages;
+
+	// Pins created by the game, in creation order.
+	TArray<UARPin*> Pins;
+	TArray<UARPin*> AllPinsEverCreated;
+
+	// World used for deprojecting screen coordinates.
+	TWeakObjectPtr<UWorld> World;
+
+	// The device's AR system, registered again when the replay is unregistered.
+	TSharedPtr<FARSupportInterface, ESPMode::ThreadSafe> PreviousARSystem;
+	bool bIsRegistered = false;
+};
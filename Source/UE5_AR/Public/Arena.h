@@ -0,0 +1,181 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MatchRandom.h"
+
+struct FArenaObstacle;
+
+/**
+ * The match rules, shared by the actors and the arena simulation so both play the same game.
+ * Defaults match the fighter and grenade actors. Distances are in arena space.
+ */
+struct UE5_AR_API FArenaRules
+{
+	float MaxHealth = 100.0f;
+
+	// Gun range for hit chance, and damage per hit.
+	float MinRange = 30.0f;
+	float MaxRange = 300.0f;
+	float MinDamage = 25.0f;
+	float MaxDamage = 35.0f;
+
+	// Taken off hit chance and the damage multiplier when an obstacle is in the way.
+	float ObstructedHitPenalty = 0.5f;
+	float ObstructedDamagePenalty = 0.5f;
+
+	// Movement allowed per turn, and how far ahead a moving fighter looks for things in the way.
+	float MovableDistance = 100.0f;
+	float MoveLookahead = 5.0f;
+
+	// Grenade damage and blast radius. Matches AGrenade's radius at the fighter's grenade scale.
+	float GrenadeDamage = 75.0f;
+	float GrenadeRadius = 15.0f;
+
+	// Share of grenade damage lost by the edge of the blast. Damage falls off linearly from the centre.
+	float GrenadeFalloff = 0.5f;
+
+	// Hit chance falls off linearly between the min and max range, less the obstruction penalty.
+	float GetHitChance(float Distance, bool bObstructed) const;
+	float GetDamageMultiplier(bool bObstructed) const;
+
+	// Grenade damage to every fighter box near a blast, worked out in one pass. Fighters outside the radius take nothing,
+	// and fighters with an obstacle between them and the blast take the obstructed damage multiplier.
+	void GetBlastDamage(const FVector& Blast, TArrayView<const FVector> Centers, TArrayView<const FVector> Extents, TArrayView<const FArenaObstacle> Obstacles, TArrayView<float> OutDamage) const;
+
+	// Rolls take a uniform random number in [0, 1), so the caller decides where randomness comes from.
+	bool RollHit(float HitChance, float Roll) const { return Roll < HitChance; }
+	float RollDamage(float DamageMultiplier, float Roll) const { return FMath::Lerp(MinDamage, MaxDamage, Roll) * DamageMultiplier; }
+};
+
+// A fighter in the arena simulation. Location is the fighter's centre, which line of sight is measured between.
+struct FArenaFighter
+{
+	int Team = INDEX_NONE;
+	FVector Location = FVector::ZeroVector;
+	FVector Extent = FVector::ZeroVector;
+	float Health = 100.0f;
+	float Initiative = 1.0f;
+
+	// When the fighter next acts, for initiative turn order.
+	float NextTurnTime = 0.0f;
+	float DistanceMoved = 0.0f;
+	bool bHasShot = false;
+	bool bHasGrenade = true;
+	bool bIsDead = false;
+
+	// Place in the team, which picks the fighter's random stream, and rolls taken from it so far.
+	int Slot = 0;
+	uint32 Rolls = 0;
+};
+
+// An obstacle in the arena simulation, as a box.
+struct FArenaObstacle
+{
+	FVector Center = FVector::ZeroVector;
+	FVector Extent = FVector::ZeroVector;
+};
+
+// Something the current fighter can do on their turn.
+enum class EArenaActionType : uint8
+{
+	Shoot,
+	Move,
+	Grenade,
+	EndTurn
+};
+
+struct FArenaAction
+{
+	EArenaActionType Type = EArenaActionType::EndTurn;
+
+	// Fighter to shoot.
+	int Target = INDEX_NONE;
+
+	// Where to move to, or where the grenade lands.
+	FVector Location = FVector::ZeroVector;
+};
+
+/**
+ * The whole match as plain data, with step functions implementing the same rules as the actors. Copying an FArena clones
+ * the match, and nothing allocates while fighters and obstacles fit the inline capacity, so AI and balancing can play out
+ * huge numbers of turns without spawning anything.
+ * Turns go round robin between teams, each team cycling through its living fighters, like FRoundRobinScheduler, or by
+ * initiative like FInitiativeScheduler.
+ */
+struct UE5_AR_API FArena
+{
+	static constexpr int MaxFighters = 16;
+	static constexpr int MaxObstacles = 8;
+	static constexpr int MaxTeams = 4;
+
+	FArenaRules Rules;
+	TArray<FArenaFighter, TInlineAllocator<MaxFighters>> Fighters;
+	TArray<FArenaObstacle, TInlineAllocator<MaxObstacles>> Obstacles;
+
+	int NumTeams = 2;
+
+	// Whether turns go by initiative instead of round robin.
+	bool bInitiativeOrder = false;
+
+	// Seed for every roll in the match. Rolls come from each fighter's own FMatchRandom stream, so a match with the same
+	// seed and actions always plays out the same way.
+	uint64 Seed = 0;
+
+	// Whose turn it is, and the last fighter each team played.
+	int CurrentTeam = INDEX_NONE;
+	int CurrentFighter = INDEX_NONE;
+	TArray<int, TInlineAllocator<MaxTeams>> LastFighters;
+
+	// Turns started so far, and the winner once the match is over. The winner is INDEX_NONE for a draw.
+	int TurnCount = 0;
+	bool bIsOver = false;
+	int WinningTeam = INDEX_NONE;
+
+	// Add a fighter or obstacle while setting up. Returns the fighter's index.
+	int AddFighter(int Team, const FVector& Location, const FVector& Extent);
+	void AddObstacle(const FVector& Center, const FVector& Extent);
+
+	// Start the match with the first team's first fighter.
+	void StartMatch();
+
+	// Actions for the current fighter. Each returns false if the action isn't allowed.
+	// *** //
+	bool Shoot(int Target);
+	bool Move(const FVector& Destination);
+	bool ThrowGrenade(const FVector& Landing);
+	void EndTurn();
+	bool Apply(const FArenaAction& Action);
+	// *** //
+
+	// Queries.
+	// *** //
+	bool IsObstructed(int From, int To) const;
+	float GetHitChance(int From, int To) const;
+	int GetAliveCount(int Team) const;
+	bool CanShoot(int Fighter) const;
+	// *** //
+
+	// Take health off a fighter, ending the match if their team is wiped out.
+	void ApplyDamage(int Fighter, float Damage);
+
+	// Start a particular fighter's turn, for when something else decides the turn order.
+	void StartTurn(int Fighter);
+
+private:
+	// Take the fighter's next roll.
+	float Roll(int Fighter);
+
+	// Pick the next fighter after the current one.
+	void StartNextTurn();
+
+	// Pick the living fighter with the earliest next turn.
+	void StartNextInitiativeTurn();
+
+	// Time between turns for a fighter, going by initiative.
+	static float GetTurnInterval(const FArenaFighter& Fighter);
+
+	// Check for a winner.
+	void UpdateOver();
+};
@@ -0,0 +1,72 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ArenaSearch.h"
+
+/**
+ * Plays one team's turns with FArenaSearch. The search runs on worker threads for a fixed budget per turn, and Poll()
+ * hands the chosen action back once the budget is spent, so the game thread never waits on it.
+ *
+ * While other teams play, it ponders: the bot plays their turns out in a copy of the match, and the search starts on
+ * the AI's predicted next turn. If the real match reaches the same state, that search carries on with its trees,
+ * otherwise it's restarted from the real state.
+ */
+class UE5_AR_API FArenaAIController
+{
+public:
+	// Start choosing the current fighter's action, with a budget in seconds.
+	void StartTurn(const FArena& State, float Budget);
+
+	// Search the AI's next turn while another team plays.
+	void StartPondering(const FArena& State);
+
+	// Call every frame. Returns true once the budget is spent and the workers have stopped, with the chosen action.
+	bool Poll(float DeltaSeconds, FArenaAction& OutAction);
+
+	// Drop any search in progress.
+	void Cancel();
+
+	bool IsThinking() const { return Phase == EPhase::Thinking; }
+
+	// The team the AI plays. INDEX_NONE leaves every team to people.
+	int Team = INDEX_NONE;
+
+	// Worker tasks to search on. 0 uses one per core less one for the game thread, up to MaxDefaultWorkers.
+	int NumWorkers = 0;
+	static constexpr int MaxDefaultWorkers = 2;
+
+	// Seconds to ponder for before stopping to wait for the AI's turn. The trees are kept for the turn.
+	float PonderBudget = 10.0f;
+
+	// Seed for the search and pondering predictions.
+	uint64 Seed = 0;
+
+private:
+	enum class EPhase : uint8
+	{
+		Idle,
+		Pondering,
+		Thinking
+	};
+
+	// Whether two states are close enough that a search from one is good for the other.
+	static bool IsSameState(const FArena& A, const FArena& B);
+
+	// Start or resume the search once the previous workers have wound down.
+	void LaunchWhenIdle();
+
+	FArenaSearch Search;
+	EPhase Phase = EPhase::Idle;
+	float TimeLeft = 0.0f;
+
+	// Launch waiting for the workers to stop, and whether it continues the existing trees.
+	bool bLaunchPending = false;
+	bool bResumePending = false;
+	FArena PendingRoot;
+
+	// State the ponder search was started from, and whether there's one.
+	FArena Prediction;
+	bool bHasPrediction = false;
+};
@@ -0,0 +1,30 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+struct FArena;
+
+/**
+ * A simple greedy player for the arena simulation, used for bot matches and as a baseline opponent.
+ * Throws the grenade when it would catch at least two more enemies than friends, otherwise closes in until it has a fair
+ * shot and takes the best one. Doesn't allocate.
+ */
+struct UE5_AR_API FArenaBot
+{
+	// Play the current fighter's whole turn, ending it.
+	static void PlayTurn(FArena& Arena);
+
+	// Where a grenade would do the most good for the current fighter. False if nowhere is worth it.
+	static bool FindGrenadeLanding(const FArena& Arena, FVector& OutLanding);
+
+	// The enemy the current fighter has the best chance of hitting. INDEX_NONE if there isn't one.
+	static int FindBestTarget(const FArena& Arena, float& OutHitChance);
+
+	// The closest living enemy to the current fighter.
+	static int FindNearestEnemy(const FArena& Arena);
+
+	// Hit chance below which the bot moves before shooting.
+	static constexpr float MinHitChance = 0.5f;
+};
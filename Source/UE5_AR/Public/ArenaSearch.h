@@ -0,0 +1,94 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Arena.h"
+#include "Tasks/Task.h"
+
+// The actions considered for one turn.
+typedef TArray<FArenaAction, TInlineAllocator<32>> FArenaActionList;
+
+/**
+ * Monte Carlo tree search over the arena simulation. Each tree node is one fighter's turn, taking a single action and
+ * ending the turn. Shots are random, so the tree is open loop: every iteration replays the actions from the root state
+ * with its own match seed, and the statistics average over outcomes. Leaves are played out by FArenaBot for a few turns.
+ *
+ * Search is root parallel. Each worker grows its own tree on a background priority task, so engine work on the task graph
+ * goes first, and the root statistics are merged when picking the action. Workers run until Stop() and can be resumed,
+ * keeping their trees.
+ */
+class UE5_AR_API FArenaSearch
+{
+public:
+	FArenaSearch();
+	~FArenaSearch();
+
+	// Start searching from a state, dropping any previous trees.
+	void Start(const FArena& InRoot, int NumWorkers, uint64 Seed);
+
+	// Carry on growing the existing trees.
+	void Resume();
+
+	// Ask the workers to stop. They finish their current iteration, so this doesn't wait.
+	void Stop();
+
+	// Whether every worker has finished since the last Stop().
+	bool IsIdle() const;
+
+	// The most visited root action over all workers. Only valid once idle.
+	bool GetBestAction(FArenaAction& OutAction) const;
+
+	const FArena& GetRoot() const { return Root; }
+	int64 GetIterations() const;
+
+	// The actions considered for the current fighter. The root's children are always in this order.
+	static void GetActions(const FArena& Arena, FArenaActionList& OutActions);
+
+	// Turns played out by the bot from a leaf before scoring.
+	static constexpr int RolloutTurns = 12;
+
+	// Nodes per worker tree, a few MB each. Leaves stop expanding once a tree is full.
+	static constexpr int MaxNodes = 1 << 16;
+
+private:
+	struct FNode
+	{
+		FArenaAction Action;
+
+		// Team that took the action leading to this node, which the node's value is for.
+		int Team = INDEX_NONE;
+
+		int FirstChild = INDEX_NONE;
+		int NumChildren = 0;
+		int Visits = 0;
+		float Value = 0.0f;
+	};
+
+	struct FWorker
+	{
+		TArray<FNode> Nodes;
+		FMatchRandomStream Random;
+		int64 Iterations = 0;
+	};
+
+	// Run iterations on one worker until asked to stop.
+	void RunWorker(FWorker& Worker);
+
+	// One select, expand, play out and back up pass.
+	void Iterate(FWorker& Worker);
+
+	// Launch a task per worker.
+	void LaunchWorkers();
+
+	// Each team's score for a state. 1 for a win, shared for a draw, otherwise share of health left.
+	static void Evaluate(const FArena& Arena, TArray<float, TInlineAllocator<FArena::MaxTeams>>& OutScores);
+
+	FArena Root;
+	TArray<TUniquePtr<FWorker>> Workers;
+	TArray<UE::Tasks::FTask> Tasks;
+	TAtomic<bool> bStopRequested;
+
+	// Exploration constant for UCT.
+	float Exploration = 1.4f;
+};
@@ -0,0 +1,124 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class AActor;
+
+// What an indexed actor is, used to filter queries.
+enum class EArenaEntryKind : uint8
+{
+	Fighter,
+	Obstacle,
+	Grenade
+};
+
+// An actor in the spatial index. Bounds are an axis aligned box in arena space.
+struct FArenaSpatialEntry
+{
+	AActor* Actor = nullptr;
+	EArenaEntryKind Kind = EArenaEntryKind::Fighter;
+	int Team = INDEX_NONE;
+	FVector Center = FVector::ZeroVector;
+	FVector Extent = FVector::ZeroVector;
+
+	// Cells covered, and the last update and query that touched the entry.
+	FIntPoint MinCell = FIntPoint::ZeroValue;
+	FIntPoint MaxCell = FIntPoint::ZeroValue;
+	uint32 UpdateStamp = 0;
+	uint32 QueryStamp = 0;
+};
+
+// The closest entry hit by a ray.
+struct FArenaRayHit
+{
+	const FArenaSpatialEntry* Entry = nullptr;
+	FVector Location = FVector::ZeroVector;
+	float Distance = 0.0f;
+};
+
+/**
+ * Uniform grid over the arena plane holding fighters, obstacles and grenades, so gameplay queries don't need the physics
+ * scene. Entries are stored in arena space, so moving the arena anchor doesn't move them in the grid. Queries take world
+ * space positions and convert them with the arena transform.
+ * Entries are only re-bucketed when they cross a cell boundary.
+ */
+class UE5_AR_API FArenaSpatialIndex
+{
+public:
+	typedef TFunctionRef<bool(const FArenaSpatialEntry&)> FFilter;
+
+	explicit FArenaSpatialIndex(float InCellSize = 20.0f);
+
+	// Set the arena's transform in the world. Identity when the arena isn't anchored.
+	void SetArenaTransform(const FTransform& InArenaTransform);
+
+	// Start a round of updates. Entries not updated before RemoveStale() are dropped.
+	void BeginUpdate() { UpdateStamp++; }
+
+	// Add or move an actor. Extent is the half size of the actor's box, along the arena's axes.
+	void Update(AActor* Actor, EArenaEntryKind Kind, int Team, const FVector& WorldCenter, const FVector& Extent);
+
+	// Remove actors that weren't updated since BeginUpdate().
+	void RemoveStale();
+
+	// Remove one actor.
+	void Remove(AActor* Actor);
+
+	// Remove everything.
+	void Reset();
+
+	// Queries, in world space.
+	// *** //
+	// Entries whose box overlaps a sphere.
+	void QueryRadius(const FVector& WorldCenter, float Radius, TArray<const FArenaSpatialEntry*>& OutEntries, FFilter Filter);
+
+	// The first entry hit by a line segment.
+	bool Raycast(const FVector& WorldStart, const FVector& WorldEnd, FArenaRayHit& OutHit, FFilter Filter);
+
+	// The closest entry to a point, by box centre.
+	const FArenaSpatialEntry* FindNearest(const FVector& WorldLocation, FFilter Filter, float MaxDistance = BIG_NUMBER);
+
+	// Whether anything blocks a segment given in arena space. Doesn't touch query stamps, so it's safe to call from several
+	// threads at once as long as nothing updates the index meanwhile.
+	bool IsSegmentBlocked(const FVector& LocalStart, const FVector& LocalEnd, FFilter Filter) const;
+	// *** //
+
+	const FTransform& GetArenaTransform() const { return ArenaTransform; }
+
+	// Where a segment enters a box, as a fraction along the segment. False if it misses.
+	static bool IntersectSegmentBox(const FVector& Start, const FVector& Delta, const FVector& Center, const FVector& Extent, float& OutTime);
+
+	const FArenaSpatialEntry* Find(const AActor* Actor) const;
+	int Num() const { return EntryIndices.Num(); }
+
+private:
+	// Takes a cell's entry indices and the fraction along the segment where it leaves the cell. Returns false to stop.
+	typedef TFunctionRef<bool(const TArray<int>&, float)> FCellVisitor;
+
+	// Visit the occupied cells under an arena space segment, in order from its start.
+	void WalkCells(const FVector& LocalStart, const FVector& LocalEnd, FCellVisitor Visit) const;
+
+	FIntPoint GetCell(const FVector& LocalPosition) const;
+	void AddToCells(int Index);
+	void RemoveFromCells(int Index);
+
+	float CellSize;
+	FTransform ArenaTransform;
+
+	// Entries with a free list, and where each actor's entry lives.
+	TArray<FArenaSpatialEntry> Entries;
+	TArray<int> FreeEntries;
+	TMap<const AActor*, int> EntryIndices;
+
+	// Entry indices in each occupied cell.
+	TMap<FIntPoint, TArray<int>> Cells;
+
+	// Range of cells that have ever been occupied, which bounds the nearest search.
+	FIntPoint MinOccupied;
+	FIntPoint MaxOccupied;
+
+	uint32 UpdateStamp = 0;
+	uint32 QueryStamp = 0;
+};
@@ -0,0 +1,72 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "Arena.h"
+#include "BalanceSweepCommandlet.generated.h"
+
+// One combination of swept parameters.
+struct FBalanceSweepConfig
+{
+	int PawnsPerTeam = 3;
+	FArenaRules Rules;
+
+	// ExplosionRadius as set on AGrenade, before the grenade's scale.
+	float ExplosionRadius = 3000.0f;
+};
+
+// Outcome of one bot match.
+struct FBalanceSweepResult
+{
+	int WinningTeam = INDEX_NONE;
+	int Turns = 0;
+	bool bFinished = false;
+};
+
+/**
+ * Plays bot against bot matches in the arena simulation across every combination of the swept parameters, on all cores,
+ * and writes win rates and turn counts to a csv file. Nothing is spawned, so it runs without a map.
+ *
+ * UnrealEditor-Cmd UE5_AR.uproject -run=BalanceSweep -Matches=1000 -PawnsPerTeam=2,3,4 -MinDamage=20,25 -MaxDamage=35
+ *     -ExplosionRadius=2000,3000 -MovableDistance=80,100,120 -Output=<csv file> -Seed=<n> -Teams=<n> -Obstacles=<n> -MaxTurns=<n>
+ *
+ * Every parameter takes a comma separated list. Parameters left out use the actors' defaults.
+ */
+UCLASS()
+class UE5_AR_API UBalanceSweepCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UBalanceSweepCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+
+protected:
+	// Play one match to the end, or until the turn cap.
+	FBalanceSweepResult PlayMatch(const FBalanceSweepConfig& Config, uint64 Seed) const;
+
+	// Lay out fighters and obstacles for a match, using the arena's seed.
+	void SetupArena(FArena& Arena, const FBalanceSweepConfig& Config) const;
+
+	// Parse a comma separated list of numbers, keeping the default if the parameter isn't given.
+	static TArray<float> ParseList(const FString& Params, const TCHAR* Name, float Default);
+
+	int NumTeams;
+	int ObstacleCount;
+	int MaxTurns;
+
+	// Fighter and obstacle boxes in arena space, and the scale of the fighter's grenade, which the explosion radius is
+	// multiplied by. Taken from the actors' defaults.
+	// *** //
+	FVector FighterExtent;
+	FVector ObstacleExtent;
+	float GrenadeScale;
+	// *** //
+
+	// Distance of each team's start line from the middle of the arena, and the gap between fighters.
+	float StartDistance;
+	float FighterSpacing;
+};
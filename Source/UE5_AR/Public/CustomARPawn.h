@@ -6,16 +6,24 @@
 #include "CustomARPawn.generated.h"
 
 class UCameraComponent;
+class UMatchRegistrySubsystem;
+class AFighterPawn;
 
 UCLASS()
 class UE5_AR_API ACustomARPawn : public APawn
 {
 	GENERATED_BODY()
 
+	// The benchmark drives a match through the touch handlers.
+	friend class UMatchBenchmarkSubsystem;
+
 public:
 	// Sets default values for this pawn's properties
 	ACustomARPawn();
 
+	// Shortest drag, in pixels, that throws a grenade.
+	static constexpr float MinThrowDrag = 50.0f;
+
 protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
@@ -30,6 +38,19 @@ protected:
 	FVector TouchEnd;
 	FVector TouchStart;
 
+	// Drag the grenade preview was last worked out for, and the fighter showing it.
+	FVector GrenadePreviewDrag;
+	TWeakObjectPtr<AFighterPawn> GrenadePreviewFighter;
+
+	// Update the grenade preview if the drag has changed.
+	void UpdateGrenadePreview(AFighterPawn* Fighter);
+
+	// Hide the grenade preview, if there is one.
+	void HideGrenadePreview();
+
+	// Registry for finding the game mode.
+	UMatchRegistrySubsystem* Registry;
+
 	// Tracks grenade button presses, prevents grenades from being thrown when pressing the grenade button.
 	UPROPERTY(BlueprintReadWrite)
 	bool bGrenadeButtonPressed;
@@ -6,11 +6,19 @@
 #include "FighterPawn.h"
 #include "Blueprint/UserWidget.h"
 #include "Obstacle.h"
+#include "TeamRoster.h"
+#include "TurnScheduler.h"
+#include "ArenaSpatialIndex.h"
+#include "LineOfSightCache.h"
+#include "Arena.h"
+#include "ArenaAIController.h"
+#include "MatchJournal.h"
 
 #include "CustomGameMode.generated.h"
 
 //Forward Declarations
 class APlaceableActor;
+class UARPin;
 
 /**
  * 
@@ -31,23 +39,93 @@ enum class EGamePhase : uint8
 	GAME_END		UMETA(DisplayName = "Game End")
 };
 
+// Fired once per grenade explosion, with every fighter it damaged.
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FOnExplosionResolved, FVector, Location, const TArray<AFighterPawn*>&, Victims);
+
+// Fired when a team wins. The team is INDEX_NONE if the last teams wiped each other out.
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnGameWon, int32, WinningTeam);
+
 UCLASS()
 class UE5_AR_API ACustomGameMode : public AGameModeBase
 {
 	GENERATED_BODY()
 private:
-	// Fighter and obstacle arrays.
-	TArray<AFighterPawn*> RedTeamActors;
-	TArray<AFighterPawn*> BlueTeamActors;
+	// Team rosters and obstacle array. Red is team 0, blue is team 1.
+	TArray<FTeamRoster> Teams;
 	TArray<AObstacle*> Obstacles;
 
 	// Fighter and obstacle limits.
 	int ObstacleLimit;
 	int PawnsPerTeam;
 
-	// Fighter turn counters for each team- determines which fighter is used this turn.
-	int RedTurnCounter;
-	int BlueTurnCounter;
+	// Picks the fighter for each turn.
+	TUniquePtr<FTurnScheduler> Scheduler;
+
+	// Number of teams with fighters left.
+	int AliveTeams;
+
+	// Seed every roll in the current match comes from.
+	uint64 CurrentSeed;
+
+	// Grenades out of play, waiting to be thrown.
+	UPROPERTY()
+	TArray<AGrenade*> GrenadePool;
+
+	// Records the match when started with -MatchJournal=<file>. Each match gets its own file, named after the given one
+	// with the time it started and its seed.
+	FMatchJournalWriter Journal;
+
+	// Fighters, obstacles and grenades in the arena, for gameplay queries.
+	FArenaSpatialIndex SpatialIndex;
+
+	// Bring the spatial index up to date with the actors' current positions.
+	void UpdateSpatialIndex();
+
+	// Whether each pair of fighters can see each other. Updated after the spatial index.
+	FLineOfSightCache LineOfSight;
+
+	// Empty the rosters, ready for NumTeams teams.
+	void ResetTeams();
+
+	// Add a spawned fighter to a team.
+	void AddToTeam(AFighterPawn* Fighter, int Team);
+
+	// Make every fighter face the average position of the other teams.
+	void FaceTeamsTogether();
+
+	// Update the rosters when a fighter dies, and end the game if a team is wiped out.
+	void OnFighterDied(AFighterPawn* Fighter);
+
+	// End the game if one team or none is left. Called once per action, after all of its deaths.
+	void UpdateWinner();
+
+	// Set while an action's damage is being applied, so the winner is decided once it's all in.
+	bool bDeferWinner;
+
+	// Plays AITeam's turns.
+	FArenaAIController AI;
+
+	// Ends the AI's turn once its action has played out.
+	FTimerHandle AITurnEndTimer;
+	bool bAIWaitingForMove;
+
+	// Set while the AI carries out its action or ends its turn, so its own calls aren't blocked as player input.
+	bool bIsAIActing;
+
+	// Start the AI thinking, or pondering, for the turn that just started.
+	void UpdateAIForTurn();
+
+	// Carry out the AI's chosen action with the current fighter.
+	void ApplyAIAction(const FArenaAction& Action);
+
+	// End the AI's turn.
+	void EndAITurn();
+
+	// The fighter at an index in CaptureArena()'s order.
+	AFighterPawn* GetArenaFighter(int Index);
+
+	// Keep a spawned actor in place, with its own pin or in the arena frame if Pin is null.
+	void PinMatchActor(AActor* Actor, UARPin* Pin, float Scale, bool bKeepRotation);
 
 public:
 	// Constructor and destructor.
@@ -55,6 +133,7 @@ public:
 	virtual ~ACustomGameMode() = default;
 
 	virtual void StartPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 
 	UFUNCTION(BlueprintNativeEvent, Category = "GameModeBase", DisplayName = "Start Play")
 	void StartPlayEvent();
@@ -63,7 +142,53 @@ public:
 	UPROPERTY(VisibleAnywhere, BlueprintReadWrite)
 	EGamePhase CurrentPhase;
 
-	// Track whether it's red or blue's turn.
+	// Anchor the arena plane once and place match actors relative to it, instead of giving each actor its own pin.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	bool bUseArenaAnchor;
+
+	// Number of teams in a match. Two teams play red against blue, more make a free-for-all.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	int NumTeams;
+
+	// How turns are handed out.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	ETurnOrder TurnOrder;
+
+	// Team played by the AI. INDEX_NONE for no AI.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	int AITeam;
+
+	// Seed for the match's rolls, so a match can be played again with the same outcomes. 0 picks a new seed each match,
+	// which is logged at the start of the match. Holds all 64 bits of a seed.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	int64 MatchSeed;
+
+	// Seconds the AI thinks for on each turn.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	float AITurnTime;
+
+	// Whether the AI searches ahead while other teams play.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	bool bAIPonder;
+
+	// When above 0, taps that miss every enemy pick the one whose centre is nearest where they meet the arena, up to this
+	// far away in arena units. Only used while the arena is anchored.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	float TargetSnapDistance;
+
+	// Longest drag, in pixels, the AI considers throwing grenades with.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	float AIMaxGrenadeDrag;
+
+	// Fighter colour for each team.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	TArray<FColor> TeamColors;
+
+	// The team placing fighters, or taking the current turn.
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	int CurrentTeam;
+
+	// Track whether it's red's (team 0) turn.
 	UPROPERTY(VisibleAnywhere, BlueprintReadWrite)
 	bool bIsRedTurn;
 
@@ -74,8 +199,20 @@ public:
 
 	UPROPERTY(VisibleAnywhere, BlueprintReadWrite)
 	bool bHasBlueWon;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	int WinningTeam;
+
+	UPROPERTY(BlueprintAssignable)
+	FOnGameWon OnGameWon;
 	// *** //
 
+	UPROPERTY(BlueprintAssignable)
+	FOnExplosionResolved OnExplosionResolved;
+
+	// Damage every fighter caught in an explosion, settle any deaths and the winner, then tell the UI once.
+	void ApplyExplosionDamage(const FVector& Location, const TArray<AFighterPawn*>& Victims, const TArray<int>& Damage);
+
 	// The current turn's pawn.
 	UPROPERTY(VisibleAnywhere, BlueprintReadWrite)
 	AFighterPawn* CurrentFighter;
@@ -86,16 +223,69 @@ public:
 	TArray<AObstacle*> GetObstacles() { return Obstacles; };
 
 	UFUNCTION(BlueprintCallable)
-	TArray<AFighterPawn*> GetRedTeam() { return RedTeamActors; };
+	TArray<AFighterPawn*> GetRedTeam() { return GetTeam(0); };
+
+	UFUNCTION(BlueprintCallable)
+	TArray<AFighterPawn*> GetBlueTeam() { return GetTeam(1); };
+
+	UFUNCTION(BlueprintCallable)
+	TArray<AFighterPawn*> GetTeam(int Team) { return Teams.IsValidIndex(Team) ? Teams[Team].GetFighters() : TArray<AFighterPawn*>(); };
+	// *** //
 
+	// The living enemy of a team nearest a world space location, from the spatial index. Null if none is within
+	// MaxDistance.
 	UFUNCTION(BlueprintCallable)
-	TArray<AFighterPawn*> GetBlueTeam() { return BlueTeamActors; };
+	AFighterPawn* FindNearestEnemy(int Team, FVector Location, float MaxDistance);
+
+	// Getter for the spatial index.
+	FArenaSpatialIndex& GetSpatialIndex() { return SpatialIndex; };
+
+	// Getter for the line of sight cache.
+	FLineOfSightCache& GetLineOfSight() { return LineOfSight; };
+
+	// Copy the match into the arena simulation, in arena space, with the current fighter's turn under way.
+	void CaptureArena(FArena& OutArena);
+
+	// Getter for the match journal.
+	FMatchJournalWriter& GetJournal() { return Journal; };
+
+	// Getter for the current match's seed.
+	uint64 GetMatchSeed() { return CurrentSeed; };
+
+	// Getter for the number of teams in play.
+	int GetNumTeams() { return Teams.Num(); };
+
+	// Colour for a team's fighters.
+	FColor GetTeamColor(int Team);
+
+	// Getter for the team size.
+	int GetPawnsPerTeam() { return PawnsPerTeam; };
+
+	// Fly grenades along the fixed-step ballistic flight the throw preview shows, instead of simulating them with physics.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	bool bBallisticGrenades;
+
+	// Grenades spawned ahead of the first throw.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	int GrenadePoolSize;
+
+	// Take a grenade from the pool, spawning one if it's empty, and give one back once it's out of play.
+	// *** //
+	AGrenade* TakeGrenade();
+	void ReturnGrenade(AGrenade* Grenade);
 	// *** //
 	
 	// Start the game.
 	UFUNCTION(BlueprintCallable)
 	void StartGame();
 
+	// Whether the AI's team has the current turn. Touches and UI turn actions are ignored while it does.
+	UFUNCTION(BlueprintCallable)
+	bool IsAITurn();
+
+	// Whether the current fighter can be made to act. Only the AI can act on the AI's turn.
+	bool CanTakeTurnAction() { return !IsAITurn() || bIsAIActing; };
+
 	// Start and end turn.
 	// *** //
 	UFUNCTION(BlueprintCallable)
@@ -6,11 +6,11 @@
 #include "GameFramework/Character.h"
 #include "GunComponent.h"
 #include "Grenade.h"
+#include "MatchJournal.h"
+#include "GrenadeTrajectory.h"
 
 #include "FighterPawn.generated.h"
 
-class UARPin;
-
 // Enum for tracking whether it is a fighter's turn or they are being targeted.
 UENUM(BlueprintType)
 enum class ESelectionState : uint8
@@ -20,6 +20,13 @@ enum class ESelectionState : uint8
 	SELECTED	UMETA(DisplayName = "Selected")
 };
 
+struct FArenaRules;
+struct FArenaFighter;
+class UInstancedStaticMeshComponent;
+
+// Fired once when a fighter's health runs out.
+DECLARE_MULTICAST_DELEGATE_OneParam(FOnFighterDied, AFighterPawn*);
+
 UCLASS()
 class UE5_AR_API AFighterPawn : public ACharacter
 {
@@ -32,10 +39,14 @@ public:
 protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 
 	// Update the fighter's indicator - displaying whether it is their turn or if they are being targeted.
 	void UpdateIndicator();
 
+	// Only tick while the indicator is showing or the fighter is moving. The pin position is handled by UARPinManager.
+	void UpdateTickEnabled();
+
 	// Timer handles for resetting animations and throwing grenades.
 	FTimerHandle AnimationResetTimer;
 	FTimerHandle GrenadeReleaseTimer;
@@ -77,9 +88,6 @@ protected:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite)
 	FVector TargetPos;
 
-	// The fighter's offset from the pin's location.
-	FVector Offset;
-
 	// Player movement is limited to this distance per turn.
 	UPROPERTY(EditAnywhere, BlueprintReadWrite)
 	float MovableDistance;
@@ -119,6 +127,24 @@ protected:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite)
 	UStaticMeshComponent* GrenadeMesh;
 
+	// Where grenades leave the hand, relative to the fighter. Thrown and previewed grenades both start here, whatever pose
+	// the throw animation has the hand in.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	FVector GrenadeReleaseOffset;
+
+	// Dots along the previewed grenade arc, and a disc the size of the blast where it lands.
+	// *** //
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	UInstancedStaticMeshComponent* GrenadeArc;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	UStaticMeshComponent* GrenadeLandingMarker;
+	// *** //
+
+	// Arc points from the last preview, kept to save reallocating.
+	TArray<FVector> GrenadeArcPoints;
+	TArray<FTransform> GrenadeArcDots;
+
 	// Dynamic material used for changing the fighter's colour.
 	UPROPERTY(EditAnywhere, BlueprintReadWrite)
 	UMaterialInstanceDynamic* MeshMaterial;
@@ -144,9 +170,29 @@ protected:
 	// Min and max damage for shooting.
 	float MinDamage;
 	float MaxDamage;
+
+	// How often the fighter acts when turns are ordered by initiative. A fighter with twice the initiative gets twice the turns.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	float Initiative;
+
+	// The fighter's team and slot in the team roster.
+	int Team;
+	int RosterSlot;
+
+	// Rolls taken from the fighter's match random stream.
+	uint32 RollCount;
+
+	// Take the fighter's next roll, in [0, 1).
+	float Roll();
+
+	// Write one of the fighter's actions to the match journal, if one is being recorded.
+	void RecordAction(FMatchJournalRecord Record);
+
+	// Whether the game mode lets the fighter act. UI actions are ignored on the AI's turn.
+	bool CanTakeTurnAction();
 public:	
-	// Pin component to keep the fighter in the same real world position.
-	UARPin* PinComponent;
+	// Called when the fighter dies.
+	FOnFighterDied OnDied;
 
 	// Called every frame
 	virtual void Tick(float DeltaTime) override;
@@ -154,6 +200,12 @@ public:
 	// Called to bind functionality to input
 	virtual void SetupPlayerInputComponent(class UInputComponent* PlayerInputComponent) override;
 
+	// Getter for the fighter's size.
+	float GetScale() const { return Scale; };
+
+	// Scale of the fighter's grenade once the fighter is placed at its size, which the explosion radius is multiplied by.
+	float GetPlacedGrenadeScale() const { return GrenadeMesh->GetRelativeScale3D().X * Scale; };
+
 	// Getter for half height.
 	float GetHalfHeight() { return HalfHeight; };
 		 
@@ -177,6 +229,9 @@ public:
 	// Select a target.
 	void SelectTarget(AFighterPawn* Target);
 
+	// Hit chance against a target from the current position, without targeting it.
+	float PreviewHitChance(AFighterPawn* Target, bool& bOutObstructed);
+
 	// End the targeting process.
 	UFUNCTION(BlueprintCallable)
 	void EndTargeting();
@@ -192,15 +247,71 @@ public:
 	// Releases the grenade - called after timer to match animation.
 	void ReleaseGrenade(FVector Dir);
 
+	// The impulse a grenade is thrown with for a drag, and the launch velocity that gives it.
+	// *** //
+	FVector GetGrenadeImpulse(FVector Dir);
+	FVector GetGrenadeLaunchVelocity(FVector Dir);
+	// *** //
+
+	// Where thrown grenades start, in world space.
+	FTransform GetGrenadeReleaseTransform();
+
+	// How the fighter's grenades fly, in arena space.
+	FGrenadeFlight GetGrenadeFlight(const FTransform& ArenaTransform);
+
+	// The obstacles grenades bounce off, as arena space boxes.
+	void GetGrenadeObstacles(TArray<FArenaObstacle>& OutObstacles);
+
+	// The drag between MinDrag and MaxDrag whose predicted flight, thrown the way the fighter faces, lands nearest an
+	// arena space point.
+	float FindGrenadeDrag(const FVector& Landing, float MinDrag, float MaxDrag);
+
+	// Show where a grenade thrown with a drag would fly and land, without touching the physics scene.
+	// *** //
+	void PreviewGrenade(FVector Dir);
+	void HideGrenadePreview();
+	// *** //
+
 	// Take damage.
 	void ReceiveDamage(int Dmg);
 
+	// Take damage without reporting a death, for damage applied in a batch. Returns true if it killed the fighter,
+	// who then needs NotifyDied() once the batch is in.
+	// *** //
+	bool ApplyDamage(int Dmg);
+	void NotifyDied();
+	// *** //
+
 	// Reset certain variables on turn start.
 	void TurnReset();
 
 	// Getter for the death status.
 	bool GetIsDead() { return bIsDead; };
 
+	bool GetIsMoving() { return bIsMoving; };
+
+	// Team and roster slot.
+	// *** //
+	void SetRosterSlot(int InTeam, int InSlot) { Team = InTeam; RosterSlot = InSlot; };
+	int GetTeam() { return Team; };
+	int GetRosterSlot() { return RosterSlot; };
+	// *** //
+
+	// Half size of the fighter's capsule, for the arena spatial index.
+	FVector GetArenaExtent() const;
+
+	// Location of the centre socket, which line of sight is measured between.
+	FVector GetCentreLocation();
+
+	// Getter for the initiative.
+	float GetInitiative() { return Initiative; };
+
+	// The fighter's rules and state for the arena simulation. Positions are in arena space.
+	// *** //
+	FArenaRules GetRules();
+	FArenaFighter GetArenaState(const FTransform& ArenaTransform);
+	// *** //
+
 	// Function for setting move to location.
 	void MoveTo(FVector Location);
 
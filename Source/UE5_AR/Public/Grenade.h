@@ -5,6 +5,7 @@
 #include "CoreMinimal.h"
 #include "GameFramework/Actor.h"
 #include "Particles/ParticleSystemComponent.h"
+#include "GrenadeTrajectory.h"
 
 #include "Grenade.generated.h"
 
@@ -20,6 +21,7 @@ public:
 protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 
 	// The mesh of the grenade.
 	UPROPERTY(EditAnywhere, BlueprintReadWrite)
@@ -33,13 +35,31 @@ protected:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite)
 		UParticleSystemComponent* Explosion;
 
-	// The ground for the grenade to roll on.
-	UPROPERTY(EditAnywhere, BlueprintReadWrite)
-		UStaticMeshComponent* Ground;
-
-	// A timer for handling the delay between the grenade spawning and blowing up.
+	// A timer for handling the delay between the grenade being thrown and blowing up.
 	FTimerHandle ExplodeTimer;
 
+	// Returns the grenade to the pool if the explosion's effects never report finishing.
+	FTimerHandle ReturnTimer;
+
+	// Whether the grenade has been thrown and not yet returned, and which of its effects are still playing.
+	// *** //
+	bool bIsInPlay;
+	bool bIsExplosionPlaying;
+	bool bIsSoundPlaying;
+	// *** //
+
+	// The flight followed when the grenade is launched without physics, in arena space.
+	// *** //
+	bool bIsBallistic;
+	FGrenadeFlight Flight;
+	FGrenadeState FlightState;
+	TArray<FArenaObstacle> FlightObstacles;
+	float FlightTime;
+	// *** //
+
+	// Show the grenade in the thrower's hand and start its throw.
+	void StartThrow(const FTransform& Transform);
+
 	// How long the grenade takes to explode.
 	float ExplosionDelay;
 
@@ -52,10 +72,48 @@ protected:
 	// Function to blow up the grenade.
 	void Explode();
 
+	// Called as the explosion's particles and sound finish.
+	// *** //
+	UFUNCTION()
+	void OnExplosionFinished(UParticleSystemComponent* System);
+
+	UFUNCTION()
+	void OnSoundFinished();
+	// *** //
+
+	// Take the grenade out of play, hidden and without physics, ready to be thrown again.
+	void Deactivate();
+
 public:	
 	// Called every frame
 	virtual void Tick(float DeltaTime) override;
 
+	// Getters for the explosion. The radius is before the grenade's scale is applied.
+	// *** //
+	float GetExplosionRadius() const { return ExplosionRadius; };
+	float GetDamage() const { return Damage; };
+	float GetExplosionDelay() const { return ExplosionDelay; };
+	// *** //
+
+	// Throw the grenade from a transform, clearing anything left from its last throw.
+	void Launch(const FTransform& Transform, const FVector& Impulse);
+
+	// Throw the grenade along a fixed-step ballistic flight instead of simulating it, so it follows the previewed arc on
+	// every device. Velocity and obstacles are in arena space.
+	void LaunchBallistic(const FTransform& Transform, const FGrenadeFlight& InFlight, const FVector& Velocity, TArrayView<const FArenaObstacle> Obstacles);
+
+	// Put the grenade back in the game mode's pool, or destroy it if there's no game mode.
+	void ReturnToPool();
+
+	bool IsInPlay() const { return bIsInPlay; };
+
+	// Seconds after exploding before the grenade goes back to the pool whatever its effects are doing.
+	float EffectTimeout;
+
 	// Function to get the grenade's mesh.
 	UStaticMeshComponent* GetMesh() { return GrenadeMesh; };
+
+	// Centre and half size of the grenade, for the arena spatial index.
+	FVector GetArenaCenter() { return GrenadeMesh->Bounds.Origin; };
+	FVector GetArenaExtent() { return FVector(GrenadeMesh->Bounds.SphereRadius); };
 };
@@ -0,0 +1,74 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Arena.h"
+
+// How a grenade flies and bounces. Distances are in arena space, where the arena plane is Z = 0.
+struct FGrenadeFlight
+{
+	FVector Gravity = FVector(0.0f, 0.0f, -980.0f);
+
+	// Radius of the grenade, which it bounces off surfaces at.
+	float Radius = 0.0f;
+
+	// Share of the speed into a surface kept when bouncing off it, and how much each bounce slows sliding along it.
+	// Defaults match the engine's default physical material.
+	float Restitution = 0.3f;
+	float Friction = 0.7f;
+
+	// Seconds from release until the grenade explodes.
+	float FuseTime = 1.5f;
+
+	// Below this speed into a surface the grenade stops instead of bouncing.
+	float RestSpeed = 1.0f;
+
+	// Points per second along the arc.
+	float StepsPerSecond = 60.0f;
+
+	// The arena plane's boundary. Grenades fall past the plane outside it. Empty for an unbounded plane.
+	TArray<FVector2D> Floor;
+};
+
+// Where a grenade is in its flight.
+struct FGrenadeState
+{
+	FVector Position = FVector::ZeroVector;
+	FVector Velocity = FVector::ZeroVector;
+
+	// Seconds since release.
+	float Time = 0.0f;
+
+	int Bounces = 0;
+
+	// Whether the grenade is sliding along the arena plane, and whether it has stopped.
+	bool bOnFloor = false;
+	bool bAtRest = false;
+};
+
+/**
+ * Works out a grenade's flight without the physics scene. Between bounces the grenade follows a parabola, evaluated in
+ * closed form. Landings on the arena plane are solved exactly, and obstacles are swept as boxes along each step of the arc.
+ * Once it stops bouncing on the plane it slides along it until friction stops it, and only surfaces facing up can be
+ * rested on. Steps are a fixed length, cut short at a bounce, so stepping a grenade through its flight frame by frame
+ * follows the same points as predicting it.
+ */
+struct UE5_AR_API FGrenadeTrajectory
+{
+	// Where a grenade released at Start with Velocity is when it explodes. Fills OutPoints with points along the arc.
+	static FVector Predict(const FGrenadeFlight& Flight, const FVector& Start, const FVector& Velocity, TArrayView<const FArenaObstacle> Obstacles, TArray<FVector>* OutPoints = nullptr);
+
+	// Move a grenade on by one step, or up to the surface it hits during the step. Does nothing once it's at rest or its
+	// fuse has run out.
+	static void Step(const FGrenadeFlight& Flight, FGrenadeState& State, TArrayView<const FArenaObstacle> Obstacles);
+
+	// Move a grenade sliding on the arena plane, slowed by friction.
+	static void Slide(const FGrenadeFlight& Flight, FGrenadeState& State, TArrayView<const FArenaObstacle> Obstacles, float DeltaTime);
+
+	// Bounce a velocity off a surface.
+	static FVector Bounce(const FGrenadeFlight& Flight, const FVector& Velocity, const FVector& Normal);
+
+	// Whether a point is over the arena plane.
+	static bool IsOverFloor(const FGrenadeFlight& Flight, const FVector& Point);
+};
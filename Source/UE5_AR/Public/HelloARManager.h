@@ -10,7 +10,10 @@
 
 class UARSessionConfig;
 class AARPlaneActor;
+class UARPlaneBatchComponent;
 class UARPlaneGeometry;
+class UARTrackedGeometry;
+class UARTrackedImage;
 
 UCLASS()
 class UE5_AR_API AHelloARManager : public AActor
@@ -25,6 +28,9 @@ protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
 
+	// Called when the actor is removed from the level
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
 public:	
 	// Called every frame
 	virtual void Tick(float DeltaTime) override;
@@ -33,6 +39,14 @@ public:
 	UPROPERTY(Category = "SceneComp", VisibleAnywhere, BlueprintReadWrite)
 		USceneComponent* SceneComponent;
 
+	// Draws every plane from one component instead of one per plane actor.
+	UPROPERTY(Category = "SceneComp", VisibleAnywhere, BlueprintReadWrite)
+		UARPlaneBatchComponent* PlaneBatch;
+
+	// Whether planes are drawn by PlaneBatch. The batch material must use vertex colour for the plane tint.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	bool bBatchPlaneRendering = false;
+
 	// Boolean for tracking whether a plane has been selected to be used for the arena.
 	bool bPlaneSelected;
 
@@ -45,19 +59,44 @@ public:
 	// Assign the plane to be used for the arena.
 	void SetUsedPlane(UARPlaneGeometry* Plane);
 
+	// The plane actor used for the arena, or null before one is chosen. Its collision is the arena floor.
+	AARPlaneActor* GetArenaPlane() { return ArenaPlane; };
+
 	// Reset plane data.
 	void ResetARCoreSession();
 protected:
+
+	// Trackable notifications from the AR system. These queue the geometry for the next tick.
+	// *** //
+	void OnTrackableAdded(UARTrackedGeometry* Geometry);
+	void OnTrackableUpdated(UARTrackedGeometry* Geometry);
+	void OnTrackableRemoved(UARTrackedGeometry* Geometry);
+	// *** //
+
+	// Queue every current geometry. Used when starting up and after a reset.
+	void QueueAllTrackables();
 	
-	// Updates the plane actors on every frame as long as the AR Session is running
+	// Updates the plane actors that changed since the last frame, as long as the AR Session is running
 	void UpdatePlaneActors();
 
-	// Updates image tracked obstacle - spawning and moving.
+	// Queue a plane whose mesh is being rebuilt, so the result gets committed.
+	void QueueMeshCommit(AARPlaneActor* Plane);
+
+	// Commit finished plane meshes, stopping once the frame's budget is spent.
+	void CommitPlaneMeshes();
+
+	// Updates image tracked obstacle for images that changed since the last frame - spawning and moving.
 	void UpdateImageTracking();
 
 	// Spawns a plane.
 	AARPlaneActor* SpawnPlaneActor();
 
+	// Get a plane actor from the pool, spawning one if the pool is empty.
+	AARPlaneActor* AcquirePlaneActor();
+
+	// Return a plane actor to the pool.
+	void ReleasePlaneActor(AARPlaneActor* Plane);
+
 	// Gets specified plane's colour.
 	FColor GetPlaneColor(int Index);
 	
@@ -70,6 +109,46 @@ protected:
 	//Map of geometry planes
 	TMap<UARPlaneGeometry*, AARPlaneActor*> PlaneActors;
 
+	// The selected plane's actor.
+	AARPlaneActor* ArenaPlane = nullptr;
+
+	// Plane actors that aren't in use. ARCore merges planes often while scanning, so they are recycled rather than destroyed.
+	UPROPERTY()
+	TArray<AARPlaneActor*> PlanePool;
+
+	// Number of plane actors spawned into the pool when the session starts.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	int PlanePoolWarmupCount = 16;
+
+	// Pool statistics.
+	// *** //
+	int PlanePoolHits = 0;
+	int PlanePoolMisses = 0;
+	// *** //
+
+	// Geometries that changed since the last tick.
+	// *** //
+	UPROPERTY()
+	TSet<UARPlaneGeometry*> DirtyPlanes;
+	UPROPERTY()
+	TSet<UARTrackedImage*> DirtyImages;
+	// *** //
+
+	// Whether every geometry needs processing on the next tick.
+	bool bNeedsFullSync = true;
+
+	// Handles for the trackable notifications.
+	FDelegateHandle OnTrackableAddedHandle;
+	FDelegateHandle OnTrackableUpdatedHandle;
+	FDelegateHandle OnTrackableRemovedHandle;
+
+	// Planes with mesh builds waiting to be committed, oldest first.
+	TArray<AARPlaneActor*> PendingMeshCommits;
+
+	// Time per frame that can be spent committing plane meshes, in milliseconds.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	float MeshCommitBudgetMs = 1.0f;
+
 	//Index for plane colours and array of colours
 	int PlaneIndex = 0;
 	TArray<FColor> PlaneColors;
@@ -0,0 +1,62 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class AFighterPawn;
+class AObstacle;
+class FArenaSpatialIndex;
+
+/**
+ * Whether each pair of fighters can see each other past the obstacles, so target selection and hit chance previews are
+ * lookups rather than traces. Pairs are only re-traced when one of the fighters moves, or an obstacle near the line
+ * between them moves. Re-traces are spread over worker threads with ParallelFor.
+ * Positions are kept in arena space, so the arena anchor moving doesn't invalidate anything.
+ */
+class UE5_AR_API FLineOfSightCache
+{
+public:
+	// Bring the cache up to date. Call after the spatial index has been updated for the frame.
+	void Update(const TArray<AFighterPawn*>& Fighters, const TArray<AObstacle*>& Obstacles, const FArenaSpatialIndex& SpatialIndex);
+
+	// Whether an obstacle is between two fighters. Traces directly if the pair isn't cached or has moved since.
+	bool IsObstructed(AFighterPawn* From, AFighterPawn* To) const;
+
+	// Forget everything.
+	void Reset();
+
+	// Number of pairs re-traced in the last update.
+	int GetLastRetraceCount() const { return LastRetraceCount; }
+
+private:
+	int GetPairIndex(int A, int B) const { return A * Fighters.Num() + B; }
+
+	// Mark every pair whose line passes through a box as needing a re-trace.
+	void InvalidatePairsThrough(const FBox& Box);
+
+	// Arena space position of a fighter's centre.
+	FVector GetLocalCentre(AFighterPawn* Fighter) const;
+
+	// Trace between two arena space points for obstacles.
+	static bool TraceObstacles(const FArenaSpatialIndex& Index, const FVector& Start, const FVector& End);
+
+	const FArenaSpatialIndex* SpatialIndex = nullptr;
+
+	// Fighters in the matrix, and their centres when last traced.
+	TArray<AFighterPawn*> Fighters;
+	TArray<FVector> Centres;
+	TMap<const AFighterPawn*, int> FighterIndices;
+
+	// Obstacle bounds when last seen.
+	TMap<const AObstacle*, FBox> ObstacleBounds;
+
+	// Full square matrices, mirrored across the diagonal.
+	TBitArray<> Obstructed;
+	TBitArray<> Dirty;
+
+	// How far a fighter can drift before its pairs are re-traced.
+	float MoveTolerance = 0.5f;
+
+	int LastRetraceCount = 0;
+};
@@ -0,0 +1,105 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "CustomGameMode.h"
+#include "MatchBenchmarkSubsystem.generated.h"
+
+class ACustomARPawn;
+
+// Steps of the scripted benchmark match.
+enum class EBenchmarkStep : uint8
+{
+	WaitForSession,
+	PickPlane,
+	PlaceObstacles,
+	PlaceFighters,
+	TakeTurn,
+	WaitForTurn,
+	Finished
+};
+
+// Accumulated cost for one game phase.
+struct FBenchmarkPhaseStats
+{
+	int32 Frames = 0;
+	double TotalMs = 0.0;
+	uint64 Allocations = 0;
+};
+
+/**
+ * Plays a scripted match headless and writes frame time percentiles, per phase cost and allocation counts to a json file.
+ * Enabled with -MatchBenchmark, or -MatchBenchmark=<output file>. Normally combined with -ARReplay and -nullrhi so every
+ * run sees identical AR input. -MatchBenchmarkTurns=<n> caps the number of turns played.
+ */
+UCLASS()
+class UE5_AR_API UMatchBenchmarkSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	// Wrap GMalloc to count allocations when benchmarking. Called once at module startup, before any world exists.
+	static void InstallAllocationCounter();
+
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	// Called every frame
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+protected:
+	// Frame timing.
+	// *** //
+	void OnBeginFrame();
+	void OnEndFrame();
+	// *** //
+
+	// Script steps.
+	// *** //
+	void PickPlane(ACustomGameMode* GM, ACustomARPawn* Pawn);
+	void PlaceObstacles(ACustomGameMode* GM, ACustomARPawn* Pawn);
+	void PlaceFighters(ACustomGameMode* GM, ACustomARPawn* Pawn);
+	void TakeTurn(ACustomGameMode* GM, ACustomARPawn* Pawn);
+	// *** //
+
+	// Tap the screen where a world location is drawn.
+	bool TouchWorldLocation(ACustomARPawn* Pawn, const FVector& Location);
+
+	// Press the screen, drag to the release position and let go.
+	void Touch(ACustomARPawn* Pawn, const FVector& ScreenPos, const FVector& ReleasePos);
+
+	// Gets a point on the arena plane, in plane space.
+	FVector GetPlanePoint(const FVector2D& LocalPoint) const;
+
+	// Write the report and exit.
+	void Finish();
+
+	// Script state.
+	// *** //
+	EBenchmarkStep Step;
+	float WaitTime;
+	int32 TurnsPlayed;
+	int32 MaxTurns;
+	int32 PlacementIndex;
+	FTransform PlaneTransform;
+	FVector PlaneExtent;
+	// *** //
+
+	// Results.
+	// *** //
+	FString OutputPath;
+	TArray<float> FrameTimesMs;
+	TMap<EGamePhase, FBenchmarkPhaseStats> PhaseStats;
+	double FrameStartTime;
+	uint64 FrameStartAllocations;
+	EGamePhase FrameStartPhase;
+	double BenchmarkStartTime;
+	// *** //
+
+	FDelegateHandle BeginFrameHandle;
+	FDelegateHandle EndFrameHandle;
+};
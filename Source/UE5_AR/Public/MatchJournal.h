@@ -0,0 +1,167 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Arena.h"
+
+class IMappedFileHandle;
+class IMappedFileRegion;
+
+// Kinds of journal record.
+enum class EMatchJournalRecord : uint8
+{
+	Keyframe,
+	SpawnFighter,
+	SpawnObstacle,
+	SetUsedPlane,
+	SelectTarget,
+	Shoot,
+	Damage,
+	MoveTo,
+	ThrowGrenade,
+	Explode,
+	StartTurn,
+	EndTurn
+};
+
+/**
+ * One state change in a match. Fighters are identified by team and roster slot, which don't change over a match, and
+ * positions are in arena space. Only the fields a record's type uses are written.
+ */
+struct FMatchJournalRecord
+{
+	EMatchJournalRecord Type = EMatchJournalRecord::EndTurn;
+
+	// The fighter acting, spawned, damaged or starting their turn.
+	int Team = INDEX_NONE;
+	int Slot = INDEX_NONE;
+
+	// The fighter targeted or shot at.
+	int TargetTeam = INDEX_NONE;
+	int TargetSlot = INDEX_NONE;
+
+	// Spawn location, move destination, grenade landing or where the fighter ended their turn. World space for the plane.
+	FVector Location = FVector::ZeroVector;
+
+	// Half size of a spawn or the plane, or the grenade throw drag.
+	FVector Vector = FVector::ZeroVector;
+
+	// Orientation of the plane.
+	FQuat Rotation = FQuat::Identity;
+
+	// Damage taken.
+	float Value = 0.0f;
+
+	// Whether a shot hit.
+	bool bHit = false;
+};
+
+/**
+ * Appends a match to a compact binary journal. Each record is a type byte and a size, followed by its fields, and every
+ * few turns a keyframe stores the whole arena so playback can seek without replaying the match from the start.
+ * The file is flushed at the end of every turn, so a crashed session still leaves a readable journal.
+ */
+class UE5_AR_API FMatchJournalWriter
+{
+public:
+	~FMatchJournalWriter();
+
+	// Start a new journal, replacing any file at the path.
+	bool Open(const FString& Path, uint64 Seed, int NumTeams);
+	void Close();
+	bool IsOpen() const { return File.IsValid(); }
+
+	void Write(const FMatchJournalRecord& Record);
+
+	// Note a turn starting, with the arena as it stands, writing a keyframe when one is due.
+	void WriteStartTurn(const FMatchJournalRecord& Record, FArena& Arena);
+
+	// Turns between keyframes.
+	int KeyframeInterval = 8;
+
+private:
+	// Write the buffered record to the file. Stops recording and returns false if the record couldn't be serialized or
+	// is too big for its size field.
+	bool Commit(EMatchJournalRecord Type, const FArchive& Writer);
+
+	TUniquePtr<FArchive> File;
+	TArray<uint8> Buffer;
+	int Turns = 0;
+};
+
+/**
+ * Plays a journal back into an FArena. The file is memory mapped where the platform allows it, and only the record
+ * headers are read on open, to find the keyframes. Seeking restores the last keyframe at or before the turn and replays
+ * the records after it.
+ */
+class UE5_AR_API FMatchJournalReader
+{
+public:
+	FMatchJournalReader();
+	~FMatchJournalReader();
+
+	bool Open(const FString& Path);
+	void Close();
+
+	// Put the arena in the state it was in just after a turn started. Turns count from 1. Turn 0 is the arena after
+	// setup, before the first turn.
+	bool SeekToTurn(int Turn);
+
+	// Apply the next record to the arena. Returns false at the end of the journal.
+	bool Step(FMatchJournalRecord& OutRecord);
+
+	const FArena& GetArena() const { return Arena; }
+	uint64 GetSeed() const { return Seed; }
+	int GetNumRecords() const { return NumRecords; }
+	int GetNumKeyframes() const { return Keyframes.Num(); }
+	int GetNumTurns() const { return NumTurns; }
+
+	// The chosen plane's world transform and half size, once it's been chosen.
+	const FTransform& GetPlaneTransform() const { return PlaneTransform; }
+	const FVector& GetPlaneExtent() const { return PlaneExtent; }
+
+	// Apply a record to an arena.
+	static void ApplyRecord(FArena& Arena, const FMatchJournalRecord& Record);
+
+	// The arena index of the fighter in a team's roster slot. INDEX_NONE if there isn't one.
+	static int FindFighter(const FArena& Arena, int Team, int Slot);
+
+private:
+	struct FKeyframe
+	{
+		int Turn = 0;
+		int Offset = 0;
+
+		// The last SetUsedPlane record before the keyframe. INDEX_NONE if the plane hadn't been chosen.
+		int PlaneOffset = INDEX_NONE;
+	};
+
+	// Start again from the arena after setup.
+	void Rewind();
+
+	// Take the plane from a SetUsedPlane record.
+	void ApplyPlane(const FMatchJournalRecord& Record);
+
+	// Read the record at ReadOffset and move past it.
+	bool ReadRecord(FMatchJournalRecord& OutRecord, FArena* OutKeyframe);
+
+	// The journal's bytes, mapped or loaded.
+	TUniquePtr<IMappedFileHandle> MappedFile;
+	TUniquePtr<IMappedFileRegion> MappedRegion;
+	TArray<uint8> LoadedFile;
+	TArrayView<const uint8> Data;
+
+	uint64 Seed = 0;
+	int NumTeams = 2;
+	int NumRecords = 0;
+	int NumTurns = 0;
+	TArray<FKeyframe> Keyframes;
+	int FirstRecordOffset = 0;
+
+	// Playback position.
+	FArena Arena;
+	int ReadOffset = 0;
+	FTransform PlaneTransform;
+	FVector PlaneExtent = FVector::ZeroVector;
+};
@@ -0,0 +1,25 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "MatchJournalCommandlet.generated.h"
+
+/**
+ * Prints a recorded match journal, for looking into bug reports without the AR session that produced them.
+ *
+ * UnrealEditor-Cmd UE5_AR.uproject -run=MatchJournal -Journal=<file> -Turn=<n> -Records=<n>
+ *
+ * Seeks to the turn, logs every fighter's state, then logs the records that follow. Also times a seek to every turn.
+ */
+UCLASS()
+class UE5_AR_API UMatchJournalCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UMatchJournalCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+};
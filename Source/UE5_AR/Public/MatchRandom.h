@@ -0,0 +1,60 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Counter based random numbers for gameplay rolls. A roll is a hash of the match seed, a stream and the roll's number in
+ * that stream, so there's no shared generator state. Each fighter rolls from its own stream, which makes outcomes depend
+ * only on the seed and what each fighter did, never on which thread rolled or in what order.
+ */
+struct UE5_AR_API FMatchRandom
+{
+	// A uniform number in [0, 1) for one roll.
+	static float Roll(uint64 Seed, uint64 Stream, uint64 Counter)
+	{
+		// Top 24 bits, which a float holds exactly.
+		return (Hash(Seed, Stream, Counter) >> 40) * (1.0f / 16777216.0f);
+	}
+
+	// 64 random bits for one roll.
+	static uint64 Hash(uint64 Seed, uint64 Stream, uint64 Counter)
+	{
+		return Mix(Mix(Seed ^ Mix(Stream)) + Counter * 0x9E3779B97F4A7C15ull);
+	}
+
+	// A fighter's stream. Stream 0 is left for rolls that don't belong to a fighter.
+	static uint64 GetFighterStream(int Team, int Slot) { return (uint64(Team + 1) << 32) | uint32(Slot + 1); }
+
+	// A fresh match seed.
+	static uint64 MakeSeed() { return Mix(FPlatformTime::Cycles64() ^ (uint64(FPlatformTime::Cycles()) << 32)); }
+
+private:
+	// SplitMix64 finaliser.
+	static uint64 Mix(uint64 Value)
+	{
+		Value += 0x9E3779B97F4A7C15ull;
+		Value = (Value ^ (Value >> 30)) * 0xBF58476D1CE4E5B9ull;
+		Value = (Value ^ (Value >> 27)) * 0x94D049BB133111EBull;
+		return Value ^ (Value >> 31);
+	}
+};
+
+/**
+ * A stream of rolls, counting as it goes. Copying the stream copies its position.
+ */
+struct FMatchRandomStream
+{
+	FMatchRandomStream() = default;
+	FMatchRandomStream(uint64 InSeed, uint64 InStream) : Seed(InSeed), Stream(InStream) {}
+
+	float FRand() { return FMatchRandom::Roll(Seed, Stream, Counter++); }
+	float FRandRange(float Min, float Max) { return Min + (Max - Min) * FRand(); }
+	int RandHelper(int Max) { return Max > 0 ? FMath::Min(FMath::TruncToInt(FRand() * Max), Max - 1) : 0; }
+	uint64 NextSeed() { return FMatchRandom::Hash(Seed, Stream, Counter++); }
+
+	uint64 Seed = 0;
+	uint64 Stream = 0;
+	uint64 Counter = 0;
+};
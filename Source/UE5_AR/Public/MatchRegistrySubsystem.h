@@ -0,0 +1,88 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "MatchRegistrySubsystem.generated.h"
+
+class ACustomGameMode;
+class AHelloARManager;
+class AARPlaneActor;
+class AFighterPawn;
+class AObstacle;
+class AGrenade;
+class FArenaSpatialIndex;
+class FLineOfSightCache;
+class FMatchJournalWriter;
+
+/**
+ * Typed references to the actors the game looks up often. Actors register themselves when they begin play and
+ * unregister when they end play, so lookups don't need to iterate the world or cast.
+ */
+UCLASS()
+class UE5_AR_API UMatchRegistrySubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	// Registration.
+	// *** //
+	void RegisterGameMode(ACustomGameMode* InGameMode);
+	void UnregisterGameMode(ACustomGameMode* InGameMode);
+
+	void RegisterARManager(AHelloARManager* InARManager);
+	void UnregisterARManager(AHelloARManager* InARManager);
+
+	void RegisterPlane(AARPlaneActor* Plane) { Planes.AddUnique(Plane); }
+	void UnregisterPlane(AARPlaneActor* Plane) { Planes.RemoveSingleSwap(Plane, false); }
+
+	void RegisterFighter(AFighterPawn* Fighter) { Fighters.AddUnique(Fighter); }
+	void UnregisterFighter(AFighterPawn* Fighter) { Fighters.RemoveSingleSwap(Fighter, false); }
+
+	void RegisterObstacle(AObstacle* Obstacle) { Obstacles.AddUnique(Obstacle); }
+	void UnregisterObstacle(AObstacle* Obstacle) { Obstacles.RemoveSingleSwap(Obstacle, false); }
+
+	void RegisterGrenade(AGrenade* Grenade) { Grenades.AddUnique(Grenade); }
+	void UnregisterGrenade(AGrenade* Grenade) { Grenades.RemoveSingleSwap(Grenade, false); }
+	// *** //
+
+	// Getters.
+	// *** //
+	ACustomGameMode* GetGameMode() const { return GameMode; }
+	AHelloARManager* GetARManager() const { return ARManager; }
+	const TArray<AARPlaneActor*>& GetPlanes() const { return Planes; }
+	const TArray<AFighterPawn*>& GetFighters() const { return Fighters; }
+	const TArray<AObstacle*>& GetObstacles() const { return Obstacles; }
+	const TArray<AGrenade*>& GetGrenades() const { return Grenades; }
+
+	// The game mode's arena spatial index. Null before the game mode starts.
+	FArenaSpatialIndex* GetSpatialIndex() const;
+
+	// The game mode's line of sight cache. Null before the game mode starts.
+	FLineOfSightCache* GetLineOfSight() const;
+
+	// The game mode's match journal. Null unless a journal is being recorded.
+	FMatchJournalWriter* GetJournal() const;
+	// *** //
+
+protected:
+	UPROPERTY()
+	ACustomGameMode* GameMode = nullptr;
+
+	UPROPERTY()
+	AHelloARManager* ARManager = nullptr;
+
+	// Every plane actor, including pooled ones.
+	UPROPERTY()
+	TArray<AARPlaneActor*> Planes;
+
+	UPROPERTY()
+	TArray<AFighterPawn*> Fighters;
+
+	UPROPERTY()
+	TArray<AObstacle*> Obstacles;
+
+	UPROPERTY()
+	TArray<AGrenade*> Grenades;
+};
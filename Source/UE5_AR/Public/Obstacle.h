@@ -6,8 +6,6 @@
 #include "GameFramework/Actor.h"
 #include "Obstacle.generated.h"
 
-class UARPin;
-
 UCLASS()
 class UE5_AR_API AObstacle : public AActor
 {
@@ -20,6 +18,7 @@ public:
 protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 
 	// Root component.
 	UPROPERTY(EditAnywhere, BlueprintReadWrite)
@@ -36,12 +35,10 @@ protected:
 	float Scale;
 
 public:	
-	// Called every frame
-	virtual void Tick(float DeltaTime) override;
-
-	// Pin component to keep the obstacle's position in the same real world position.
-	UARPin* PinComponent;
-
 	// Getter for the scale.
-	float GetScale() { return Scale; };
+	float GetScale() const { return Scale; };
+
+	// Centre and half size of the crate, for the arena spatial index.
+	FVector GetArenaCenter() { return Crate->GetComponentLocation(); };
+	FVector GetArenaExtent() const { return FVector(HalfHeight * Scale); };
 };
@@ -0,0 +1,30 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+// Vertex and index buffers for an AR plane's procedural mesh section.
+struct FPlaneMeshData
+{
+	TArray<FVector> Vertices;
+	TArray<FLinearColor> VertexColors;
+	TArray<int> Indices;
+	TArray<FVector> Normals;
+	TArray<FVector2D> UVs;
+};
+
+/**
+ * Builds the feathered mesh for an AR plane boundary. Has no UObject dependencies, so it can run on worker threads.
+ * Each boundary point gets a second, interior vertex pulled towards the centre. The band between them is faded out with
+ * vertex alpha, and the interior polygon is filled with ear clipping so non-convex boundaries are handled correctly.
+ */
+class UE5_AR_API FPlaneMeshBuilder
+{
+public:
+	// Build vertices and indices for a boundary given in plane local space.
+	static void Build(const TArray<FVector>& BoundaryVertices, const FVector& PlaneNormal, float EdgeFeatheringDistance, FPlaneMeshData& OutMesh);
+
+	// Triangulate a simple polygon in the XY plane. Outputs indices into Polygon, with the same winding as the polygon.
+	static void Triangulate(const TArray<FVector>& Polygon, TArray<int>& OutIndices);
+};
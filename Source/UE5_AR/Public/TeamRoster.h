@@ -0,0 +1,49 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class AFighterPawn;
+
+/**
+ * A team's fighters, with their alive state kept up to date as fighters die rather than polled.
+ * Living fighters form a ring, so the alive count and the next living fighter after any slot are O(1).
+ */
+class UE5_AR_API FTeamRoster
+{
+public:
+	// Add a fighter to the team. Returns its slot.
+	int Add(AFighterPawn* Fighter);
+
+	// Mark the fighter in a slot as dead. Returns true if that was the team's last living fighter.
+	bool MarkDead(int Slot);
+
+	// Empty the team.
+	void Reset();
+
+	// The next living slot after the given one, wrapping round. INDEX_NONE if the whole team is dead.
+	int GetNextAlive(int Slot) const;
+
+	// The given slot if that fighter is alive, otherwise the next living one.
+	int GetAliveFrom(int Slot) const;
+
+	bool IsAlive(int Slot) const { return Slots.IsValidIndex(Slot) && Slots[Slot].bAlive; }
+	int GetAliveCount() const { return AliveCount; }
+	int Num() const { return Fighters.Num(); }
+	AFighterPawn* GetFighter(int Slot) const { return Fighters.IsValidIndex(Slot) ? Fighters[Slot] : nullptr; }
+	const TArray<AFighterPawn*>& GetFighters() const { return Fighters; }
+
+private:
+	// Position in the ring of living fighters. Dead slots keep the links they had when they died.
+	struct FRosterSlot
+	{
+		bool bAlive = true;
+		int Next = 0;
+		int Prev = 0;
+	};
+
+	TArray<AFighterPawn*> Fighters;
+	TArray<FRosterSlot> Slots;
+	int AliveCount = 0;
+};
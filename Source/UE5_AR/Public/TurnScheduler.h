@@ -0,0 +1,100 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "TeamRoster.h"
+#include "TurnScheduler.generated.h"
+
+// How turns are handed out between fighters.
+UENUM(BlueprintType)
+enum class ETurnOrder : uint8
+{
+	ROUND_ROBIN		UMETA(DisplayName = "Round Robin"),
+	INITIATIVE		UMETA(DisplayName = "Initiative")
+};
+
+// A fighter picked to take a turn.
+struct FTurnSlot
+{
+	int Team = INDEX_NONE;
+	int Slot = INDEX_NONE;
+
+	bool IsValid() const { return Team != INDEX_NONE; }
+};
+
+/**
+ * Picks which fighter takes the next turn, for any number of teams.
+ * Schedulers read fighter alive state from the rosters, so deaths don't need to be reported to them.
+ */
+class UE5_AR_API FTurnScheduler
+{
+public:
+	virtual ~FTurnScheduler() = default;
+
+	// Create a scheduler for the given turn order.
+	static TUniquePtr<FTurnScheduler> Create(ETurnOrder Order);
+
+	// Prepare for a new match. Called once every team has been placed.
+	virtual void Start(const TArray<FTeamRoster>& Teams) = 0;
+
+	// The next living fighter to take a turn. Invalid if no one is left.
+	virtual FTurnSlot Next(const TArray<FTeamRoster>& Teams) = 0;
+
+	// Where the scheduler is, so the arena simulation can carry on from it.
+	// *** //
+	// The slot a team last played, or INDEX_NONE if it hasn't played or the scheduler doesn't go team by team.
+	virtual int GetLastSlot(int Team) const { return INDEX_NONE; }
+
+	// When a fighter next acts, or 0 if the scheduler doesn't keep a clock.
+	virtual float GetNextTurnTime(const FTurnSlot& Turn) const { return 0.0f; }
+	// *** //
+};
+
+/**
+ * Teams take turns in order, each team cycling through its own living fighters. Dead teams are skipped.
+ * O(1) per turn in roster size, O(teams) when teams have been wiped out.
+ */
+class UE5_AR_API FRoundRobinScheduler : public FTurnScheduler
+{
+public:
+	virtual void Start(const TArray<FTeamRoster>& Teams) override;
+	virtual FTurnSlot Next(const TArray<FTeamRoster>& Teams) override;
+	virtual int GetLastSlot(int Team) const override;
+
+private:
+	// The team that took the last turn, and the last fighter each team used.
+	int CurrentTeam = INDEX_NONE;
+	TArray<int> LastSlots;
+};
+
+/**
+ * Every fighter acts on its own clock, faster fighters getting more turns. Fighters are kept in a min heap keyed by their
+ * next action time, so picking a turn is O(log n). Dead fighters are dropped lazily when they reach the top.
+ */
+class UE5_AR_API FInitiativeScheduler : public FTurnScheduler
+{
+public:
+	virtual void Start(const TArray<FTeamRoster>& Teams) override;
+	virtual FTurnSlot Next(const TArray<FTeamRoster>& Teams) override;
+	virtual float GetNextTurnTime(const FTurnSlot& Turn) const override;
+
+private:
+	struct FInitiativeEntry
+	{
+		float NextTime;
+		int Order;
+		FTurnSlot Turn;
+
+		// Earliest time first. Ties go in order, which interleaves the teams.
+		bool operator<(const FInitiativeEntry& Other) const
+		{
+			return NextTime < Other.NextTime || (NextTime == Other.NextTime && Order < Other.Order);
+		}
+	};
+
+	// Time between turns for a fighter.
+	static float GetTurnInterval(AFighterPawn* Fighter);
+
+	TArray<FInitiativeEntry> Heap;
+};
@@ -2,5 +2,15 @@
 
 #include "UE5_AR.h"
 #include "Modules/ModuleManager.h"
+#include "MatchBenchmarkSubsystem.h"
 
-IMPLEMENT_PRIMARY_GAME_MODULE( FDefaultGameModuleImpl, UE5_AR, "UE5_AR" );
+class FUE5_ARModule : public FDefaultGameModuleImpl
+{
+public:
+	virtual void StartupModule() override
+	{
+		UMatchBenchmarkSubsystem::InstallAllocationCounter();
+	}
+};
+
+IMPLEMENT_PRIMARY_GAME_MODULE( FUE5_ARModule, UE5_AR, "UE5_AR" );